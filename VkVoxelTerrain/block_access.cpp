@@ -0,0 +1,140 @@
+#include "block_access.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+static const glm::ivec3 directionOffsets[6] = {
+    { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+};
+
+// floors to a multiple of 16, negatives included
+static int chunkCorner(int v) {
+    return v & ~15;
+}
+
+BlockCursor::BlockCursor(ChunkLookup lookup, const glm::ivec3& position)
+    : lookup(std::move(lookup)), pos(position), chunk(nullptr), chunkOrigin()
+{
+    findChunk();
+}
+
+void BlockCursor::findChunk() {
+    chunkOrigin = glm::ivec2(chunkCorner(pos.x), chunkCorner(pos.z));
+    chunk = lookup(chunkOrigin.x, chunkOrigin.y);
+}
+
+void BlockCursor::moveTo(const glm::ivec3& position) {
+    pos = position;
+    if (chunkCorner(pos.x) != chunkOrigin.x || chunkCorner(pos.z) != chunkOrigin.y) {
+        findChunk();
+    }
+}
+
+void BlockCursor::step(Direction direction) {
+    moveTo(pos + directionOffsets[direction]);
+}
+
+bool BlockCursor::valid() const {
+    return chunk != nullptr && pos.y >= 0 && pos.y < 256;
+}
+
+BlockType BlockCursor::get() const {
+    if (!valid()) {
+        return EMPTY;
+    }
+    return chunk->blockData()[Chunk::blockIndex(pos.x - chunkOrigin.x, pos.y, pos.z - chunkOrigin.y)];
+}
+
+bool BlockCursor::set(BlockType type) {
+    if (!valid()) {
+        return false;
+    }
+    // through setBlockAt so the occupancy bits follow
+    std::unique_lock<std::shared_mutex> lock(chunk->blockMutex());
+    chunk->setBlockAt(pos.x - chunkOrigin.x, pos.y, pos.z - chunkOrigin.y, type);
+    return true;
+}
+
+BlockType BlockCursor::neighbour(Direction direction) const {
+    glm::ivec3 next = pos + directionOffsets[direction];
+    if (next.y < 0 || next.y >= 256) {
+        return EMPTY;
+    }
+    if (chunkCorner(next.x) == chunkOrigin.x && chunkCorner(next.z) == chunkOrigin.y) {
+        return chunk != nullptr
+            ? chunk->blockData()[Chunk::blockIndex(next.x - chunkOrigin.x, next.y, next.z - chunkOrigin.y)]
+            : EMPTY;
+    }
+    Chunk* other = lookup(chunkCorner(next.x), chunkCorner(next.z));
+    return other != nullptr
+        ? other->blockData()[Chunk::blockIndex(next.x - chunkCorner(next.x), next.y, next.z - chunkCorner(next.z))]
+        : EMPTY;
+}
+
+// Calls copy(chunk, chunkOrigin, lo, hi) for the part [lo, hi] of the box in
+// each Chunk column it overlaps, chunk being nullptr if it doesn't exist.
+// Returns how many blocks were in an existing Chunk.
+template <class F>
+static size_t forEachChunkPart(const ChunkLookup& lookup, const glm::ivec3& min, const glm::ivec3& max, F copy) {
+    size_t found = 0;
+    for (int z0 = chunkCorner(min.z); z0 <= max.z; z0 += 16) {
+        for (int x0 = chunkCorner(min.x); x0 <= max.x; x0 += 16) {
+            glm::ivec3 lo(std::max(min.x, x0), min.y, std::max(min.z, z0));
+            glm::ivec3 hi(std::min(max.x, x0 + 15), max.y, std::min(max.z, z0 + 15));
+            Chunk* chunk = lookup(x0, z0);
+            copy(chunk, glm::ivec2(x0, z0), lo, hi);
+            if (chunk != nullptr) {
+                int inWorld = std::max(0, std::min(hi.y, 255) - std::max(lo.y, 0) + 1);
+                found += static_cast<size_t>(hi.x - lo.x + 1) * inWorld * (hi.z - lo.z + 1);
+            }
+        }
+    }
+    return found;
+}
+
+size_t readRegion(const ChunkLookup& lookup, const glm::ivec3& min, const glm::ivec3& max, BlockType* out) {
+    if (max.x < min.x || max.y < min.y || max.z < min.z) {
+        return 0;
+    }
+    const glm::ivec3 size = max - min + 1;
+    return forEachChunkPart(lookup, min, max, [&](Chunk* chunk, glm::ivec2 origin, glm::ivec3 lo, glm::ivec3 hi) {
+        const size_t run = hi.x - lo.x + 1;
+        for (int z = lo.z; z <= hi.z; z++) {
+            for (int y = lo.y; y <= hi.y; y++) {
+                BlockType* dst = out + (lo.x - min.x) + size.x * ((y - min.y) + static_cast<size_t>(size.y) * (z - min.z));
+                if (chunk == nullptr || y < 0 || y >= 256) {
+                    std::fill_n(dst, run, EMPTY);
+                }
+                else {
+                    std::memcpy(dst, chunk->blockData() + Chunk::blockIndex(lo.x - origin.x, y, z - origin.y), run);
+                }
+            }
+        }
+    });
+}
+
+size_t writeRegion(const ChunkLookup& lookup, const glm::ivec3& min, const glm::ivec3& max, const BlockType* in) {
+    if (max.x < min.x || max.y < min.y || max.z < min.z) {
+        return 0;
+    }
+    const glm::ivec3 size = max - min + 1;
+    return forEachChunkPart(lookup, min, max, [&](Chunk* chunk, glm::ivec2 origin, glm::ivec3 lo, glm::ivec3 hi) {
+        if (chunk == nullptr) {
+            return;
+        }
+        const size_t run = hi.x - lo.x + 1;
+        const int yLo = std::max(lo.y, 0), yHi = std::min(hi.y, 255);
+        std::unique_lock<std::shared_mutex> lock(chunk->blockMutex());
+        for (int z = lo.z; z <= hi.z; z++) {
+            for (int y = yLo; y <= yHi; y++) {
+                const BlockType* src = in + (lo.x - min.x) + size.x * ((y - min.y) + static_cast<size_t>(size.y) * (z - min.z));
+                std::memcpy(chunk->blockData() + Chunk::blockIndex(lo.x - origin.x, y, z - origin.y), src, run);
+            }
+        }
+        if (yLo <= yHi) {
+            int first = yLo / SECTION_SIZE, last = yHi / SECTION_SIZE;
+            chunk->updateOccupancy(static_cast<uint16_t>(((1u << (last + 1)) - 1) & ~((1u << first) - 1)));
+        }
+    });
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "glm_includes.h"
+#include "chunk.h"
+
+#include <functional>
+
+// The Chunk whose lower-left corner is at (x, z), nullptr if there is none.
+// Called once per Chunk visited, not once per block.
+using ChunkLookup = std::function<Chunk*(int x, int z)>;
+
+// A position in the world that remembers the Chunk it is in. Stepping one
+// block at a time only looks the Chunk up again when it crosses into
+// another one, so walks over neighbouring blocks (physics, light, flood
+// fills) cost an array index per block instead of a hash lookup.
+//
+// Outside the world vertically, or in a Chunk that doesn't exist, blocks
+// read as EMPTY and writes are dropped.
+class BlockCursor {
+public:
+    BlockCursor(ChunkLookup lookup, const glm::ivec3& position);
+
+    const glm::ivec3& position() const { return pos; }
+    void moveTo(const glm::ivec3& position);
+    // One block towards direction
+    void step(Direction direction);
+    // Whether the block under the cursor can be read and written
+    bool valid() const;
+
+    BlockType get() const;
+    // Returns false if the block couldn't be written
+    bool set(BlockType type);
+    // The block one step towards direction, without moving
+    BlockType neighbour(Direction direction) const;
+
+private:
+    ChunkLookup lookup;
+    glm::ivec3 pos;
+    Chunk* chunk;
+    // the lower-left corner of the Chunk pos is in, looked up or not
+    glm::ivec2 chunkOrigin;
+
+    void findChunk();
+};
+
+// Copy the blocks in the box from min to max (both included) into out, or
+// from in into the world. The buffer holds the box's blocks with x fastest,
+// then y, then z, like a Chunk. Runs of blocks are copied a Chunk slab at a
+// time with one lookup per Chunk. Blocks outside the world read as EMPTY,
+// and writes to them are dropped. Both return how many blocks were in an
+// existing Chunk.
+size_t readRegion(const ChunkLookup& lookup, const glm::ivec3& min, const glm::ivec3& max, BlockType* out);
+size_t writeRegion(const ChunkLookup& lookup, const glm::ivec3& min, const glm::ivec3& max, const BlockType* in);
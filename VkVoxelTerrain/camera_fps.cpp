@@ -32,12 +32,29 @@ glm::mat4 CameraFPS::getViewProjectionMatrix() {
     return persp * view; 
 }
 
-void CameraFPS::processInput(Input input, float dt) {
-    // std::cout << "xrel: " << input.mouseX << " yrel: " << input.mouseY << "\n"; 
+void CameraFPS::updateVectors() {
+    // calculate the new Front vector
+    glm::vec3 front;
+    front.x = cos(glm::radians(mYaw)) * cos(glm::radians(mPitch));
+    front.y = sin(glm::radians(mPitch));
+    front.z = sin(glm::radians(mYaw)) * cos(glm::radians(mPitch));
+    mForward = glm::normalize(front);
+    // also re-calculate the Right and Up vector
+    mRight = glm::normalize(glm::cross(mForward, glm::vec3(0., 1., 0.)));  // normalize the vectors, because their length gets closer to 0 the more you look up or down which results in slower movement.
+    mUp = glm::normalize(glm::cross(mRight, mForward));
+}
+
+void CameraFPS::setPose(const glm::vec3& position, float yaw, float pitch) {
+    mPosition = position;
+    mYaw = yaw;
+    mPitch = glm::clamp(pitch, -89.0f, 89.0f);
+    updateVectors();
+}
 
-    if (input.mouseX|| input.mouseY) {
-        float xoffset = input.mouseX * mMouseSensitivity;
-        float yoffset = input.mouseY * mMouseSensitivity;
+void CameraFPS::processMouse(int mouseX, int mouseY) {
+    if (mouseX || mouseY) {
+        float xoffset = mouseX * mMouseSensitivity;
+        float yoffset = mouseY * mMouseSensitivity;
 
         mYaw += xoffset;
         mPitch += yoffset;
@@ -48,16 +65,14 @@ void CameraFPS::processInput(Input input, float dt) {
         if (mPitch < -89.0f)
             mPitch = -89.0f;
 
-        // calculate the new Front vector
-        glm::vec3 front;
-        front.x = cos(glm::radians(mYaw)) * cos(glm::radians(mPitch));
-        front.y = sin(glm::radians(mPitch));
-        front.z = sin(glm::radians(mYaw)) * cos(glm::radians(mPitch));
-        mForward = glm::normalize(front);
-        // also re-calculate the Right and Up vector
-        mRight = glm::normalize(glm::cross(mForward, glm::vec3(0., 1., 0.)));  // normalize the vectors, because their length gets closer to 0 the more you look up or down which results in slower movement.
-        mUp = glm::normalize(glm::cross(mRight, mForward));
+        updateVectors();
     };
+}
+
+void CameraFPS::processInput(Input input, float dt) {
+    // std::cout << "xrel: " << input.mouseX << " yrel: " << input.mouseY << "\n"; 
+
+    processMouse(input.mouseX, input.mouseY);
 
     float velocity = mMovementSpeed * dt; // velocity as a function of dt
     if (input.wPressed)
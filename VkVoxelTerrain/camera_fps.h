@@ -20,12 +20,26 @@ private:
     // camera options
     float mMovementSpeed;           
     float mMouseSensitivity;        
+
+    // recomputes the forward, right and up vectors from yaw and pitch
+    void updateVectors();
 public:
     // constructors
     CameraFPS(uint32_t width, uint32_t height, glm::vec3 pos);
 
     const glm::vec3&   getPosition() { return mPosition; }
+    const glm::vec3&   getForward() { return mForward; }
+    const glm::vec3&   getRight() { return mRight; }
+    const glm::vec3&   getUp() { return mUp; }
+    float       getMovementSpeed() const { return mMovementSpeed; }
+    float       getYaw() const { return mYaw; }
+    float       getPitch() const { return mPitch; }
+    // Places the camera directly, for replaying a recorded path. Angles in degrees.
+    void        setPose(const glm::vec3& position, float yaw, float pitch);
     void        setCameraWidthHeight(uint32_t w, uint32_t h);
     glm::mat4   getViewProjectionMatrix();
+    // Looks around by a mouse movement, without moving
+    void        processMouse(int mouseX, int mouseY);
+    // Moves the camera where it points, through anything in the way
     void        processInput(Input input, float dt);
 };
\ No newline at end of file
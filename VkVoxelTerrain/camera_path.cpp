@@ -0,0 +1,86 @@
+#include "camera_path.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+void CameraPath::add(float time, const CameraPose& pose) {
+    keyframes.push_back({ time, pose });
+}
+
+CameraPose CameraPath::sample(float time) const {
+    if (keyframes.empty()) {
+        return { glm::vec3(0.f), 0.f, 0.f };
+    }
+    if (time <= keyframes.front().time) {
+        return keyframes.front().pose;
+    }
+    if (time >= keyframes.back().time) {
+        return keyframes.back().pose;
+    }
+
+    // the first keyframe after time
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+        [](float t, const Keyframe& keyframe) { return t < keyframe.time; });
+    const Keyframe& a = *(next - 1);
+    const Keyframe& b = *next;
+    float t = (time - a.time) / std::max(b.time - a.time, 1e-6f);
+
+    CameraPose pose;
+    pose.position = glm::mix(a.pose.position, b.pose.position, t);
+    pose.yaw = glm::mix(a.pose.yaw, b.pose.yaw, t);
+    pose.pitch = glm::mix(a.pose.pitch, b.pose.pitch, t);
+    return pose;
+}
+
+CameraPath CameraPath::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open camera path " + path + "!");
+    }
+
+    CameraPath result;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        Keyframe keyframe;
+        CameraPose& pose = keyframe.pose;
+        if (!(fields >> keyframe.time >> pose.position.x >> pose.position.y >> pose.position.z >> pose.yaw >> pose.pitch)) {
+            throw std::runtime_error("bad keyframe in " + path + " on line " + std::to_string(lineNumber) + "!");
+        }
+        if (!result.keyframes.empty() && keyframe.time < result.keyframes.back().time) {
+            throw std::runtime_error("keyframes out of order in " + path + " on line " + std::to_string(lineNumber) + "!");
+        }
+        result.keyframes.push_back(keyframe);
+    }
+
+    if (result.keyframes.empty()) {
+        throw std::runtime_error("camera path " + path + " has no keyframes!");
+    }
+    return result;
+}
+
+void CameraPath::save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to write camera path " + path + "!");
+    }
+
+    file << "# time_s x y z yaw_deg pitch_deg\n";
+    for (const Keyframe& keyframe : keyframes) {
+        const CameraPose& pose = keyframe.pose;
+        file << keyframe.time << " " << pose.position.x << " " << pose.position.y << " " << pose.position.z << " "
+            << pose.yaw << " " << pose.pitch << "\n";
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "glm_includes.h"
+
+#include <string>
+#include <vector>
+
+struct CameraPose {
+    glm::vec3 position;
+    float yaw;      // degrees, not wrapped, so a path can turn several times
+    float pitch;
+};
+
+// A timed list of camera poses, recorded from play or written by hand.
+// Poses in between keyframes are interpolated linearly.
+//
+// Stored as text, one keyframe per line, with # comments:
+//   time_s x y z yaw_deg pitch_deg
+class CameraPath {
+public:
+    struct Keyframe {
+        float time;
+        CameraPose pose;
+    };
+
+    // Keyframes must be added in time order
+    void add(float time, const CameraPose& pose);
+    void clear() { keyframes.clear(); }
+    bool empty() const { return keyframes.empty(); }
+    size_t size() const { return keyframes.size(); }
+    float duration() const { return keyframes.empty() ? 0.f : keyframes.back().time; }
+
+    // The pose at this time, held at the ends
+    CameraPose sample(float time) const;
+
+    // Both throw std::runtime_error on failure
+    static CameraPath load(const std::string& path);
+    void save(const std::string& path) const;
+
+private:
+    std::vector<Keyframe> keyframes;
+};
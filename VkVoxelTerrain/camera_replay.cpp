@@ -0,0 +1,108 @@
+#include "camera_replay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <numeric>
+
+CameraReplay::CameraReplay()
+    : running(false), path(), name(), frame(0), totalFrames(0), frameMs()
+{
+}
+
+void CameraReplay::start(const CameraPath& path, const std::string& name) {
+    this->path = path;
+    this->name = name;
+    frame = 0;
+    // one frame on every step, both ends included
+    totalFrames = WARMUP_FRAMES + static_cast<int>(std::ceil(path.duration() / TIMESTEP)) + 1;
+    frameMs.clear();
+    frameMs.reserve(totalFrames - WARMUP_FRAMES);
+    running = !path.empty();
+}
+
+CameraPose CameraReplay::currentPose() const {
+    return path.sample(std::max(frame - WARMUP_FRAMES, 0) * TIMESTEP);
+}
+
+bool CameraReplay::addFrame(float ms) {
+    if (!running) {
+        return false;
+    }
+    if (frame >= WARMUP_FRAMES) {
+        frameMs.push_back(ms);
+    }
+    if (++frame < totalFrames) {
+        return false;
+    }
+    running = false;
+    return true;
+}
+
+CameraReplay::Report CameraReplay::report(const ChunkPipelineStats& pipeline) const {
+    Report result{};
+    result.name = name;
+    result.frames = static_cast<int>(frameMs.size());
+    result.chunkVisible = pipeline.chunkTimeToVisible();
+    result.zoneVisible = pipeline.zoneTimeToVisible();
+    if (frameMs.empty()) {
+        return result;
+    }
+
+    std::vector<float> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    };
+    result.meanMs = std::accumulate(sorted.begin(), sorted.end(), 0.f) / sorted.size();
+    result.p50Ms = percentile(0.5);
+    result.p99Ms = percentile(0.99);
+    result.maxMs = sorted.back();
+    for (float ms : sorted) {
+        result.hitches += ms > HITCH_FACTOR * result.p50Ms;
+        result.severeHitches += ms > SEVERE_HITCH_FACTOR * result.p50Ms;
+    }
+    return result;
+}
+
+void CameraReplay::writeReport(const Report& report, const std::string& path) {
+    std::cout << "\nCamera replay \"" << report.name << "\" (" << report.frames << " frames at "
+        << std::fixed << std::setprecision(1) << 1.f / TIMESTEP << " steps/s)\n"
+        << std::setprecision(3)
+        << "  frame ms: mean " << report.meanMs << ", p50 " << report.p50Ms << ", p99 " << report.p99Ms
+        << ", max " << report.maxMs << "\n"
+        << "  hitches: " << report.hitches << " over " << std::defaultfloat << HITCH_FACTOR << "x median, "
+        << report.severeHitches << " over " << SEVERE_HITCH_FACTOR << "x\n" << std::fixed
+        << std::setprecision(1)
+        << "  chunk visible ms: p50 " << report.chunkVisible.p50 << ", p95 " << report.chunkVisible.p95
+        << ", p99 " << report.chunkVisible.p99 << " (" << report.chunkVisible.count << " chunks)\n"
+        << "  zone visible ms: p50 " << report.zoneVisible.p50 << ", p95 " << report.zoneVisible.p95
+        << ", p99 " << report.zoneVisible.p99 << " (" << report.zoneVisible.count << " zones)\n";
+
+    std::ofstream json(path);
+    auto percentiles = [&json](const ChunkPipelineStats::Percentiles& p) {
+        json << "{ \"count\": " << p.count << ", \"p50_ms\": " << p.p50 << ", \"p95_ms\": " << p.p95
+            << ", \"p99_ms\": " << p.p99 << ", \"max_ms\": " << p.max << " }";
+    };
+    json << std::fixed << std::setprecision(3)
+        << "{\n"
+        << "  \"benchmark\": \"camera_replay\",\n"
+        << "  \"path\": \"" << report.name << "\",\n"
+        << "  \"steps_per_s\": " << 1.f / TIMESTEP << ",\n"
+        << "  \"frames\": " << report.frames << ",\n"
+        << "  \"frame_mean_ms\": " << report.meanMs << ",\n"
+        << "  \"frame_p50_ms\": " << report.p50Ms << ",\n"
+        << "  \"frame_p99_ms\": " << report.p99Ms << ",\n"
+        << "  \"frame_max_ms\": " << report.maxMs << ",\n"
+        << "  \"hitches\": " << report.hitches << ",\n"
+        << "  \"severe_hitches\": " << report.severeHitches << ",\n"
+        << "  \"chunk_visible\": ";
+    percentiles(report.chunkVisible);
+    json << ",\n  \"zone_visible\": ";
+    percentiles(report.zoneVisible);
+    json << "\n}\n";
+    std::cout << "Written to " << path << std::endl;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "camera_path.h"
+#include "chunk_pipeline_stats.h"
+
+#include <string>
+#include <vector>
+
+// Flies the camera along a CameraPath with a fixed timestep, so every run
+// sees the same sequence of views whatever the frame rate, and reports the
+// frame times. The first pose is held for a short warm-up first, which isn't
+// measured.
+//
+// Chunk streaming still runs on the thread pool in real time, so a slower
+// machine sees less of the world filled in along the path; the report's
+// time to visible shows how far behind it fell.
+class CameraReplay {
+public:
+    static constexpr float TIMESTEP = 1.f / 60.f;
+    static constexpr int WARMUP_FRAMES = 60;
+    // frames this many times the run's median count as hitches
+    static constexpr float HITCH_FACTOR = 2.f;
+    static constexpr float SEVERE_HITCH_FACTOR = 4.f;
+
+    struct Report {
+        std::string name;
+        int frames;
+        float meanMs, p50Ms, p99Ms, maxMs;
+        int hitches;
+        int severeHitches;
+        ChunkPipelineStats::Percentiles chunkVisible;
+        ChunkPipelineStats::Percentiles zoneVisible;
+    };
+
+    CameraReplay();
+
+    void start(const CameraPath& path, const std::string& name);
+    bool isRunning() const { return running; }
+    // Where the camera goes for the next frame
+    CameraPose currentPose() const;
+    // Feed one frame's CPU time. Returns true on the last frame of the path.
+    bool addFrame(float frameMs);
+
+    // Summarises the run, with time to visible from the terrain's pipeline
+    // stats (reset them when the replay starts)
+    Report report(const ChunkPipelineStats& pipeline) const;
+    // Prints the report to stdout and writes it as JSON to path
+    static void writeReport(const Report& report, const std::string& path);
+
+private:
+    bool running;
+    CameraPath path;
+    std::string name;
+    int frame;
+    int totalFrames;
+    std::vector<float> frameMs;
+};
@@ -0,0 +1,701 @@
+#include "chunk.h"
+#include "terrain_util.h"
+#include "chunk_constants.h"
+#include "memory_tracker.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+
+Chunk::Chunk(int x, int z) : m_blocks(), minX(x), minZ(z), occupancy(), solidSectionMask(0), vertexData(), 
+    idxData(), meshBytes(0), generated(false), blocksMutex(), numIndices(), vertexSize(), sections(), waterFirstIndex(0), waterIndexCount(0), cullFrame(0), visibleSections(0), lifecycle()
+{
+    std::fill_n(m_blocks.begin(), 65536, EMPTY);
+    MemoryTracker::instance().hostAllocated(MemoryTracker::HOST_CHUNK_BLOCKS, sizeof(m_blocks) + sizeof(occupancy));
+}
+
+Chunk::~Chunk() {
+    MemoryTracker::instance().hostFreed(MemoryTracker::HOST_CHUNK_BLOCKS, sizeof(m_blocks) + sizeof(occupancy));
+    if (meshBytes > 0) {
+        MemoryTracker::instance().hostFreed(MemoryTracker::HOST_CHUNK_MESH, meshBytes);
+    }
+}
+
+// Reports the mesh vectors' capacity to the MemoryTracker after they change
+void Chunk::trackMeshBytes() {
+    MemoryTracker& tracker = MemoryTracker::instance();
+    if (meshBytes > 0) {
+        tracker.hostFreed(MemoryTracker::HOST_CHUNK_MESH, meshBytes);
+    }
+    meshBytes = vertexData.capacity() * sizeof(Vertex) + idxData.capacity() * sizeof(uint32_t);
+    if (meshBytes > 0) {
+        tracker.hostAllocated(MemoryTracker::HOST_CHUNK_MESH, meshBytes);
+    }
+}
+
+ChunkLight::ChunkLight() : sections(), uniform(), writeMutex() {
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        sections[section].store(nullptr, std::memory_order_relaxed);
+        uniform[section].store(0, std::memory_order_relaxed);
+    }
+}
+
+ChunkLight::~ChunkLight() {
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        fillSection(section, 0);
+    }
+}
+
+ChunkLight::Section* ChunkLight::allocate(int section) {
+    Section* storage = new Section;
+    storage->levels.fill(uniform[section].load(std::memory_order_relaxed));
+    MemoryTracker::instance().hostAllocated(MemoryTracker::HOST_CHUNK_LIGHT, sizeof(Section));
+    sections[section].store(storage, std::memory_order_release);
+    return storage;
+}
+
+uint8_t ChunkLight::at(int index) const {
+    int section = ((index >> 4) & 0xFF) / SECTION_SIZE;
+    const Section* storage = sections[section].load(std::memory_order_acquire);
+    return storage != nullptr ? storage->levels[sectionIndex(index)] : uniform[section].load(std::memory_order_relaxed);
+}
+
+void ChunkLight::set(int index, uint8_t light) {
+    int section = ((index >> 4) & 0xFF) / SECTION_SIZE;
+    Section* storage = sections[section].load(std::memory_order_relaxed);
+    if (storage == nullptr) {
+        uint8_t same = uniform[section].load(std::memory_order_relaxed);
+        if (light == same) {
+            return;
+        }
+        storage = allocate(section);
+    }
+    storage->levels[sectionIndex(index)] = light;
+}
+
+void ChunkLight::row(int y, int z, uint8_t* out) const {
+    int section = y / SECTION_SIZE;
+    const Section* storage = sections[section].load(std::memory_order_acquire);
+    if (storage == nullptr) {
+        std::fill_n(out, 16, uniform[section].load(std::memory_order_relaxed));
+    }
+    else {
+        std::memcpy(out, storage->levels.data() + sectionIndex(Chunk::blockIndex(0, y, z)), 16);
+    }
+}
+
+void ChunkLight::setRow(int y, int z, const uint8_t* in) {
+    int section = y / SECTION_SIZE;
+    Section* storage = sections[section].load(std::memory_order_relaxed);
+    if (storage == nullptr) {
+        uint8_t same = uniform[section].load(std::memory_order_relaxed);
+        if (std::all_of(in, in + 16, [same](uint8_t light) { return light == same; })) {
+            return;
+        }
+        storage = allocate(section);
+    }
+    std::memcpy(storage->levels.data() + sectionIndex(Chunk::blockIndex(0, y, z)), in, 16);
+}
+
+void ChunkLight::fillSection(int section, uint8_t light) {
+    uniform[section].store(light, std::memory_order_relaxed);
+    Section* storage = sections[section].exchange(nullptr, std::memory_order_acq_rel);
+    if (storage != nullptr) {
+        delete storage;
+        MemoryTracker::instance().hostFreed(MemoryTracker::HOST_CHUNK_LIGHT, sizeof(Section));
+    }
+}
+
+int ChunkLight::allocatedSections() const {
+    int count = 0;
+    for (const auto& section : sections) {
+        count += section.load(std::memory_order_relaxed) != nullptr;
+    }
+    return count;
+}
+
+// Does bounds checking with at()
+BlockType Chunk::getBlockAt(unsigned int x, unsigned int y, unsigned int z) const {
+    return m_blocks.at(x + 16 * y + 16 * 256 * z);
+}
+
+// Exists to get rid of compiler warnings about int -> unsigned int implicit conversion
+BlockType Chunk::getBlockAt(int x, int y, int z) const {
+    return getBlockAt(static_cast<unsigned int>(x), static_cast<unsigned int>(y), static_cast<unsigned int>(z));
+}
+
+// Does bounds checking with at()
+void Chunk::setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t) {
+    m_blocks.at(x + 16 * y + 16 * 256 * z) = t;
+
+    int section = y / SECTION_SIZE;
+    int bit = x + SECTION_SIZE * z + SECTION_SIZE * SECTION_SIZE * (y % SECTION_SIZE);
+    uint64_t& word = occupancy[section].bits[bit / 64];
+    if (isOpaque(t)) {
+        word |= uint64_t(1) << (bit % 64);
+        solidSectionMask |= 1 << section;
+    }
+    else {
+        word &= ~(uint64_t(1) << (bit % 64));
+    }
+}
+
+void Chunk::updateOccupancy(uint16_t sections) {
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        if (!(sections & (1 << section))) {
+            continue;
+        }
+        SectionOccupancy& bits = occupancy[section];
+        uint64_t any = 0;
+        for (int y = 0; y < SECTION_SIZE; y++) {
+            for (int z = 0; z < SECTION_SIZE; z++) {
+                const BlockType* row = m_blocks.data() + blockIndex(0, section * SECTION_SIZE + y, z);
+                uint64_t rowBits = 0;
+                for (int x = 0; x < SECTION_SIZE; x++) {
+                    rowBits |= uint64_t(isOpaque(row[x])) << x;
+                }
+                uint64_t& word = bits.bits[y * 4 + z / 4];
+                int shift = 16 * (z % 4);
+                word = (word & ~(uint64_t(0xFFFF) << shift)) | (rowBits << shift);
+                any |= rowBits;
+            }
+        }
+        if (any) {
+            solidSectionMask |= 1 << section;
+        }
+        else {
+            solidSectionMask &= ~(1 << section);
+        }
+    }
+}
+
+
+const static std::unordered_map<Direction, Direction, EnumHash> oppositeDirection{
+    {XPOS, XNEG},
+    {XNEG, XPOS},
+    {YPOS, YNEG},
+    {YNEG, YPOS},
+    {ZPOS, ZNEG},
+    {ZNEG, ZPOS}
+};
+
+void createFaceIndices(std::vector<uint32_t>& idxData, const std::array<uint32_t, ChunkConstants::VERT_COUNT>& faceIndices, bool flip) {
+    // 0: UR, 1: LR, 2: LL, 3: UL
+    if (!flip) {
+        // First Triangle: 0, 3, 1
+        idxData.push_back(faceIndices.at(0));
+        idxData.push_back(faceIndices.at(3));
+        idxData.push_back(faceIndices.at(1));
+
+        // Second Triangle: 1, 3, 2
+        idxData.push_back(faceIndices.at(1));
+        idxData.push_back(faceIndices.at(3));
+        idxData.push_back(faceIndices.at(2));
+    }
+    else {
+        // split along 0-2 instead, same winding
+        idxData.push_back(faceIndices.at(0));
+        idxData.push_back(faceIndices.at(3));
+        idxData.push_back(faceIndices.at(2));
+
+        idxData.push_back(faceIndices.at(0));
+        idxData.push_back(faceIndices.at(2));
+        idxData.push_back(faceIndices.at(1));
+    }
+}
+
+// Ambient occlusion of a face corner from the three blocks in front of it
+// that touch it: bit 0 and bit 1 the two along the face's edges, bit 2 the
+// one diagonally out from the corner. Both edges solid hides the corner
+// blocks as well, so it is as dark as all three.
+static const uint8_t CORNER_AO[8] = { 3, 2, 2, 0, 2, 1, 1, 0 };
+
+// A section with a layer of its neighbours' blocks all around it, and their
+// light, so the mesher reads every neighbour and occluder with one index and
+// no checks for which Chunk it is in. Indexed x fastest, from -1 to 16.
+constexpr int PADDED = SECTION_SIZE + 2;
+struct PaddedSection {
+    std::array<BlockType, PADDED * PADDED * PADDED> blocks;
+    std::array<uint8_t, PADDED * PADDED * PADDED> light;
+};
+
+static int paddedIndex(int x, int y, int z) {
+    return (x + 1) + PADDED * ((y + 1) + PADDED * (z + 1));
+}
+
+static int paddedOffset(const glm::ivec3& offset) {
+    return offset.x + PADDED * (offset.y + PADDED * offset.z);
+}
+
+// Each face's neighbour, and the eight blocks around it in the face's plane,
+// as offsets into a PaddedSection from the block the face belongs to. Bit k
+// of a face's ring is set when ring block k is opaque. Corner i of the face
+// touches ring blocks corners[i]: the two along its edges, then the one
+// diagonally out from it.
+struct FaceOffsets {
+    int neighbour;
+    std::array<int, 8> ring;
+    std::array<std::array<int, 3>, ChunkConstants::VERT_COUNT> corners;
+};
+
+static const std::array<FaceOffsets, 6> faceOffsets = [] {
+    std::array<FaceOffsets, 6> offsets;
+    // ring bit of the block at (du, dv), in the order the ring is built
+    auto ringBit = [](int du, int dv) {
+        int k = (dv + 1) * 3 + (du + 1);
+        return k > 4 ? k - 1 : k;
+    };
+    for (size_t face = 0; face < ChunkConstants::neighbouringFaces.size(); face++) {
+        const ChunkConstants::BlockFace& f = ChunkConstants::neighbouringFaces[face];
+        glm::ivec3 normal = f.direction;
+        offsets[face].neighbour = paddedOffset(normal);
+        // the two axes along the face
+        int u = normal.x != 0 ? 1 : 0, v = normal.z != 0 ? 1 : 2;
+        int k = 0;
+        for (int dv = -1; dv <= 1; dv++) {
+            for (int du = -1; du <= 1; du++) {
+                if (du == 0 && dv == 0) {
+                    continue;
+                }
+                glm::ivec3 offset = normal;
+                offset[u] += du;
+                offset[v] += dv;
+                offsets[face].ring[k++] = paddedOffset(offset);
+            }
+        }
+        for (int i = 0; i < ChunkConstants::VERT_COUNT; i++) {
+            int du = f.pos[i][u] > 0.5f ? 1 : -1, dv = f.pos[i][v] > 0.5f ? 1 : -1;
+            offsets[face].corners[i] = { ringBit(du, 0), ringBit(0, dv), ringBit(du, dv) };
+        }
+    }
+    return offsets;
+}();
+
+// The occlusion of all four corners of a face for each of its 256 rings:
+// corner i's level in bits 2i and 2i + 1, and bit 8 set when the quad is
+// better split along corners 0-2 than 1-3. The split goes along the
+// brighter diagonal so a dark corner shades the same way whichever way the
+// face is turned.
+static const std::array<std::array<uint16_t, 256>, 6> faceAoTable = [] {
+    std::array<std::array<uint16_t, 256>, 6> table;
+    for (size_t face = 0; face < ChunkConstants::neighbouringFaces.size(); face++) {
+        for (int ring = 0; ring < 256; ring++) {
+            int ao[ChunkConstants::VERT_COUNT];
+            uint16_t packed = 0;
+            for (int i = 0; i < ChunkConstants::VERT_COUNT; i++) {
+                const std::array<int, 3>& cells = faceOffsets[face].corners[i];
+                int side1 = (ring >> cells[0]) & 1;
+                int side2 = (ring >> cells[1]) & 1;
+                int corner = (ring >> cells[2]) & 1;
+                ao[i] = CORNER_AO[side1 | side2 << 1 | corner << 2];
+                packed |= ao[i] << (2 * i);
+            }
+            if (ao[0] + ao[2] > ao[1] + ao[3]) {
+                packed |= 1 << 8;
+            }
+            table[face][ring] = packed;
+        }
+    }
+    return table;
+}();
+
+// The blocks createBlock would put in the columns around a Chunk, for sides
+// without a generated neighbour, lit the way the LightEngine first lights a
+// column: open sky down to the top block, one level less for each block of
+// water below that. Each column's height is worked out the first time it is
+// needed and kept for the Chunk's other sections.
+class GeneratedBorder {
+public:
+    explicit GeneratedBorder(glm::ivec2 origin) : origin(origin), heights() {
+        heights.fill(UNKNOWN);
+    }
+
+    // x and z relative to the Chunk's corner, from -1 to 16
+    void block(int x, int y, int z, BlockType& block, uint8_t& light) {
+        int& height = heights[(x + 1) + PADDED * (z + 1)];
+        if (height == UNKNOWN) {
+            height = terrainHeight(origin.x + x, origin.y + z);
+        }
+        block = columnBlock(height, y);
+        int top = std::max(height, WATER_LEVEL);
+        light = y >= top ? packLight(15, 0) : y >= height ? packLight(std::max(15 - (top - y), 0), 0) : packLight(0, 0);
+    }
+
+private:
+    static constexpr int UNKNOWN = -1;
+    glm::ivec2 origin;
+    std::array<int, PADDED * PADDED> heights;
+};
+
+// A block and its light past one of the Chunk's sides or corners, offset
+// being relative to the Chunk's corner and y inside the world
+static void outsideBlock(const ChunkBorders* borders, GeneratedBorder& generated, const glm::ivec3& offset,
+    BlockType& block, uint8_t& light)
+{
+    if (borders != nullptr) {
+        bool pastX = offset.x < 0 || offset.x > 15, pastZ = offset.z < 0 || offset.z > 15;
+        if (pastX && pastZ) {
+            int corner = (offset.x < 0 ? 2 : 0) + (offset.z < 0 ? 1 : 0);
+            if (borders->cornerPresent[corner]) {
+                block = borders->corners[corner][offset.y];
+                light = borders->cornerLight[corner][offset.y];
+                return;
+            }
+        }
+        else {
+            int side = offset.x > 15 ? 0 : offset.x < 0 ? 1 : offset.z > 15 ? 2 : 3;
+            int along = side < 2 ? offset.z : offset.x;
+            if (borders->present[side]) {
+                block = borders->sides[side][along + 16 * offset.y];
+                light = borders->sideLight[side][along + 16 * offset.y];
+                return;
+            }
+        }
+    }
+    generated.block(offset.x, offset.y, offset.z, block, light);
+}
+
+// Fills padded with the section and the blocks around it. Returns false,
+// leaving padded as it was, when the section is all air.
+static bool fillPadded(const BlockType* blocks, const ChunkLight& light, int section, const ChunkBorders* borders,
+    GeneratedBorder& generated, PaddedSection& padded)
+{
+    const int y0 = section * SECTION_SIZE;
+    bool any = false;
+    for (int z = 0; z < 16 && !any; z++) {
+        const BlockType* slab = blocks + Chunk::blockIndex(0, y0, z);
+        any = std::any_of(slab, slab + 16 * SECTION_SIZE, [](BlockType b) { return b != EMPTY; });
+    }
+    if (!any) {
+        return false;
+    }
+
+    for (int z = -1; z <= 16; z++) {
+        for (int y = -1; y <= SECTION_SIZE; y++) {
+            int worldY = y0 + y;
+            int first = paddedIndex(-1, y, z);
+            BlockType* row = padded.blocks.data() + first;
+            uint8_t* rowLight = padded.light.data() + first;
+            // below the world is solid ground and above it is air under open
+            // sky, as createBlock has it
+            if (worldY < 0 || worldY > 255) {
+                std::fill_n(row, PADDED, worldY < 0 ? GRASS : EMPTY);
+                std::fill_n(rowLight, PADDED, worldY < 0 ? packLight(0, 0) : packLight(15, 0));
+            }
+            else if (z < 0 || z > 15) {
+                for (int x = -1; x <= 16; x++) {
+                    outsideBlock(borders, generated, glm::ivec3(x, worldY, z), row[x + 1], rowLight[x + 1]);
+                }
+            }
+            else {
+                outsideBlock(borders, generated, glm::ivec3(-1, worldY, z), row[0], rowLight[0]);
+                std::memcpy(row + 1, blocks + Chunk::blockIndex(0, worldY, z), 16);
+                light.row(worldY, z, rowLight + 1);
+                outsideBlock(borders, generated, glm::ivec3(16, worldY, z), row[17], rowLight[17]);
+            }
+        }
+    }
+    return true;
+}
+
+// Appends the faces of one section, numbering its vertices on from the ones
+// already in vertices
+static void appendSectionFaces(const BlockType* blocks, const ChunkLight& light, glm::ivec2 origin, int section,
+    const ChunkBorders* borders, GeneratedBorder& generated,
+    std::vector<Vertex>& vertices, std::vector<uint32_t>& opaqueIndices, std::vector<uint32_t>& waterIndices)
+{
+    thread_local PaddedSection padded;
+    if (!fillPadded(blocks, light, section, borders, generated, padded)) {
+        return;
+    }
+    uint32_t idxCounter = static_cast<uint32_t>(vertices.size());
+    const int y0 = section * SECTION_SIZE;
+
+    // zyx because it's more cache efficient
+    for (int z = 0; z < 16; z++) {
+        for (int y = 0; y < SECTION_SIZE; y++) {
+            for (int x = 0; x < 16; x++) {
+                const int p = paddedIndex(x, y, z);
+                BlockType current = padded.blocks[p];
+                if (current != EMPTY) {
+                    for (size_t face = 0; face < ChunkConstants::neighbouringFaces.size(); face++) {
+                        const ChunkConstants::BlockFace& n = ChunkConstants::neighbouringFaces[face];
+                        const FaceOffsets& offsets = faceOffsets[face];
+                        const int front = p + offsets.neighbour;
+                        BlockType neighbour = padded.blocks[front];
+
+                        // opaque faces show through air and water, water
+                        // faces only through air so lakes have no inner walls
+                        bool visible = current == WATER ? neighbour == EMPTY : !isOpaque(neighbour);
+                        if (visible) {
+                            // the light of the block the face looks into
+                            const uint8_t frontLight = padded.light[front];
+                            std::array<uint8_t, ChunkConstants::VERT_COUNT> sky, block;
+                            sky.fill(static_cast<uint8_t>(skyLight(frontLight) * 17));
+                            block.fill(static_cast<uint8_t>(blockLight(frontLight) * 17));
+
+                            // water isn't occluded or smoothed, it would show the shore through it
+                            uint16_t ao = 0xFF;
+                            if (current != WATER) {
+                                int ring = 0;
+                                std::array<uint8_t, 8> ringLight;
+                                bool even = true;
+                                for (int k = 0; k < 8; k++) {
+                                    int cell = p + offsets.ring[k];
+                                    bool opaque = isOpaque(padded.blocks[cell]);
+                                    ring |= int(opaque) << k;
+                                    ringLight[k] = padded.light[cell];
+                                    even = even && (opaque || ringLight[k] == frontLight);
+                                }
+                                ao = faceAoTable[face][ring];
+
+                                // smooth lighting: each corner averages the
+                                // light of the non-opaque blocks touching it
+                                // in front of the face, skipping the diagonal
+                                // one when both edges hide it. Evenly lit
+                                // faces, most of them, keep frontLight.
+                                for (int i = 0; i < ChunkConstants::VERT_COUNT && !even; i++) {
+                                    const std::array<int, 3>& cells = offsets.corners[i];
+                                    int skySum = skyLight(frontLight), blockSum = blockLight(frontLight), count = 1;
+                                    bool edge1 = (ring >> cells[0]) & 1, edge2 = (ring >> cells[1]) & 1;
+                                    for (int c = 0; c < 3; c++) {
+                                        bool opaque = (ring >> cells[c]) & 1;
+                                        if (opaque || (c == 2 && edge1 && edge2)) {
+                                            continue;
+                                        }
+                                        skySum += skyLight(ringLight[cells[c]]);
+                                        blockSum += blockLight(ringLight[cells[c]]);
+                                        count++;
+                                    }
+                                    sky[i] = static_cast<uint8_t>(skySum * 17 / count);
+                                    block[i] = static_cast<uint8_t>(blockSum * 17 / count);
+                                }
+                            }
+
+                            const glm::vec3 color = ChunkConstants::blocktype_to_color.at(current);
+                            const glm::vec2 uvOffset = ChunkConstants::block_face_uv_offset.at({ current, n.faceType });
+                            std::array<uint32_t, ChunkConstants::VERT_COUNT> faceIndices;
+                            for (size_t i = 0; i < n.pos.size(); i++) {
+                                Vertex vtx; 
+                                vtx.pos = glm::vec3(origin.x + x, y0 + y, origin.y + z) + glm::vec3(n.pos[i]);
+                                vtx.nor = n.nor; 
+                                vtx.color = color;
+                                vtx.texCoord = (ChunkConstants::UV.at(i) + uvOffset) / 16.f;
+                                vtx.ao = static_cast<uint8_t>((ao >> (2 * i)) & 3);
+                                vtx.skyLight = sky[i];
+                                vtx.blockLight = block[i];
+                                vtx.padding = 0;
+                                faceIndices.at(i) = idxCounter++;
+                                vertices.push_back(vtx); 
+                            }
+                            // add index data for this face
+                            createFaceIndices(current == WATER ? waterIndices : opaqueIndices, faceIndices, (ao >> 8) & 1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Chunk::meshSection(const BlockType* blocks, const ChunkLight& light, glm::ivec2 origin, int section,
+    const ChunkBorders* borders, SectionMesh& out)
+{
+    out.vertices.clear();
+    out.opaqueIndices.clear();
+    out.waterIndices.clear();
+    GeneratedBorder generated(origin);
+    appendSectionFaces(blocks, light, origin, section, borders, generated, out.vertices, out.opaqueIndices, out.waterIndices);
+    out.visibility = computeSectionVisibility(blocks, section);
+}
+
+ChunkMesh ChunkMesh::assemble(const SectionMeshes& meshes) {
+    size_t vertexCount = 0, indexCount = 0;
+    for (const SectionMesh& mesh : meshes) {
+        vertexCount += mesh.vertices.size();
+        indexCount += mesh.opaqueIndices.size() + mesh.waterIndices.size();
+    }
+
+    ChunkMesh result;
+    result.vertices.reserve(vertexCount);
+    result.indices.reserve(indexCount);
+    std::array<uint32_t, SECTION_COUNT> firstVertex;
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        const SectionMesh& mesh = meshes[section];
+        uint32_t base = static_cast<uint32_t>(result.vertices.size());
+        firstVertex[section] = base;
+        result.vertices.insert(result.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+
+        ChunkSection& range = result.sections[section];
+        range.firstIndex = static_cast<uint32_t>(result.indices.size());
+        range.indexCount = static_cast<uint32_t>(mesh.opaqueIndices.size());
+        range.visibility = mesh.visibility;
+        for (uint32_t index : mesh.opaqueIndices) {
+            result.indices.push_back(base + index);
+        }
+    }
+
+    // water faces share the vertex data but their indices go after all of
+    // the sections, so the opaque and translucent passes each get one range
+    result.waterFirstIndex = static_cast<uint32_t>(result.indices.size());
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        for (uint32_t index : meshes[section].waterIndices) {
+            result.indices.push_back(firstVertex[section] + index);
+        }
+    }
+    result.waterIndexCount = static_cast<uint32_t>(result.indices.size()) - result.waterFirstIndex;
+    return result;
+}
+
+void Chunk::copyBorders(const std::array<const Chunk*, 8>& neighbours, ChunkBorders& borders) {
+    // the column of each neighbour that touches this Chunk
+    static const int touching[4] = { 0, 15, 0, 15 };
+    for (int side = 0; side < 4; side++) {
+        const Chunk* neighbour = neighbours[side];
+        borders.present[side] = neighbour != nullptr;
+        if (neighbour == nullptr) {
+            continue;
+        }
+        std::shared_lock<std::shared_mutex> lock(neighbour->blockMutex());
+        std::shared_lock<std::shared_mutex> lightLock(neighbour->light.mutex());
+        for (int y = 0; y < 256; y++) {
+            for (int along = 0; along < 16; along++) {
+                int index = side < 2 ? blockIndex(touching[side], y, along) : blockIndex(along, y, touching[side]);
+                borders.sides[side][along + 16 * y] = neighbour->m_blocks[index];
+                borders.sideLight[side][along + 16 * y] = neighbour->light.at(index);
+            }
+        }
+    }
+    // and the column of each diagonal neighbour that touches this one's corner
+    for (int corner = 0; corner < 4; corner++) {
+        const Chunk* neighbour = neighbours[4 + corner];
+        borders.cornerPresent[corner] = neighbour != nullptr;
+        if (neighbour == nullptr) {
+            continue;
+        }
+        std::shared_lock<std::shared_mutex> lock(neighbour->blockMutex());
+        std::shared_lock<std::shared_mutex> lightLock(neighbour->light.mutex());
+        int x = corner < 2 ? 0 : 15, z = corner % 2 == 0 ? 0 : 15;
+        for (int y = 0; y < 256; y++) {
+            borders.corners[corner][y] = neighbour->m_blocks[blockIndex(x, y, z)];
+            borders.cornerLight[corner][y] = neighbour->light.at(blockIndex(x, y, z));
+        }
+    }
+}
+
+void Chunk::createVertexData(const ChunkBorders* borders) {
+    // check every block to see if it's NOT empty
+    // check the neighbours of each non-empty block to see if they ARE empty
+    // if a nebour is empty, add VBO data for a face in that direction
+
+    // water faces share the vertex data but their indices go after all of
+    // the sections, so the opaque and translucent passes each get one range
+    std::vector<uint32_t> waterIdxData;
+
+    // one section at a time so that each section's indices are contiguous.
+    // Straight into the Chunk's own vectors, as copying the mesh out of
+    // SectionMeshes would cost as much again as meshing it.
+    GeneratedBorder generated(getOrigin());
+    std::shared_lock<std::shared_mutex> lock(blocksMutex);
+    std::shared_lock<std::shared_mutex> lightLock(light.mutex());
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        sections[section].firstIndex = static_cast<uint32_t>(idxData.size());
+        appendSectionFaces(blockData(), light, getOrigin(), section, borders, generated, vertexData, idxData, waterIdxData);
+        sections[section].indexCount = static_cast<uint32_t>(idxData.size()) - sections[section].firstIndex;
+        sections[section].visibility = computeSectionVisibility(blockData(), section);
+    }
+
+    waterFirstIndex = static_cast<uint32_t>(idxData.size());
+    waterIndexCount = static_cast<uint32_t>(waterIdxData.size());
+    idxData.insert(idxData.end(), waterIdxData.begin(), waterIdxData.end());
+
+    vertexSize = vertexData.size(); 
+    numIndices = idxData.size();
+    trackMeshBytes();
+}
+
+// Flood fills every pocket of non-opaque blocks in the section and connects
+// all of the faces that pocket touches. Cells are indexed x + 16 * z + 256 * y.
+SectionVisibility Chunk::computeSectionVisibility(const BlockType* blocks, int section) {
+    constexpr int CELLS = SECTION_SIZE * SECTION_SIZE * SECTION_SIZE;
+    SectionVisibility visibility;
+
+    std::bitset<CELLS> open;
+    for (int y = 0; y < SECTION_SIZE; y++) {
+        for (int z = 0; z < SECTION_SIZE; z++) {
+            for (int x = 0; x < SECTION_SIZE; x++) {
+                if (!isOpaque(blocks[blockIndex(x, section * SECTION_SIZE + y, z)])) {
+                    open.set(x + SECTION_SIZE * z + SECTION_SIZE * SECTION_SIZE * y);
+                }
+            }
+        }
+    }
+
+    // the common cases: solid stone or open sky
+    if (open.none()) {
+        return visibility;
+    }
+    if (open.all()) {
+        visibility.connectAll();
+        return visibility;
+    }
+
+    std::bitset<CELLS> visited;
+    std::vector<int> stack;
+    stack.reserve(CELLS);
+
+    for (int start = 0; start < CELLS; start++) {
+        if (!open.test(start) || visited.test(start)) {
+            continue;
+        }
+
+        // faces touched by this pocket, one bit per Direction
+        uint8_t faces = 0;
+        visited.set(start);
+        stack.push_back(start);
+
+        while (!stack.empty()) {
+            int cell = stack.back();
+            stack.pop_back();
+
+            int x = cell % SECTION_SIZE;
+            int z = (cell / SECTION_SIZE) % SECTION_SIZE;
+            int y = cell / (SECTION_SIZE * SECTION_SIZE);
+
+            std::array<std::pair<int, Direction>, 6> steps = { {
+                { x < SECTION_SIZE - 1 ? cell + 1 : -1, XPOS },
+                { x > 0 ? cell - 1 : -1, XNEG },
+                { y < SECTION_SIZE - 1 ? cell + SECTION_SIZE * SECTION_SIZE : -1, YPOS },
+                { y > 0 ? cell - SECTION_SIZE * SECTION_SIZE : -1, YNEG },
+                { z < SECTION_SIZE - 1 ? cell + SECTION_SIZE : -1, ZPOS },
+                { z > 0 ? cell - SECTION_SIZE : -1, ZNEG }
+            } };
+
+            for (const auto& [next, dir] : steps) {
+                if (next < 0) {
+                    faces |= 1 << dir;
+                }
+                else if (open.test(next) && !visited.test(next)) {
+                    visited.set(next);
+                    stack.push_back(next);
+                }
+            }
+        }
+
+        for (int a = 0; a < 6; a++) {
+            for (int b = 0; b < 6; b++) {
+                if ((faces & (1 << a)) && (faces & (1 << b))) {
+                    visibility.connect(Direction(a), Direction(b));
+                }
+            }
+        }
+    }
+    return visibility;
+}
+
+void Chunk::releaseMeshData() {
+    // swap so the capacity goes too
+    std::vector<Vertex>().swap(vertexData);
+    std::vector<uint32_t>().swap(idxData);
+    trackMeshBytes();
+}
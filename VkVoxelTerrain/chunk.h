@@ -0,0 +1,279 @@
+#pragma once
+#include "smartpointerhelp.h"
+#include "glm_includes.h"
+#include "vertex.h"
+#include "chunk_pipeline_stats.h"
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstddef>
+#include <vector>
+
+
+//using namespace std;
+
+// C++ 11 allows us to define the size of an enum. This lets us use only one byte
+// of memory to store our different block types. By default, the size of a C++ enum
+// is that of an int (so, usually four bytes). This *does* limit us to only 256 different
+// block types, but in the scope of this project we'll never get anywhere near that many.
+enum BlockType : unsigned char
+{
+    EMPTY, GRASS, DIRT, STONE, WATER, GLOWSTONE
+};
+
+// The six cardinal directions in 3D space
+enum Direction : unsigned char
+{
+    XPOS, XNEG, YPOS, YNEG, ZPOS, ZNEG
+};
+
+// Water and air don't block sight, everything else does
+inline bool isOpaque(BlockType t) {
+    return t != EMPTY && t != WATER;
+}
+
+// The block light a block gives off, 0 to 15
+inline int lightEmission(BlockType t) {
+    return t == GLOWSTONE ? 15 : 0;
+}
+
+// A Chunk is split vertically into 16 x 16 x 16 sections. Each section
+// owns a contiguous range of the Chunk's index data so it can be culled
+// without touching the rest of the Chunk.
+constexpr int SECTION_SIZE = 16;
+constexpr int SECTION_COUNT = 256 / SECTION_SIZE;
+
+// Records which of a section's six faces (indexed by Direction) can see
+// each other through non-opaque blocks. Bit (a * 6 + b) is set when face a
+// is connected to face b. Computed once at mesh time.
+struct SectionVisibility {
+    uint64_t bits = 0;
+
+    void connect(Direction a, Direction b) {
+        bits |= (uint64_t(1) << (a * 6 + b)) | (uint64_t(1) << (b * 6 + a));
+    }
+    bool isConnected(Direction a, Direction b) const {
+        return (bits >> (a * 6 + b)) & 1;
+    }
+    void connectAll() {
+        bits = (uint64_t(1) << 36) - 1;
+    }
+};
+
+struct ChunkSection {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    SectionVisibility visibility;
+};
+
+// The mesh of one section on its own, its indices counting from its own
+// first vertex. Kept for Chunks that get edited, so only the sections an
+// edit touches have to be meshed again.
+struct SectionMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> opaqueIndices;
+    std::vector<uint32_t> waterIndices;
+    SectionVisibility visibility;
+};
+using SectionMeshes = std::array<SectionMesh, SECTION_COUNT>;
+
+// A whole Chunk's mesh: the vertices, then every section's opaque indices
+// in order, then the water indices
+struct ChunkMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::array<ChunkSection, SECTION_COUNT> sections{};
+    uint32_t waterFirstIndex = 0;
+    uint32_t waterIndexCount = 0;
+
+    // Concatenates the section meshes, moving their indices past the
+    // vertices of the sections before them
+    static ChunkMesh assemble(const SectionMeshes& meshes);
+};
+
+// Sky light and block light of a Chunk, each 0 to 15, one byte per block:
+// sky light in the high nibble, block light in the low one (see
+// packLight). Stored per section, and a section with the same light all
+// through it, like open sky or solid ground, is one byte until a block in
+// it is lit differently. Indexed like Chunk::blockData().
+//
+// Only the LightEngine writes it, one task per Chunk at a time, holding
+// mutex() exclusively. Meshing reads it from other threads holding it shared.
+class ChunkLight {
+public:
+    ChunkLight();
+    ~ChunkLight();
+    ChunkLight(const ChunkLight&) = delete;
+    ChunkLight& operator=(const ChunkLight&) = delete;
+
+    uint8_t at(int index) const;
+    void set(int index, uint8_t light);
+    // The 16 blocks along x at (y, z)
+    void row(int y, int z, uint8_t* out) const;
+    void setRow(int y, int z, const uint8_t* in);
+    // Sets every block of the section to light and frees its storage
+    void fillSection(int section, uint8_t light);
+    // Sections with storage of their own
+    int allocatedSections() const;
+    std::shared_mutex& mutex() const { return writeMutex; }
+
+private:
+    struct Section {
+        std::array<uint8_t, SECTION_SIZE * SECTION_SIZE * SECTION_SIZE> levels;
+    };
+    // nullptr while the section is uniform
+    std::array<std::atomic<Section*>, SECTION_COUNT> sections;
+    std::array<std::atomic<uint8_t>, SECTION_COUNT> uniform;
+    mutable std::shared_mutex writeMutex;
+
+    // storage for a uniform section, filled with its light
+    Section* allocate(int section);
+    // x fastest, then y, then z, within the section
+    static int sectionIndex(int index) { return (index & 0xFF) | ((index >> 12) << 8); }
+};
+
+constexpr uint8_t packLight(int sky, int block) { return static_cast<uint8_t>((sky << 4) | block); }
+constexpr int skyLight(uint8_t light) { return light >> 4; }
+constexpr int blockLight(uint8_t light) { return light & 15; }
+
+// Copies of the blocks just outside a Chunk's four sides and four corners,
+// so it can be meshed on a worker while its neighbours are being edited. A
+// side or corner whose neighbour isn't generated falls back to createBlock.
+struct ChunkBorders {
+    // XPOS, XNEG, ZPOS, ZNEG; each slab is indexed along + 16 * y, where
+    // along is z for the x sides and x for the z sides
+    std::array<std::array<BlockType, 16 * 256>, 4> sides;
+    std::array<bool, 4> present{};
+    // the column diagonally past each corner, indexed by y: XPOS_ZPOS,
+    // XPOS_ZNEG, XNEG_ZPOS, XNEG_ZNEG. Only ambient occlusion reads these.
+    std::array<std::array<BlockType, 256>, 4> corners;
+    std::array<bool, 4> cornerPresent{};
+    // the light of the same blocks, indexed the same way
+    std::array<std::array<uint8_t, 16 * 256>, 4> sideLight;
+    std::array<std::array<uint8_t, 256>, 4> cornerLight;
+};
+
+// One bit per block of a section, set where the block is solid (opaque),
+// for collision tests that check a row of 16 blocks at a time. Bits go
+// x fastest, then z, then y, so each uint64_t holds four rows along x.
+struct SectionOccupancy {
+    std::array<uint64_t, SECTION_SIZE * SECTION_SIZE * SECTION_SIZE / 64> bits{};
+
+    // The 16 blocks along x at (y, z) within the section, bit x for block x
+    uint16_t row(int y, int z) const { return static_cast<uint16_t>(bits[y * 4 + z / 4] >> (16 * (z % 4))); }
+};
+
+// Lets us use any enum class as the key of a
+// std::unordered_map
+struct EnumHash {
+    template <typename T>
+    size_t operator()(T t) const {
+        return static_cast<size_t>(t);
+    }
+};
+
+// One Chunk is a 16 x 256 x 16 section of the world,
+// containing all the Minecraft blocks in that area.
+// We divide the world into Chunks in order to make
+// recomputing its VBO data faster by not having to
+// render all the world at once, while also not having
+// to render the world block by block.
+
+// Chunk is only the CPU side, blocks and mesh, so it builds without Vulkan
+// (see CMakeLists.txt). GpuChunk adds the buffer the renderer draws.
+class Chunk {
+private:
+    // All of the blocks contained within this Chunk
+    std::array<BlockType, 65536> m_blocks;
+    int minX, minZ;
+    // the solid blocks again, one bit each, for collision
+    std::array<SectionOccupancy, SECTION_COUNT> occupancy;
+    // sections that may hold solid blocks
+    uint16_t solidSectionMask;
+    // This Chunk's four neighbors to the north, south, east, and west
+    // The third input to this map just lets us use a Direction as
+    // a key for this map.
+    // These allow us to properly determine
+    std::vector<Vertex> vertexData;
+    std::vector<uint32_t> idxData;
+
+    // bytes of vertexData and idxData reported to the MemoryTracker
+    uint64_t meshBytes;
+    std::atomic<bool> generated;
+    // once generated, the simulation thread writes the blocks while the
+    // render thread and the workers copy them
+    mutable std::shared_mutex blocksMutex;
+
+    // flood fills the non-opaque blocks of one section to find which faces connect
+    static SectionVisibility computeSectionVisibility(const BlockType* blocks, int section);
+    void trackMeshBytes();
+public:
+    // Sizes of the mesh, kept after releaseMeshData()
+    int numIndices;
+    int vertexSize; 
+
+    // Only valid once the Chunk has a VertexBuffer
+    std::array<ChunkSection, SECTION_COUNT> sections;
+    // The translucent (water) faces, after every section's opaque indices.
+    // Drawn in their own pass, so they aren't split into sections.
+    uint32_t waterFirstIndex;
+    uint32_t waterIndexCount;
+    // Written by Terrain::cullSections, one bit per section reached this frame
+    uint32_t cullFrame;
+    uint16_t visibleSections;
+    // when the Chunk went through each step from generation to upload
+    ChunkLifecycle lifecycle;
+    // sky and block light, kept by the LightEngine
+    ChunkLight light;
+
+    Chunk() = delete;
+    Chunk(int x, int z);
+    // copies would report their blocks to the MemoryTracker twice
+    Chunk(const Chunk&) = delete;
+    Chunk& operator=(const Chunk&) = delete;
+    virtual ~Chunk();
+    // World-space x, z of the Chunk's lower-left corner
+    glm::ivec2 getOrigin() const { return glm::ivec2(minX, minZ); }
+    BlockType getBlockAt(unsigned int x, unsigned int y, unsigned int z) const;
+    BlockType getBlockAt(int x, int y, int z) const;
+    // Keeps the section's occupancy bits up to date too
+    void setBlockAt(unsigned int x, unsigned int y, unsigned int z, BlockType t);
+    // Where a block is in blockData(): x fastest, then y, then z
+    static constexpr int blockIndex(int x, int y, int z) { return x + 16 * y + 16 * 256 * z; }
+    // All of the blocks, for copying runs of them without bounds checks
+    const BlockType* blockData() const { return m_blocks.data(); }
+    BlockType* blockData() { return m_blocks.data(); }
+    // Recomputes the occupancy bits of the sections in the mask, after
+    // writing to blockData() directly
+    void updateOccupancy(uint16_t sections);
+    const SectionOccupancy& sectionOccupancy(int section) const { return occupancy[section]; }
+    uint16_t solidSections() const { return solidSectionMask; }
+    // Set once every block is filled in and lit, so other threads can tell
+    // when it is safe to read them
+    bool isGenerated() const { return generated.load(std::memory_order_acquire); }
+    void markGenerated() { generated.store(true, std::memory_order_release); }
+    // Held exclusively around writes to a generated Chunk's blocks, and
+    // shared around reads from any thread but the one that writes them
+    std::shared_mutex& blockMutex() const { return blocksMutex; }
+    // Meshes the whole Chunk into vertices() and indices(). Past its sides
+    // like meshSection.
+    void createVertexData(const ChunkBorders* borders = nullptr);
+    // Meshes one section of a Chunk at origin from a copy of its blocks
+    // (laid out like blockData()) and its light. Blocks and light past its
+    // sides come from borders, or createBlock and open sky above it where
+    // borders is nullptr or lacks that side.
+    static void meshSection(const BlockType* blocks, const ChunkLight& light, glm::ivec2 origin, int section,
+        const ChunkBorders* borders, SectionMesh& out);
+    // Fills borders from the neighbouring Chunks, nullptr where there is none
+    // (XPOS, XNEG, ZPOS, ZNEG, then XPOS_ZPOS, XPOS_ZNEG, XNEG_ZPOS, XNEG_ZNEG)
+    static void copyBorders(const std::array<const Chunk*, 8>& neighbours, ChunkBorders& borders);
+    // The mesh createVertexData built: vertices, then every section's opaque
+    // indices in order, then the water indices
+    const std::vector<Vertex>& vertices() const { return vertexData; }
+    const std::vector<uint32_t>& indices() const { return idxData; }
+    // Frees the mesh once it has been copied somewhere else
+    void releaseMeshData();
+};
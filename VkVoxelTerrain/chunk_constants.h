@@ -97,6 +97,7 @@ namespace ChunkConstants {
         { DIRT,  glm::vec4(0.5373f, 0.3176f, 0.0392f, 1.f) },
         { STONE, glm::vec4(0.27f, 0.3568f, 0.3804f, 1.f) },
         { WATER, glm::vec4(0.04706f, 0.3647f, 0.5216f, 1.f) },
+        { GLOWSTONE, glm::vec4(0.98f, 0.85f, 0.5f, 1.f) },
         /*{ SNOW, glm::vec4(1.f, 1.f, 1.f, 1.f) },
         { LAVA, glm::vec4(1.f, 0.4f, 0.f, 1.f) },
         { BEDROCK, glm::vec4(0.f, 0.f, 0.f, 1.f) },
@@ -129,6 +130,14 @@ namespace ChunkConstants {
 
         {{STONE, TOP},    glm::vec2(1, 0)},
         {{STONE, SIDE},   glm::vec2(1, 0)},
-        {{STONE, BOTTOM}, glm::vec2(1, 0)}
+        {{STONE, BOTTOM}, glm::vec2(1, 0)},
+
+        {{WATER, TOP},    glm::vec2(13, 12)},
+        {{WATER, SIDE},   glm::vec2(13, 12)},
+        {{WATER, BOTTOM}, glm::vec2(13, 12)},
+
+        {{GLOWSTONE, TOP},    glm::vec2(9, 6)},
+        {{GLOWSTONE, SIDE},   glm::vec2(9, 6)},
+        {{GLOWSTONE, BOTTOM}, glm::vec2(9, 6)}
     };
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "chunk_pipeline_stats.h"
+
+#include <chrono>
+
+int64_t ChunkLifecycle::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* ChunkPipelineStats::stageName(int stage) {
+    static const char* names[STAGE_COUNT] = {
+        "queued", "generate", "pending", "mesh queued", "mesh", "drawable", "upload"
+    };
+    return names[stage];
+}
+
+void ChunkPipelineStats::chunkVisible(const ChunkLifecycle& lifecycle) {
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        stages[stage].record(lifecycle.stamps[stage + 1] - lifecycle.stamps[stage]);
+    }
+    chunkVisibleTime.record(lifecycle.stamps[ChunkLifecycle::UPLOAD_END] - lifecycle.stamps[ChunkLifecycle::ENQUEUED]);
+}
+
+void ChunkPipelineStats::zoneVisible(int64_t enqueuedNs, int64_t visibleNs) {
+    zoneVisibleTime.record(visibleNs - enqueuedNs);
+}
+
+void ChunkPipelineStats::editVisible(int64_t editNs, int64_t meshStartNs, int64_t meshEndNs, int64_t visibleNs, int sections) {
+    editVisibleTime.record(visibleNs - editNs);
+    remeshTimes.record(meshEndNs - meshStartNs);
+    remeshedSections += sections;
+}
+
+void ChunkPipelineStats::reset() {
+    for (LatencyHistogram& histogram : stages) {
+        histogram.reset();
+    }
+    chunkVisibleTime.reset();
+    zoneVisibleTime.reset();
+    editVisibleTime.reset();
+    remeshTimes.reset();
+    remeshedSections = 0;
+}
+
+ChunkPipelineStats::Percentiles ChunkPipelineStats::percentiles(const LatencyHistogram& histogram) {
+    return { histogram.count(), histogram.percentileMs(0.5), histogram.percentileMs(0.95),
+        histogram.percentileMs(0.99), histogram.maxMs() };
+}
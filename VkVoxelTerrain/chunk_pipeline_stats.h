@@ -0,0 +1,98 @@
+#pragma once
+#include "latency_histogram.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// When a Chunk passed each step of the generate, mesh, upload pipeline, in
+// steady_clock nanoseconds. Each stamp is written by the one thread that
+// owns the Chunk at that point, and the queue handoffs between them order
+// the writes.
+struct ChunkLifecycle {
+    enum Event {
+        ENQUEUED,           // its zone entered the create radius
+        GENERATE_START,
+        GENERATE_END,       // pushed to pendingChunks
+        MESH_QUEUED,        // taken from pendingChunks, meshing enqueued
+        MESH_START,
+        MESH_END,           // pushed to drawableChunks
+        UPLOAD_START,       // taken from drawableChunks
+        UPLOAD_END,         // drawable
+        EVENT_COUNT
+    };
+    std::array<int64_t, EVENT_COUNT> stamps{};
+
+    static int64_t nowNs();
+    void stamp(Event event) { stamps[event] = nowNs(); }
+};
+
+// How many zones and Chunks are at each step of the pipeline right now
+struct ChunkQueueDepths {
+    int zonesQueued = 0;        // waiting in the thread pool for generation
+    int zonesGenerating = 0;
+    int chunksPending = 0;      // generated, waiting in pendingChunks
+    int chunksMeshQueued = 0;   // waiting in the thread pool for meshing
+    int chunksMeshing = 0;
+    int chunksDrawable = 0;     // meshed, waiting in drawableChunks for upload
+    int chunksRemeshing = 0;    // edited, being meshed again
+    int poolTasks = 0;          // everything queued on the thread pool, LOD and recording included
+};
+
+// Latency histograms of the chunk pipeline. One per stage, the time between
+// consecutive ChunkLifecycle events, plus end-to-end time to visible per
+// Chunk and per zone (once the last of its 16 Chunks is uploaded). Remeshes
+// after block edits are kept apart, from the edit to the new buffer.
+// Recorded and read on the main thread; the depth counters are updated
+// from the workers too.
+class ChunkPipelineStats {
+public:
+    enum Stage {
+        STAGE_QUEUED,       // ENQUEUED to GENERATE_START
+        STAGE_GENERATE,
+        STAGE_PENDING,
+        STAGE_MESH_QUEUED,
+        STAGE_MESH,
+        STAGE_DRAWABLE,
+        STAGE_UPLOAD,
+        STAGE_COUNT
+    };
+
+    struct Percentiles {
+        uint64_t count;
+        float p50, p95, p99, max;     // ms
+    };
+
+    static const char* stageName(int stage);
+
+    // Call once the Chunk is uploaded, with every stamp filled in
+    void chunkVisible(const ChunkLifecycle& lifecycle);
+    void zoneVisible(int64_t enqueuedNs, int64_t visibleNs);
+    // Call once an edited Chunk's new mesh is uploaded. editNs is the
+    // oldest edit it includes, and sections how many were meshed again.
+    void editVisible(int64_t editNs, int64_t meshStartNs, int64_t meshEndNs, int64_t visibleNs, int sections);
+    void reset();
+
+    Percentiles stage(int stage) const { return percentiles(stages[stage]); }
+    Percentiles chunkTimeToVisible() const { return percentiles(chunkVisibleTime); }
+    Percentiles zoneTimeToVisible() const { return percentiles(zoneVisibleTime); }
+    Percentiles editTimeToVisible() const { return percentiles(editVisibleTime); }
+    Percentiles remeshTime() const { return percentiles(remeshTimes); }
+    uint64_t sectionsRemeshed() const { return remeshedSections; }
+
+    std::atomic<int> zonesQueued{ 0 };
+    std::atomic<int> zonesGenerating{ 0 };
+    std::atomic<int> chunksMeshQueued{ 0 };
+    std::atomic<int> chunksMeshing{ 0 };
+    std::atomic<int> chunksRemeshing{ 0 };
+
+private:
+    static Percentiles percentiles(const LatencyHistogram& histogram);
+
+    std::array<LatencyHistogram, STAGE_COUNT> stages;
+    LatencyHistogram chunkVisibleTime;
+    LatencyHistogram zoneVisibleTime;
+    LatencyHistogram editVisibleTime;
+    LatencyHistogram remeshTimes;
+    uint64_t remeshedSections = 0;
+};
@@ -0,0 +1,109 @@
+#include "cooked_texture.h"
+
+#include <algorithm>
+#include <utility>
+
+CookedTexture::CookedTexture()
+    : file(), header(nullptr), levels(nullptr)
+{
+}
+
+CookedTexture::CookedTexture(CookedTexture&& other) noexcept
+    : CookedTexture()
+{
+    *this = std::move(other);
+}
+
+CookedTexture& CookedTexture::operator=(CookedTexture&& other) noexcept {
+    if (this != &other) {
+        // the mapping doesn't move, so the pointers into it stay valid
+        file = std::move(other.file);
+        header = std::exchange(other.header, nullptr);
+        levels = std::exchange(other.levels, nullptr);
+    }
+    return *this;
+}
+
+bool CookedTexture::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+
+    size_t size = file.size();
+    if (size < sizeof(TextureFileHeader)) {
+        close();
+        return false;
+    }
+    const TextureFileHeader* candidate = reinterpret_cast<const TextureFileHeader*>(file.data());
+    if (candidate->magic != TEXTURE_FILE_MAGIC || candidate->version != TEXTURE_FILE_VERSION
+        || candidate->format > TextureFormat::BC7 || candidate->width == 0 || candidate->height == 0
+        || candidate->mipLevels == 0 || candidate->mipLevels > 16
+        || size < sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * candidate->mipLevels) {
+        close();
+        return false;
+    }
+
+    // the levels have to be in order, contiguous, and inside the file
+    const TextureFileLevel* table = reinterpret_cast<const TextureFileLevel*>(file.data() + sizeof(TextureFileHeader));
+    uint64_t first = table[0].offset;
+    uint64_t end = first;
+    for (uint32_t i = 0; i < candidate->mipLevels; i++) {
+        const TextureFileLevel& level = table[i];
+        if (level.offset % TEXTURE_LEVEL_ALIGNMENT != 0 || level.offset < end
+            || level.width != std::max(1u, candidate->width >> i) || level.height != std::max(1u, candidate->height >> i)
+            || level.size != textureLevelBytes(candidate->format, level.width, level.height)) {
+            close();
+            return false;
+        }
+        end = level.offset + level.size;
+    }
+    if (end - first > candidate->dataSize || first + candidate->dataSize > size) {
+        close();
+        return false;
+    }
+
+    header = candidate;
+    levels = table;
+    return true;
+}
+
+void CookedTexture::close() {
+    file.close();
+    header = nullptr;
+    levels = nullptr;
+}
+
+VkFormat CookedTexture::format() const {
+    bool srgb = header->srgb != 0;
+    switch (header->format) {
+    case TextureFormat::BC1: return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case TextureFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    default: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+const char* CookedTexture::formatName() const {
+    switch (header->format) {
+    case TextureFormat::BC1: return "BC1";
+    case TextureFormat::BC7: return "BC7";
+    default: return "RGBA8";
+    }
+}
+
+std::vector<VkBufferImageCopy> CookedTexture::copyRegions() const {
+    std::vector<VkBufferImageCopy> regions(header->mipLevels);
+    for (uint32_t i = 0; i < header->mipLevels; i++) {
+        VkBufferImageCopy& region = regions[i];
+        region.bufferOffset = levels[i].offset - levels[0].offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = i;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { levels[i].width, levels[i].height, 1 };
+    }
+    return regions;
+}
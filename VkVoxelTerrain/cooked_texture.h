@@ -0,0 +1,39 @@
+#pragma once
+#include "globals.h"
+#include "mapped_file.h"
+#include "texture_container.h"
+
+#include <string>
+
+// A cooked .vtex texture, memory-mapped and checked against the layout in
+// texture_container.h. The level data can be copied into a staging buffer as
+// it is, and copyRegions() then places every mip level with a single
+// vkCmdCopyBufferToImage.
+class CookedTexture {
+public:
+    CookedTexture();
+    CookedTexture(CookedTexture&& other) noexcept;
+    CookedTexture& operator=(CookedTexture&& other) noexcept;
+
+    // Returns false if the file is missing or malformed
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    VkFormat format() const;
+    const char* formatName() const;
+    uint32_t width() const { return header->width; }
+    uint32_t height() const { return header->height; }
+    uint32_t mipLevels() const { return header->mipLevels; }
+
+    // Every level, from the start of the first to the end of the last
+    const uint8_t* levelData() const { return file.data() + levels[0].offset; }
+    VkDeviceSize levelDataSize() const { return header->dataSize; }
+    // Regions for a buffer that holds levelData() at offset 0
+    std::vector<VkBufferImageCopy> copyRegions() const;
+
+private:
+    MappedFile file;
+    const TextureFileHeader* header;
+    const TextureFileLevel* levels;
+};
@@ -0,0 +1,121 @@
+#include "edit_batch.h"
+#include "terrain_util.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <mutex>
+
+EditBatch::EditBatch()
+    : chunks(), lastKey(INT64_MIN), last(nullptr), blockCount(0)
+{
+}
+
+EditBatch::ChunkEdits& EditBatch::chunkAt(int x, int z) {
+    int64_t key = toKey(x, z);
+    if (last == nullptr || key != lastKey) {
+        // references to unordered_map elements survive rehashing
+        last = &chunks[key];
+        lastKey = key;
+    }
+    return *last;
+}
+
+void EditBatch::addRow(ChunkEdits& edits, int x, int y, int z, int length, BlockType type) {
+    uint32_t index = static_cast<uint32_t>(Chunk::blockIndex(x, y, z));
+    if (!edits.runs.empty() && edits.runs.back().type == type
+        && edits.runs.back().index + edits.runs.back().length == index) {
+        edits.runs.back().length += length;
+    }
+    else {
+        edits.runs.push_back({ index, static_cast<uint32_t>(length), type });
+    }
+
+    int section = y / SECTION_SIZE;
+    glm::ivec3 lo(x, y, z), hi(x + length - 1, y, z);
+    if (edits.sections & (1 << section)) {
+        edits.sectionMin[section] = glm::min(edits.sectionMin[section], lo);
+        edits.sectionMax[section] = glm::max(edits.sectionMax[section], hi);
+    }
+    else {
+        edits.sections |= 1 << section;
+        edits.sectionMin[section] = lo;
+        edits.sectionMax[section] = hi;
+    }
+    blockCount += length;
+}
+
+void EditBatch::set(const glm::ivec3& position, BlockType type) {
+    if (position.y < 0 || position.y >= 256) {
+        return;
+    }
+    // & ~15 floors to the Chunk's corner, negatives included
+    int x0 = position.x & ~15;
+    int z0 = position.z & ~15;
+    addRow(chunkAt(x0, z0), position.x - x0, position.y, position.z - z0, 1, type);
+}
+
+void EditBatch::fill(const glm::ivec3& min, const glm::ivec3& max, BlockType type) {
+    int yLo = std::max(min.y, 0);
+    int yHi = std::min(max.y, 255);
+    if (max.x < min.x || yHi < yLo || max.z < min.z) {
+        return;
+    }
+    for (int z0 = min.z & ~15; z0 <= max.z; z0 += 16) {
+        for (int x0 = min.x & ~15; x0 <= max.x; x0 += 16) {
+            ChunkEdits& edits = chunkAt(x0, z0);
+            int xLo = std::max(min.x, x0) - x0, xHi = std::min(max.x, x0 + 15) - x0;
+            int zLo = std::max(min.z, z0) - z0, zHi = std::min(max.z, z0 + 15) - z0;
+            // rows the width of the Chunk follow each other in memory, so
+            // they merge into one run per slab, or per Chunk
+            for (int z = zLo; z <= zHi; z++) {
+                for (int y = yLo; y <= yHi; y++) {
+                    addRow(edits, xLo, y, z, xHi - xLo + 1, type);
+                }
+            }
+        }
+    }
+}
+
+size_t EditBatch::runCount() const {
+    size_t runs = 0;
+    for (const auto& [key, edits] : chunks) {
+        runs += edits.runs.size();
+    }
+    return runs;
+}
+
+void EditBatch::clear() {
+    chunks.clear();
+    last = nullptr;
+    lastKey = INT64_MIN;
+    blockCount = 0;
+}
+
+size_t EditBatch::apply(const ChunkLookup& lookup, const TouchedSection& touched) const {
+    size_t written = 0;
+    for (const auto& [key, edits] : chunks) {
+        glm::ivec2 origin = toCoords(key);
+        Chunk* chunk = lookup(origin.x, origin.y);
+        if (chunk == nullptr) {
+            continue;
+        }
+        {
+            std::unique_lock<std::shared_mutex> lock(chunk->blockMutex());
+            BlockType* blocks = chunk->blockData();
+            for (const Run& run : edits.runs) {
+                std::memset(blocks + run.index, run.type, run.length);
+                written += run.length;
+            }
+            chunk->updateOccupancy(edits.sections);
+        }
+
+        glm::ivec3 corner(origin.x, 0, origin.y);
+        for (int section = 0; section < SECTION_COUNT; section++) {
+            if (edits.sections & (1 << section)) {
+                touched(corner + edits.sectionMin[section], corner + edits.sectionMax[section]);
+            }
+        }
+    }
+    return written;
+}
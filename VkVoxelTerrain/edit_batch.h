@@ -0,0 +1,70 @@
+#pragma once
+#include "glm_includes.h"
+#include "chunk.h"
+#include "block_access.h"
+
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Collects block edits (an explosion, a structure, a fill tool) so they can
+// be written all at once instead of one Terrain::setBlockAt each. Edits are
+// grouped by Chunk as runs of consecutive blocks in blockData() order, and
+// neighbouring runs of the same type merge, so a box or a row of a sphere
+// is written with a few memsets. Each Chunk is looked up once when the batch
+// is applied, and each section it touches is reported once, so it is
+// remeshed once however many of its blocks changed.
+//
+// Later edits to a block win over earlier ones. Edits above or below the
+// world are dropped when they are added.
+class EditBatch {
+public:
+    EditBatch();
+
+    void set(const glm::ivec3& position, BlockType type);
+    // Every block in the box from min to max, both included
+    void fill(const glm::ivec3& min, const glm::ivec3& max, BlockType type);
+
+    bool empty() const { return chunks.empty(); }
+    // Blocks edited, a block edited twice counting twice
+    size_t size() const { return blockCount; }
+    size_t chunkCount() const { return chunks.size(); }
+    // Runs over all the Chunks, what apply will memset
+    size_t runCount() const;
+    void clear();
+
+    // Writes the edits into the Chunks the lookup finds, one lookup per
+    // Chunk, and drops the ones to Chunks it doesn't. Then calls touched
+    // once per section written with the box of blocks it wrote there, in
+    // world space. Returns how many blocks were written, like size().
+    using TouchedSection = std::function<void(const glm::ivec3& min, const glm::ivec3& max)>;
+    size_t apply(const ChunkLookup& lookup, const TouchedSection& touched) const;
+
+private:
+    // length blocks from index on in blockData() order
+    struct Run {
+        uint32_t index;
+        uint32_t length;
+        BlockType type;
+    };
+    struct ChunkEdits {
+        std::vector<Run> runs;
+        // one bit per section with edits, and the box of them in Chunk
+        // coordinates, only valid where the bit is set
+        uint16_t sections = 0;
+        std::array<glm::ivec3, SECTION_COUNT> sectionMin;
+        std::array<glm::ivec3, SECTION_COUNT> sectionMax;
+    };
+
+    // by toKey of the Chunk's corner
+    std::unordered_map<int64_t, ChunkEdits> chunks;
+    // the ChunkEdits of the last edit, as edits tend to come in order
+    int64_t lastKey;
+    ChunkEdits* last;
+    size_t blockCount;
+
+    ChunkEdits& chunkAt(int x, int z);
+    // Adds a run along x in one row of a Chunk, from local (x, y, z)
+    void addRow(ChunkEdits& edits, int x, int y, int z, int length, BlockType type);
+};
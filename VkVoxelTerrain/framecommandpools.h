@@ -0,0 +1,91 @@
+#pragma once
+
+#include "globals.h"
+#include <vector>
+#include <stdexcept>
+
+// FrameCommandPools hands out secondary command buffers for parallel recording.
+// There is one command pool per (frame in flight, slot), where a slot is owned by
+// exactly one recording thread for the duration of a frame, so no pool is ever
+// touched by two threads at once. A frame's pools are reset together once its
+// fence has signalled, and the command buffers they own are reused.
+class FrameCommandPools {
+public:
+    FrameCommandPools() :
+        frames{}, device{VK_NULL_HANDLE}
+    {
+    }
+
+    void init(VkDevice device, uint32_t queueFamilyIndex, size_t slotCount)
+    {
+        this->device = device;
+        frames.resize(MAX_FRAMES_IN_FLIGHT);
+
+        for (auto& slots : frames) {
+            slots.resize(slotCount);
+            for (Slot& slot : slots) {
+                VkCommandPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                poolInfo.queueFamilyIndex = queueFamilyIndex;
+                poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+                if (vkCreateCommandPool(device, &poolInfo, nullptr, &slot.pool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create secondary command pool!");
+                }
+            }
+        }
+    }
+
+    // Only call once the frame's previous submission has completed
+    void resetFrame(uint32_t frame)
+    {
+        for (Slot& slot : frames[frame]) {
+            vkResetCommandPool(device, slot.pool, 0);
+            slot.used = 0;
+        }
+    }
+
+    // Returns a secondary command buffer from the slot's pool, ready to begin
+    VkCommandBuffer acquire(uint32_t frame, size_t slotIndex)
+    {
+        Slot& slot = frames[frame][slotIndex];
+        if (slot.used == slot.buffers.size()) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = slot.pool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer cmdBuffer;
+            if (vkAllocateCommandBuffers(device, &allocInfo, &cmdBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+            }
+            slot.buffers.push_back(cmdBuffer);
+        }
+        return slot.buffers[slot.used++];
+    }
+
+    size_t slotCount() const {
+        return frames.empty() ? 0 : frames[0].size();
+    }
+
+    void cleanup() {
+        for (auto& slots : frames) {
+            for (Slot& slot : slots) {
+                // destroying the pool frees its command buffers
+                vkDestroyCommandPool(device, slot.pool, nullptr);
+            }
+        }
+        frames.clear();
+    }
+
+private:
+    struct Slot {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        size_t used = 0;
+    };
+
+    std::vector<std::vector<Slot>> frames;
+    VkDevice device;
+};
@@ -0,0 +1,78 @@
+#include "gpu_chunk.h"
+#include "vulkan_resources.h"
+#include "types.h"
+
+#include <cstring>
+
+GpuChunk::GpuChunk(int x, int z)
+    : Chunk(x, z), VertexBuffer(VK_NULL_HANDLE), VertexBufferMemory(VK_NULL_HANDLE), bufferSize(0), missingNeighbours(0)
+{
+}
+
+// Copies vertices then indices into a new device local buffer, through a
+// staging buffer, and waits for the copy
+static VkDeviceSize uploadMesh(const std::vector<Vertex>& vertexData, const std::vector<uint32_t>& idxData,
+    VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkCommandPool commandPool, VkQueue queue,
+    VkBuffer& buffer, VkDeviceMemory& memory)
+{
+    VkDeviceSize bufferSize = (sizeof(Vertex) * vertexData.size()) + (sizeof(uint32_t) * idxData.size()); 
+
+    // create a staging buffer
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(device, physicalDevice, surface, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory,
+        MemoryTracker::DEVICE_STAGING);
+
+    // copy to staging
+    void* data;
+    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, vertexData.data(), vertexData.size() * sizeof(Vertex));
+    memcpy(static_cast<char*>(data) + (sizeof(Vertex) * vertexData.size()),
+        idxData.data(),
+        idxData.size() * sizeof(uint32_t));
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    // create device bufferand copy to buffer
+    createBuffer(device, physicalDevice, surface, bufferSize, 
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory, MemoryTracker::DEVICE_CHUNK_BUFFERS);
+    copyBuffer(device, commandPool, queue, stagingBuffer, buffer, bufferSize);
+
+    // destroy staging buffer
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    freeDeviceMemory(device, stagingBufferMemory);
+    return bufferSize;
+}
+
+void GpuChunk::createVkBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
+    VkSurfaceKHR surface, VkCommandPool commandPool, VkQueue queue)
+{
+    bufferSize = uploadMesh(vertices(), indices(), device, physicalDevice, surface, commandPool, queue,
+        VertexBuffer, VertexBufferMemory);
+
+    // flush vertex data on cpu
+    releaseMeshData();
+}
+
+void GpuChunk::swapMesh(const ChunkMesh& mesh, VkDevice device, VkPhysicalDevice physicalDevice,
+    VkSurfaceKHR surface, VkCommandPool commandPool, VkQueue queue,
+    VkBuffer& oldBuffer, VkDeviceMemory& oldMemory)
+{
+    VkBuffer newBuffer;
+    VkDeviceMemory newMemory;
+    // copyBuffer waits for the transfer, so the new buffer is complete
+    // before anything is recorded against it
+    VkDeviceSize newSize = uploadMesh(mesh.vertices, mesh.indices, device, physicalDevice, surface, commandPool, queue,
+        newBuffer, newMemory);
+
+    oldBuffer = VertexBuffer;
+    oldMemory = VertexBufferMemory;
+    VertexBuffer = newBuffer;
+    VertexBufferMemory = newMemory;
+    bufferSize = newSize;
+    sections = mesh.sections;
+    waterFirstIndex = mesh.waterFirstIndex;
+    waterIndexCount = mesh.waterIndexCount;
+    vertexSize = static_cast<int>(mesh.vertices.size());
+    numIndices = static_cast<int>(mesh.indices.size());
+}
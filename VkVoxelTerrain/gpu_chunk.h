@@ -0,0 +1,27 @@
+#pragma once
+#include "globals.h"
+#include "chunk.h"
+
+// A Chunk with the device buffer the renderer draws it from
+class GpuChunk : public Chunk {
+public:
+    // Contains both vertex and index data
+    VkBuffer VertexBuffer;
+    VkDeviceMemory VertexBufferMemory;
+    VkDeviceSize bufferSize; 
+    // The neighbours, one bit each in Chunk::copyBorders' order, that weren't
+    // generated when the first mesh was built, so it is remeshed once they
+    // are. Only touched under Terrain's m_chunks_mutex.
+    uint8_t missingNeighbours;
+
+    GpuChunk(int x, int z);
+    // Uploads the mesh and frees the CPU copy
+    void createVkBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
+        VkSurfaceKHR surface, VkCommandPool commandPool, VkQueue queue);
+    // Uploads a remeshed mesh into a new buffer and switches the Chunk over
+    // to it, sections and water range included, once the copy has finished.
+    // The old buffer is handed back, since frames in flight may still draw it.
+    void swapMesh(const ChunkMesh& mesh, VkDevice device, VkPhysicalDevice physicalDevice,
+        VkSurfaceKHR surface, VkCommandPool commandPool, VkQueue queue,
+        VkBuffer& oldBuffer, VkDeviceMemory& oldMemory);
+};
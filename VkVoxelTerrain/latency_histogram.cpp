@@ -0,0 +1,62 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+    : counts(), total(0), maxUs(0)
+{
+}
+
+int LatencyHistogram::bucketOf(uint64_t us) {
+    if (us < SUB_BUCKETS) {
+        return static_cast<int>(us);
+    }
+    int msb = 63;
+    while (!(us >> msb)) {
+        msb--;
+    }
+    // keep the top SUB_BITS bits: the leading one and SUB_BITS - 1 below it
+    int shift = msb - SUB_BITS + 1;
+    uint64_t top = us >> shift;
+    int bucket = static_cast<int>(SUB_BUCKETS + (shift - 1) * (SUB_BUCKETS / 2) + (top - SUB_BUCKETS / 2));
+    return std::min(bucket, BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucketHighUs(int bucket) {
+    if (bucket < static_cast<int>(SUB_BUCKETS)) {
+        return bucket;
+    }
+    int offset = bucket - static_cast<int>(SUB_BUCKETS);
+    int shift = offset / static_cast<int>(SUB_BUCKETS / 2) + 1;
+    uint64_t top = offset % (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    uint64_t us = ns > 0 ? static_cast<uint64_t>(ns / 1000) : 0;
+    counts[bucketOf(us)]++;
+    total++;
+    maxUs = std::max(maxUs, us);
+}
+
+void LatencyHistogram::reset() {
+    counts.fill(0);
+    total = 0;
+    maxUs = 0;
+}
+
+float LatencyHistogram::percentileMs(double p) const {
+    if (total == 0) {
+        return 0.f;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * total)));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return std::min(bucketHighUs(bucket), maxUs) / 1000.f;
+        }
+    }
+    return maxMs();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// A histogram of durations in the style of HdrHistogram: buckets are
+// linear within each power of two, so every value is kept to within 1/16
+// (6%) from a microsecond up to days, in a fixed 2.4 KB. Percentiles report
+// the top of their bucket, so they round up, never down. Not thread safe.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;     // per power of two
+    static constexpr int MAX_BITS = 40;                         // 2^40 us, about 12 days
+    static constexpr int BUCKETS = SUB_BUCKETS + (MAX_BITS - SUB_BITS) * (SUB_BUCKETS / 2);
+
+    LatencyHistogram();
+
+    void record(int64_t ns);
+    void reset();
+
+    uint64_t count() const { return total; }
+    // The smallest value that p (0 to 1) of the recorded values don't exceed,
+    // to within a bucket. 0 when empty.
+    float percentileMs(double p) const;
+    float maxMs() const { return maxUs / 1000.f; }
+
+private:
+    static int bucketOf(uint64_t us);
+    // the largest value that lands in the bucket
+    static uint64_t bucketHighUs(int bucket);
+
+    std::array<uint32_t, BUCKETS> counts;
+    uint64_t total;
+    uint64_t maxUs;
+};
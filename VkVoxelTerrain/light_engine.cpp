@@ -0,0 +1,655 @@
+#include "light_engine.h"
+#include "terrain_util.h"
+#include "trace_recorder.h"
+
+#include <algorithm>
+#include <mutex>
+
+// the two kinds of light, and where each sits in a packed light byte
+enum LightChannel { SKY, BLOCK };
+
+static int levelOf(uint8_t light, int channel) {
+    return channel == SKY ? skyLight(light) : blockLight(light);
+}
+
+static uint8_t withLevel(uint8_t light, int channel, int level) {
+    return channel == SKY ? static_cast<uint8_t>((light & 0x0F) | (level << 4)) : static_cast<uint8_t>((light & 0xF0) | level);
+}
+
+// Chunk::blockIndex offsets of the six directions, in Direction order
+static const int directionStep[6] = { 1, -1, 16, -16, 16 * 256, -16 * 256 };
+
+// The block next to index in the direction: its index in the same Chunk,
+// or -1 with side set to the neighbour it is in (XPOS, XNEG, ZPOS, ZNEG),
+// or -1 with side -1 above or below the world
+static int stepIndex(int index, int direction, int& side) {
+    const int x = index & 15, y = (index >> 4) & 255, z = index >> 12;
+    side = -1;
+    switch (direction) {
+    case XPOS: if (x == 15) { side = 0; return -1; } break;
+    case XNEG: if (x == 0) { side = 1; return -1; } break;
+    case YPOS: if (y == 255) { return -1; } break;
+    case YNEG: if (y == 0) { return -1; } break;
+    case ZPOS: if (z == 15) { side = 2; return -1; } break;
+    case ZNEG: if (z == 0) { side = 3; return -1; } break;
+    }
+    return index + directionStep[direction];
+}
+
+// The index, in the neighbour on the side, of the block across from index
+static uint16_t acrossIndex(int index, int side) {
+    static const int offsets[4] = { -15, 15, -15 * 16 * 256, 15 * 16 * 256 };
+    return static_cast<uint16_t>(index + offsets[side]);
+}
+
+// One thread's copy of the light of the Chunk it is working on, the fill
+// queues, and what changed, reused from task to task
+struct LightWork {
+    std::array<uint8_t, 65536> light;
+    std::array<std::vector<int>, 2> adds;
+    std::array<std::vector<std::pair<int, int>>, 2> removals;
+    // sections changed, and the box of blocks changed in each
+    uint16_t changed;
+    std::array<glm::ivec3, SECTION_COUNT> changedMin;
+    std::array<glm::ivec3, SECTION_COUNT> changedMax;
+    uint64_t changedCells;
+    // the neighbours' light along each side, as addChunk read it
+    std::array<std::array<uint8_t, 16 * 256>, 4> sideLight;
+
+    void reset() {
+        for (int channel = SKY; channel <= BLOCK; channel++) {
+            adds[channel].clear();
+            removals[channel].clear();
+        }
+        changed = 0;
+        changedCells = 0;
+    }
+
+    void set(int index, int channel, int level) {
+        light[index] = withLevel(light[index], channel, level);
+        changedCells++;
+        glm::ivec3 block(index & 15, (index >> 4) & 255, index >> 12);
+        int section = block.y / SECTION_SIZE;
+        if (changed & (1 << section)) {
+            changedMin[section] = glm::min(changedMin[section], block);
+            changedMax[section] = glm::max(changedMax[section], block);
+        }
+        else {
+            changed |= 1 << section;
+            changedMin[section] = block;
+            changedMax[section] = block;
+        }
+    }
+
+    // Raises the block to level if that is brighter, queuing it to spread
+    void raise(int index, int channel, int level) {
+        if (level > levelOf(light[index], channel)) {
+            set(index, channel, level);
+            adds[channel].push_back(index);
+        }
+    }
+
+    void load(const ChunkLight& chunkLight) {
+        for (int z = 0; z < 16; z++) {
+            for (int y = 0; y < 256; y++) {
+                chunkLight.row(y, z, light.data() + Chunk::blockIndex(0, y, z));
+            }
+        }
+    }
+
+    // Copies the changed rows back into the Chunk
+    void store(ChunkLight& chunkLight) const {
+        for (int section = 0; section < SECTION_COUNT; section++) {
+            if (!(changed & (1 << section))) {
+                continue;
+            }
+            for (int z = changedMin[section].z; z <= changedMax[section].z; z++) {
+                for (int y = changedMin[section].y; y <= changedMax[section].y; y++) {
+                    chunkLight.setRow(y, z, light.data() + Chunk::blockIndex(0, y, z));
+                }
+            }
+        }
+    }
+
+    // Spreads the queued light through the Chunk, sending what reaches a
+    // side to that neighbour
+    void spread(const BlockType* blocks, int channel, LightEngine::Outbox& outbox);
+    // Darkens everything lit from the queued removals, queuing the blocks
+    // lit from elsewhere at the edge of the darkened area to spread again
+    void unspread(const BlockType* blocks, int channel, LightEngine::Outbox& outbox);
+    // Handles a run of messages: darkens, relights and spreads
+    void apply(const BlockType* blocks, const LightEngine::Message* first, const LightEngine::Message* last,
+        LightEngine::Outbox& outbox);
+};
+
+static thread_local LightWork work;
+
+void LightWork::spread(const BlockType* blocks, int channel, LightEngine::Outbox& outbox) {
+    std::vector<int>& queue = adds[channel];
+    const LightEngine::MessageKind kind = channel == SKY ? LightEngine::ADD_SKY : LightEngine::ADD_BLOCK;
+    for (size_t head = 0; head < queue.size(); head++) {
+        const int index = queue[head];
+        const int level = levelOf(light[index], channel);
+        if (level <= 1) {
+            continue;
+        }
+        for (int direction = 0; direction < 6; direction++) {
+            int side;
+            int next = stepIndex(index, direction, side);
+            if (next < 0) {
+                if (side >= 0) {
+                    outbox[side].push_back({ acrossIndex(index, side), 0, kind, static_cast<uint8_t>(level - 1) });
+                }
+                continue;
+            }
+            BlockType block = blocks[next];
+            if (isOpaque(block)) {
+                continue;
+            }
+            // full sky light falls through air without fading
+            bool skyColumn = channel == SKY && direction == YNEG && level == 15 && block == EMPTY;
+            raise(next, channel, skyColumn ? 15 : level - 1);
+        }
+    }
+    queue.clear();
+}
+
+void LightWork::unspread(const BlockType* blocks, int channel, LightEngine::Outbox& outbox) {
+    std::vector<std::pair<int, int>>& queue = removals[channel];
+    const LightEngine::MessageKind kind = channel == SKY ? LightEngine::REMOVE_SKY : LightEngine::REMOVE_BLOCK;
+    for (size_t head = 0; head < queue.size(); head++) {
+        const auto [index, level] = queue[head];
+        for (int direction = 0; direction < 6; direction++) {
+            int side;
+            int next = stepIndex(index, direction, side);
+            if (next < 0) {
+                if (side >= 0) {
+                    outbox[side].push_back({ acrossIndex(index, side), 0, kind, static_cast<uint8_t>(level) });
+                }
+                continue;
+            }
+            int current = levelOf(light[next], channel);
+            if (current == 0) {
+                continue;
+            }
+            // dimmer than the removed light, or full sky light that fell
+            // from it, so it was lit from here
+            bool skyColumn = channel == SKY && direction == YNEG && level == 15 && current == 15;
+            if (current < level || skyColumn) {
+                set(next, channel, 0);
+                queue.push_back({ next, current });
+                int emission = channel == BLOCK ? lightEmission(blocks[next]) : 0;
+                if (emission > 0) {
+                    raise(next, channel, emission);
+                }
+            }
+            else {
+                adds[channel].push_back(next);
+            }
+        }
+    }
+    queue.clear();
+}
+
+void LightWork::apply(const BlockType* blocks, const LightEngine::Message* first, const LightEngine::Message* last,
+    LightEngine::Outbox& outbox)
+{
+    // Darken first: the changed blocks, and whatever the neighbours lost
+    std::vector<std::pair<glm::ivec3, glm::ivec3>> relights;
+    for (const LightEngine::Message* message = first; message != last; message++) {
+        if (message->kind == LightEngine::RELIGHT) {
+            glm::ivec3 lo(message->index & 15, (message->index >> 4) & 255, message->index >> 12);
+            glm::ivec3 hi(message->other & 15, (message->other >> 4) & 255, message->other >> 12);
+            relights.push_back({ lo, hi });
+            for (int z = lo.z; z <= hi.z; z++) {
+                for (int y = lo.y; y <= hi.y; y++) {
+                    for (int x = lo.x; x <= hi.x; x++) {
+                        int index = Chunk::blockIndex(x, y, z);
+                        for (int channel = SKY; channel <= BLOCK; channel++) {
+                            int level = levelOf(light[index], channel);
+                            if (level > 0) {
+                                set(index, channel, 0);
+                                removals[channel].push_back({ index, level });
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        else if (message->kind == LightEngine::REMOVE_SKY || message->kind == LightEngine::REMOVE_BLOCK) {
+            int channel = message->kind == LightEngine::REMOVE_SKY ? SKY : BLOCK;
+            int current = levelOf(light[message->index], channel);
+            if (current > 0 && current < message->level) {
+                set(message->index, channel, 0);
+                removals[channel].push_back({ message->index, current });
+                if (channel == BLOCK && lightEmission(blocks[message->index]) > 0) {
+                    raise(message->index, channel, lightEmission(blocks[message->index]));
+                }
+            }
+            else if (current > 0) {
+                adds[channel].push_back(message->index);
+            }
+        }
+    }
+    unspread(blocks, SKY, outbox);
+    unspread(blocks, BLOCK, outbox);
+
+    // Then light the changed blocks again from their emitters, the sky, and
+    // everything around them
+    for (const auto& [lo, hi] : relights) {
+        for (int z = lo.z; z <= hi.z; z++) {
+            for (int y = lo.y; y <= hi.y; y++) {
+                for (int x = lo.x; x <= hi.x; x++) {
+                    int index = Chunk::blockIndex(x, y, z);
+                    if (lightEmission(blocks[index]) > 0) {
+                        raise(index, BLOCK, lightEmission(blocks[index]));
+                    }
+                    if (y == 255 && !isOpaque(blocks[index])) {
+                        raise(index, SKY, 15);
+                    }
+                    for (int direction = 0; direction < 6; direction++) {
+                        int side;
+                        int next = stepIndex(index, direction, side);
+                        if (next >= 0) {
+                            glm::ivec3 n(next & 15, (next >> 4) & 255, next >> 12);
+                            bool inside = n.x >= lo.x && n.x <= hi.x && n.y >= lo.y && n.y <= hi.y && n.z >= lo.z && n.z <= hi.z;
+                            if (!inside) {
+                                adds[SKY].push_back(next);
+                                adds[BLOCK].push_back(next);
+                            }
+                        }
+                        else if (side >= 0) {
+                            // the neighbour sends its light across in reply
+                            outbox[side].push_back({ acrossIndex(index, side), 0, LightEngine::PULL, static_cast<uint8_t>(side ^ 1) });
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (const LightEngine::Message* message = first; message != last; message++) {
+        if (message->kind == LightEngine::ADD_SKY || message->kind == LightEngine::ADD_BLOCK) {
+            if (!isOpaque(blocks[message->index])) {
+                raise(message->index, message->kind == LightEngine::ADD_SKY ? SKY : BLOCK, message->level);
+            }
+        }
+    }
+    spread(blocks, SKY, outbox);
+    spread(blocks, BLOCK, outbox);
+
+    for (const LightEngine::Message* message = first; message != last; message++) {
+        if (message->kind == LightEngine::PULL) {
+            uint8_t current = light[message->index];
+            uint16_t across = acrossIndex(message->index, message->level);
+            if (skyLight(current) > 1) {
+                outbox[message->level].push_back({ across, 0, LightEngine::ADD_SKY, static_cast<uint8_t>(skyLight(current) - 1) });
+            }
+            if (blockLight(current) > 1) {
+                outbox[message->level].push_back({ across, 0, LightEngine::ADD_BLOCK, static_cast<uint8_t>(blockLight(current) - 1) });
+            }
+        }
+    }
+}
+
+LightEngine::LightEngine(ThreadPool& pool)
+    : pool(pool), listener(), stopped(false), states(), statesMutex(), busyStates(0), busyMutex(), idle(),
+    taskCount(0), messageCount(0), changedCount(0)
+{
+}
+
+LightEngine::~LightEngine() {
+}
+
+void LightEngine::setChangeListener(ChangeListener changeListener) {
+    listener = std::move(changeListener);
+}
+
+void LightEngine::enterBusy() {
+    std::lock_guard<std::mutex> lock(busyMutex);
+    busyStates++;
+}
+
+void LightEngine::leaveBusy() {
+    std::lock_guard<std::mutex> lock(busyMutex);
+    if (--busyStates == 0) {
+        idle.notify_all();
+    }
+}
+
+void LightEngine::post(ChunkState& state, std::vector<Message>& messages) {
+    if (messages.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.inbox.insert(state.inbox.end(), messages.begin(), messages.end());
+    messages.clear();
+    if (!state.queued && !state.running && !stopped) {
+        state.queued = true;
+        enterBusy();
+        // ahead of generation, like remeshes, so edits light up quickly
+        pool.enqueuePriority(&LightEngine::run, this, &state);
+    }
+}
+
+void LightEngine::claim(ChunkState& state) {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.released.wait(lock, [&state] { return !state.running; });
+    if (!state.queued) {
+        enterBusy();
+    }
+    state.running = true;
+}
+
+void LightEngine::release(ChunkState& state) {
+    bool nowIdle;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.running = false;
+        if (!state.inbox.empty() && !state.queued && !stopped) {
+            state.queued = true;
+            pool.enqueuePriority(&LightEngine::run, this, &state);
+        }
+        nowIdle = !state.queued;
+        state.released.notify_all();
+    }
+    // last, as waitIdle may return and the engine go away right after
+    if (nowIdle) {
+        leaveBusy();
+    }
+}
+
+void LightEngine::run(ChunkState* state) {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->queued = false;
+    // whoever holds it handles the inbox when they let go
+    if (state->running || stopped) {
+        bool nowIdle = !state->running;
+        lock.unlock();
+        if (nowIdle) {
+            leaveBusy();
+        }
+        return;
+    }
+    state->running = true;
+    while (!state->inbox.empty() && !stopped) {
+        std::vector<Message> messages;
+        messages.swap(state->inbox);
+        lock.unlock();
+        process(*state, messages);
+        lock.lock();
+    }
+    state->running = false;
+    state->released.notify_all();
+    lock.unlock();
+    leaveBusy();
+}
+
+void LightEngine::send(ChunkState& state, Outbox& outbox) {
+    for (int side = 0; side < 4; side++) {
+        ChunkState* neighbour = state.neighbours[side].load(std::memory_order_acquire);
+        if (neighbour != nullptr) {
+            post(*neighbour, outbox[side]);
+        }
+        outbox[side].clear();
+    }
+}
+
+void LightEngine::addChunk(Chunk& chunk) {
+    TRACE_SCOPE("light chunk", "light", chunk.getOrigin().x, chunk.getOrigin().y);
+    const glm::ivec2 origin = chunk.getOrigin();
+    auto owned = mkU<ChunkState>();
+    ChunkState& state = *owned;
+    state.chunk = &chunk;
+    state.origin = origin;
+    for (auto& neighbour : state.neighbours) {
+        neighbour.store(nullptr, std::memory_order_relaxed);
+    }
+    state.queued = false;
+    // held from the start, so messages wait until the Chunk is lit
+    state.running = true;
+    enterBusy();
+    // the neighbours lit before this one. Only these are read below: one
+    // lit later waits for this one to be released before reading it, so
+    // waiting for it here as well could deadlock.
+    std::array<ChunkState*, 4> earlier{};
+    {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        const glm::ivec2 offsets[4] = { { 16, 0 }, { -16, 0 }, { 0, 16 }, { 0, -16 } };
+        for (int side = 0; side < 4; side++) {
+            auto found = states.find(toKey(origin.x + offsets[side].x, origin.y + offsets[side].y));
+            if (found != states.end()) {
+                earlier[side] = found->second.get();
+                state.neighbours[side].store(found->second.get(), std::memory_order_release);
+                found->second->neighbours[side ^ 1].store(&state, std::memory_order_release);
+            }
+        }
+        states[toKey(origin.x, origin.y)] = std::move(owned);
+    }
+    taskCount++;
+
+    const BlockType* blocks = chunk.blockData();
+    work.reset();
+
+    // open sky down to the highest block of each column
+    std::array<int, 256> heights;
+    for (int z = 0; z < 16; z++) {
+        for (int x = 0; x < 16; x++) {
+            int y = 255;
+            while (y >= 0 && blocks[Chunk::blockIndex(x, y, z)] == EMPTY) {
+                y--;
+            }
+            heights[x + 16 * z] = y + 1;
+        }
+    }
+    for (int z = 0; z < 16; z++) {
+        for (int y = 0; y < 256; y++) {
+            uint8_t* row = work.light.data() + Chunk::blockIndex(0, y, z);
+            for (int x = 0; x < 16; x++) {
+                row[x] = y >= heights[x + 16 * z] ? packLight(15, 0) : packLight(0, 0);
+            }
+        }
+    }
+
+    // The sky spreads sideways from the open blocks next to a taller
+    // column, and down into whatever isn't solid under each column's top
+    for (int z = 0; z < 16; z++) {
+        for (int x = 0; x < 16; x++) {
+            const int height = heights[x + 16 * z];
+            int top = height;
+            if (x > 0) top = std::max(top, heights[x - 1 + 16 * z]);
+            if (x < 15) top = std::max(top, heights[x + 1 + 16 * z]);
+            if (z > 0) top = std::max(top, heights[x + 16 * (z - 1)]);
+            if (z < 15) top = std::max(top, heights[x + 16 * (z + 1)]);
+            for (int y = height; y <= std::min(top, 255); y++) {
+                work.adds[SKY].push_back(Chunk::blockIndex(x, y, z));
+            }
+        }
+    }
+    // emitters are opaque, so only sections with solid blocks can hold them
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        if (!(chunk.solidSections() & (1 << section))) {
+            continue;
+        }
+        const int first = Chunk::blockIndex(0, section * SECTION_SIZE, 0);
+        for (int z = 0; z < 16; z++) {
+            for (int index = first + Chunk::blockIndex(0, 0, z); index < first + Chunk::blockIndex(0, SECTION_SIZE, z); index++) {
+                int emission = lightEmission(blocks[index]);
+                if (emission > 0) {
+                    work.raise(index, BLOCK, emission);
+                }
+            }
+        }
+    }
+
+    // the light coming in from the neighbours that are already lit
+    for (int side = 0; side < 4; side++) {
+        ChunkState* neighbour = earlier[side];
+        if (neighbour == nullptr) {
+            continue;
+        }
+        claim(*neighbour);
+        for (int y = 0; y < 256; y++) {
+            for (int along = 0; along < 16; along++) {
+                int index = side < 2 ? Chunk::blockIndex(side == 0 ? 15 : 0, y, along) : Chunk::blockIndex(along, y, side == 2 ? 15 : 0);
+                uint8_t light = neighbour->chunk->light.at(acrossIndex(index, side));
+                work.sideLight[side][along + 16 * y] = light;
+                if (!isOpaque(blocks[index])) {
+                    work.raise(index, SKY, skyLight(light) - 1);
+                    work.raise(index, BLOCK, blockLight(light) - 1);
+                }
+            }
+        }
+        release(*neighbour);
+    }
+
+    Outbox outbox;
+    work.spread(blocks, SKY, outbox);
+    work.spread(blocks, BLOCK, outbox);
+
+    // every section in one go: a fresh Chunk's light has no storage yet,
+    // and the sections that came out all one level don't need any
+    {
+        std::unique_lock<std::shared_mutex> lightLock(chunk.light.mutex());
+        for (int section = 0; section < SECTION_COUNT; section++) {
+            const int y0 = section * SECTION_SIZE;
+            uint8_t first = work.light[Chunk::blockIndex(0, y0, 0)];
+            bool uniform = true;
+            for (int z = 0; z < 16 && uniform; z++) {
+                const uint8_t* slab = work.light.data() + Chunk::blockIndex(0, y0, z);
+                uniform = std::all_of(slab, slab + 16 * SECTION_SIZE, [first](uint8_t light) { return light == first; });
+            }
+            if (uniform) {
+                chunk.light.fillSection(section, first);
+                continue;
+            }
+            for (int z = 0; z < 16; z++) {
+                for (int y = y0; y < y0 + SECTION_SIZE; y++) {
+                    chunk.light.setRow(y, z, work.light.data() + Chunk::blockIndex(0, y, z));
+                }
+            }
+        }
+    }
+
+    // Send the light along each side on to the neighbours read above,
+    // skipping what wouldn't brighten them going by what was read. The ones
+    // lit later read this Chunk's side themselves.
+    for (int side = 0; side < 4; side++) {
+        ChunkState* neighbour = earlier[side];
+        if (neighbour == nullptr) {
+            continue;
+        }
+        // generated, so the simulation thread may be writing them
+        std::shared_lock<std::shared_mutex> lock(neighbour->chunk->blockMutex());
+        const BlockType* theirBlocks = neighbour->chunk->blockData();
+        for (int y = 0; y < 256; y++) {
+            for (int along = 0; along < 16; along++) {
+                int index = side < 2 ? Chunk::blockIndex(side == 0 ? 15 : 0, y, along) : Chunk::blockIndex(along, y, side == 2 ? 15 : 0);
+                uint16_t across = acrossIndex(index, side);
+                if (isOpaque(theirBlocks[across])) {
+                    continue;
+                }
+                uint8_t theirs = work.sideLight[side][along + 16 * y];
+                int sky = skyLight(work.light[index]) - 1, block = blockLight(work.light[index]) - 1;
+                if (sky > skyLight(theirs)) {
+                    outbox[side].push_back({ across, 0, ADD_SKY, static_cast<uint8_t>(sky) });
+                }
+                if (block > blockLight(theirs)) {
+                    outbox[side].push_back({ across, 0, ADD_BLOCK, static_cast<uint8_t>(block) });
+                }
+            }
+        }
+    }
+    send(state, outbox);
+    release(state);
+}
+
+void LightEngine::process(ChunkState& state, std::vector<Message>& messages) {
+    TRACE_SCOPE("light task", "light", state.origin.x, state.origin.y);
+    taskCount++;
+    messageCount += messages.size();
+    Chunk& chunk = *state.chunk;
+    std::shared_lock<std::shared_mutex> lock(chunk.blockMutex());
+    const BlockType* blocks = chunk.blockData();
+    work.reset();
+    work.load(chunk.light);
+
+    // In runs that never have an add before a removal: light a neighbour
+    // added and took away again mustn't be added back after the removal
+    Outbox outbox;
+    size_t begin = 0;
+    while (begin < messages.size()) {
+        size_t end = begin;
+        bool added = false;
+        for (; end < messages.size(); end++) {
+            bool removal = messages[end].kind == RELIGHT || messages[end].kind == REMOVE_SKY || messages[end].kind == REMOVE_BLOCK;
+            if (removal && added) {
+                break;
+            }
+            added = added || messages[end].kind == ADD_SKY || messages[end].kind == ADD_BLOCK;
+        }
+        work.apply(blocks, messages.data() + begin, messages.data() + end, outbox);
+        begin = end;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lightLock(chunk.light.mutex());
+        work.store(chunk.light);
+    }
+    changedCount += work.changedCells;
+    if (listener) {
+        for (int section = 0; section < SECTION_COUNT; section++) {
+            if (work.changed & (1 << section)) {
+                glm::ivec3 corner(state.origin.x, 0, state.origin.y);
+                listener(corner + work.changedMin[section], corner + work.changedMax[section]);
+            }
+        }
+    }
+    send(state, outbox);
+}
+
+void LightEngine::blocksChanged(const glm::ivec3& min, const glm::ivec3& max) {
+    const int yLo = std::max(min.y, 0), yHi = std::min(max.y, 255);
+    if (max.x < min.x || yHi < yLo || max.z < min.z) {
+        return;
+    }
+    // & ~15 floors to the Chunk's corner, negatives included
+    for (int z0 = min.z & ~15; z0 <= max.z; z0 += 16) {
+        for (int x0 = min.x & ~15; x0 <= max.x; x0 += 16) {
+            ChunkState* state;
+            {
+                std::lock_guard<std::mutex> lock(statesMutex);
+                auto found = states.find(toKey(x0, z0));
+                state = found != states.end() ? found->second.get() : nullptr;
+            }
+            if (state == nullptr) {
+                continue;
+            }
+            glm::ivec3 lo(std::max(min.x, x0) - x0, yLo, std::max(min.z, z0) - z0);
+            glm::ivec3 hi(std::min(max.x, x0 + 15) - x0, yHi, std::min(max.z, z0 + 15) - z0);
+            std::vector<Message> relight{ { static_cast<uint16_t>(Chunk::blockIndex(lo.x, lo.y, lo.z)),
+                static_cast<uint16_t>(Chunk::blockIndex(hi.x, hi.y, hi.z)), RELIGHT, 0 } };
+            post(*state, relight);
+        }
+    }
+}
+
+void LightEngine::waitIdle() {
+    std::unique_lock<std::mutex> lock(busyMutex);
+    idle.wait(lock, [this] { return busyStates == 0; });
+}
+
+void LightEngine::shutdown() {
+    stopped = true;
+}
+
+LightEngine::Stats LightEngine::stats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(statesMutex);
+        stats.chunks = states.size();
+    }
+    stats.tasks = taskCount;
+    stats.messages = messageCount;
+    stats.cellsChanged = changedCount;
+    return stats;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "smartpointerhelp.h"
+#include "glm_includes.h"
+#include "chunk.h"
+#include "threadpool.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Keeps every Chunk's sky light and block light (see ChunkLight) up to date
+// as Chunks are generated and blocks change.
+//
+// Light is flood filled the usual way: a breadth-first add pass spreads
+// each level to its neighbours one lower, and sky light at 15 goes straight
+// down through air without getting dimmer. Taking light away runs a removal
+// pass first, which darkens everything that was lit from the changed blocks
+// and relights from the edge of the darkened area.
+//
+// Each Chunk is only ever written by one task at a time. A fill reaching a
+// Chunk's side doesn't touch the neighbour: it posts a message to the
+// neighbour's inbox, and the neighbour carries the fill on in its own task
+// on the thread pool. So edits in different Chunks light in parallel, and
+// light tasks never wait for each other; only addChunk waits for a
+// neighbour's task to finish before reading the light along its side.
+class LightEngine {
+    friend struct LightWork;
+public:
+    // Called from the light tasks with each box of blocks, in world space,
+    // whose light changed
+    using ChangeListener = std::function<void(const glm::ivec3& min, const glm::ivec3& max)>;
+
+    struct Stats {
+        size_t chunks = 0;          // Chunks lit
+        uint64_t tasks = 0;         // light tasks run, initial passes included
+        uint64_t messages = 0;      // messages handled
+        uint64_t cellsChanged = 0;  // blocks whose light changed after their Chunk's initial pass
+    };
+
+    explicit LightEngine(ThreadPool& pool);
+    ~LightEngine();
+    LightEngine(const LightEngine&) = delete;
+    LightEngine& operator=(const LightEngine&) = delete;
+
+    void setChangeListener(ChangeListener listener);
+    // Lights a freshly generated Chunk from its blocks and the neighbours
+    // already lit, on the calling thread, and sends its light on to them.
+    // Changes to the Chunk itself aren't reported, as it hasn't been meshed.
+    void addChunk(Chunk& chunk);
+    // Relights after the blocks in the box (both included, world space)
+    // changed. The work is queued on the thread pool.
+    void blocksChanged(const glm::ivec3& min, const glm::ivec3& max);
+    // Blocks until no light task is queued or running
+    void waitIdle();
+    // Stops queuing light tasks, before the thread pool is destroyed
+    void shutdown();
+    Stats stats() const;
+
+private:
+    enum MessageKind : uint8_t {
+        ADD_SKY, ADD_BLOCK,         // a neighbour's light reached index at level
+        REMOVE_SKY, REMOVE_BLOCK,   // a neighbour's block next to index lost level
+        PULL,                       // send the light at index to the side in level
+        RELIGHT                     // the blocks from index to other changed
+    };
+    // 6 bytes, so a whole side of a Chunk fits in a few pages
+    struct Message {
+        uint16_t index;
+        uint16_t other;
+        MessageKind kind;
+        uint8_t level;
+    };
+
+    // One Chunk as an actor: messages pile up in inbox while someone holds
+    // the Chunk (running) and are handled by one pool task at a time
+    struct ChunkState {
+        Chunk* chunk;
+        glm::ivec2 origin;
+        // XPOS, XNEG, ZPOS, ZNEG, like ChunkBorders; nullptr until lit
+        std::array<std::atomic<ChunkState*>, 4> neighbours;
+
+        std::mutex mutex;
+        std::condition_variable released;
+        std::vector<Message> inbox;
+        bool queued;
+        bool running;
+    };
+    // What one task collects for each neighbour, sent when it is done
+    using Outbox = std::array<std::vector<Message>, 4>;
+
+    ThreadPool& pool;
+    ChangeListener listener;
+    std::atomic<bool> stopped;
+
+    // by toKey of the Chunk's corner. States are never removed, so pointers
+    // to them stay valid for the engine's life.
+    std::unordered_map<int64_t, uPtr<ChunkState>> states;
+    mutable std::mutex statesMutex;
+
+    // ChunkStates queued or running, for waitIdle
+    int busyStates;
+    std::mutex busyMutex;
+    std::condition_variable idle;
+
+    std::atomic<uint64_t> taskCount;
+    std::atomic<uint64_t> messageCount;
+    std::atomic<uint64_t> changedCount;
+
+    // Adds messages to the state's inbox, queuing a task for them if nobody holds it
+    void post(ChunkState& state, std::vector<Message>& messages);
+    // Waits until nobody holds the state, then holds it
+    void claim(ChunkState& state);
+    // Lets go of the state, queuing a task for whatever arrived meanwhile
+    void release(ChunkState& state);
+    // Count a state going from idle to queued or running, and back
+    void enterBusy();
+    void leaveBusy();
+    // Pool task: handles the state's inbox until it is empty
+    void run(ChunkState* state);
+    void process(ChunkState& state, std::vector<Message>& messages);
+    void send(ChunkState& state, Outbox& outbox);
+};
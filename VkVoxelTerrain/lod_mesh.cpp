@@ -0,0 +1,128 @@
+#include "lod_mesh.h"
+#include "terrain_util.h"
+
+#include <algorithm>
+
+#define LOD_VIEW_MULTIPLIER 8       // how many times further than the voxel area the LOD area reaches
+#define LOD_ROOT_SIZE 512           // largest tile, sampled every 8 blocks
+#define LOD_SPLIT_DISTANCE 0.75f    // a tile is split while closer to the voxel area than this * its size
+
+// the middle of the grass top in the texture atlas, so a tile shows its average colour
+static const glm::vec2 LOD_UV = (glm::vec2(8, 2) + 0.5f) / 16.f;
+static const glm::vec3 LOD_COLOR = glm::vec3(0.0431f, 0.51373f, 0.23137f);
+// lakes are drawn flat at the water level, opaque since they're far away
+static const glm::vec2 LOD_WATER_UV = (glm::vec2(13, 12) + 0.5f) / 16.f;
+static const glm::vec3 LOD_WATER_COLOR = glm::vec3(0.04706f, 0.3647f, 0.5216f);
+
+// Same winding as createFaceIndices in Chunk.cpp: 0: UR, 1: LR, 2: LL, 3: UL
+static void addQuad(std::vector<uint16_t>& idxData, uint16_t ur, uint16_t lr, uint16_t ll, uint16_t ul) {
+    idxData.insert(idxData.end(), { ur, ul, lr, lr, ul, ll });
+}
+
+static int floorTo(int n, int m) {
+    return n >= 0 ? (n / m) * m : ((n - m + 1) / m) * m;
+}
+
+int lodLevel(int scale) {
+    return scale >= 8 ? 2 : scale >= 4 ? 1 : 0;
+}
+
+static void selectTile(glm::ivec2 origin, int size, glm::ivec2 detailMin, glm::ivec2 detailMax, std::vector<LodTileRect>& out) {
+    glm::ivec2 tileMax = origin + size;
+    bool overlaps = origin.x < detailMax.x && tileMax.x > detailMin.x &&
+        origin.y < detailMax.y && tileMax.y > detailMin.y;
+    glm::ivec2 gap = glm::max(glm::max(detailMin - tileMax, origin - detailMax), glm::ivec2(0));
+    int distance = std::max(gap.x, gap.y);
+
+    if (size > 64 && (overlaps || distance < size * LOD_SPLIT_DISTANCE)) {
+        int half = size / 2;
+        selectTile(origin, half, detailMin, detailMax, out);
+        selectTile(origin + glm::ivec2(half, 0), half, detailMin, detailMax, out);
+        selectTile(origin + glm::ivec2(0, half), half, detailMin, detailMax, out);
+        selectTile(origin + glm::ivec2(half, half), half, detailMin, detailMax, out);
+        return;
+    }
+    // a 64 block tile overlapping the voxel area is one of its zones
+    if (overlaps) {
+        return;
+    }
+    out.push_back({ origin, size, std::max(2, size / 64) });
+}
+
+int selectLodTiles(glm::ivec2 detailMin, glm::ivec2 detailMax, std::vector<LodTileRect>& out) {
+    out.clear();
+    glm::ivec2 center = (detailMin + detailMax) / 2;
+    int viewDistance = (detailMax.x - detailMin.x) / 2 * LOD_VIEW_MULTIPLIER;
+
+    for (int z = floorTo(center.y - viewDistance, LOD_ROOT_SIZE); z < center.y + viewDistance; z += LOD_ROOT_SIZE) {
+        for (int x = floorTo(center.x - viewDistance, LOD_ROOT_SIZE); x < center.x + viewDistance; x += LOD_ROOT_SIZE) {
+            selectTile(glm::ivec2(x, z), LOD_ROOT_SIZE, detailMin, detailMax, out);
+        }
+    }
+    return viewDistance;
+}
+
+void buildLodMesh(const LodTileRect& tile, std::vector<Vertex>& vertexData, std::vector<uint16_t>& idxData) {
+    const glm::ivec2 origin = tile.origin;
+    const int scale = tile.scale;
+
+    // one extra ring of samples around the tile for the normals along its edges
+    int cells = tile.size / scale;
+    int samples = cells + 3;
+    std::vector<float> heights(samples * samples);
+    for (int z = 0; z < samples; z++) {
+        for (int x = 0; x < samples; x++) {
+            heights[z * samples + x] = static_cast<float>(terrainHeight(origin.x + (x - 1) * scale, origin.y + (z - 1) * scale));
+        }
+    }
+    auto ground = [&](int x, int z) { return heights[(z + 1) * samples + (x + 1)]; };
+    auto height = [&](int x, int z) { return std::max(ground(x, z), static_cast<float>(WATER_LEVEL)); };
+
+    // surface grid, z-major
+    uint16_t base = static_cast<uint16_t>(vertexData.size());
+    int row = cells + 1;
+    for (int z = 0; z <= cells; z++) {
+        for (int x = 0; x <= cells; x++) {
+            Vertex vtx;
+            vtx.pos = glm::vec3(origin.x + x * scale, height(x, z), origin.y + z * scale);
+            vtx.nor = glm::normalize(glm::vec3(height(x - 1, z) - height(x + 1, z), 2.f * scale, height(x, z - 1) - height(x, z + 1)));
+            bool water = ground(x, z) < WATER_LEVEL;
+            vtx.color = water ? LOD_WATER_COLOR : LOD_COLOR;
+            vtx.texCoord = water ? LOD_WATER_UV : LOD_UV;
+            vtx.ao = 3;
+            vtx.skyLight = 255;
+            vtx.blockLight = 0;
+            vtx.padding = 0;
+            vertexData.push_back(vtx);
+        }
+    }
+    auto grid = [base, row](int x, int z) { return static_cast<uint16_t>(base + z * row + x); };
+    for (int z = 0; z < cells; z++) {
+        for (int x = 0; x < cells; x++) {
+            addQuad(idxData, grid(x + 1, z), grid(x + 1, z + 1), grid(x, z + 1), grid(x, z));
+        }
+    }
+
+    // skirts: a copy of each edge's vertices pushed down, joined to the edge
+    // with faces pointing out of the tile
+    auto addSkirt = [&](auto edge) {
+        uint16_t first = static_cast<uint16_t>(vertexData.size());
+        for (int i = 0; i <= cells; i++) {
+            Vertex vtx = vertexData[edge(i)];
+            vtx.pos.y -= LOD_SKIRT_DEPTH;
+            vertexData.push_back(vtx);
+        }
+        return first;
+    };
+    uint16_t xpos = addSkirt([&](int i) { return grid(cells, i); });
+    uint16_t xneg = addSkirt([&](int i) { return grid(0, i); });
+    uint16_t zpos = addSkirt([&](int i) { return grid(i, cells); });
+    uint16_t zneg = addSkirt([&](int i) { return grid(i, 0); });
+    auto skirt = [](uint16_t first, int i) { return static_cast<uint16_t>(first + i); };
+    for (int i = 0; i < cells; i++) {
+        addQuad(idxData, grid(cells, i), skirt(xpos, i), skirt(xpos, i + 1), grid(cells, i + 1));
+        addQuad(idxData, grid(0, i + 1), skirt(xneg, i + 1), skirt(xneg, i), grid(0, i));
+        addQuad(idxData, grid(i + 1, cells), skirt(zpos, i + 1), skirt(zpos, i), grid(i, cells));
+        addQuad(idxData, grid(i, 0), skirt(zneg, i), skirt(zneg, i + 1), grid(i + 1, 0));
+    }
+}
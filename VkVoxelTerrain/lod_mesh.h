@@ -0,0 +1,38 @@
+#pragma once
+#include "glm_includes.h"
+#include "vertex.h"
+
+#include <cstdint>
+#include <vector>
+
+// The CPU side of TerrainLod, without Vulkan so the benchmarks can run it:
+// which tiles cover the view distance, and the heightmap mesh of each.
+
+// Coarse levels drawn past the voxel draw radius: heights sampled every 2, 4 and 8 blocks
+constexpr int LOD_LEVELS = 3;
+// How far the skirts hang below a tile's edges, more than the terrain's
+// whole height range (100 - 120)
+constexpr float LOD_SKIRT_DEPTH = 24.f;
+
+// A square of terrain picked by selectLodTiles
+struct LodTileRect {
+    glm::ivec2 origin;          // lower-left corner in world space
+    int size;                   // side length in blocks, 64 to 512
+    int scale;                  // blocks between height samples
+};
+
+// The level of detail of tiles sampled every `scale` blocks
+int lodLevel(int scale);
+
+// The tiles around the voxel area [detailMin, detailMax), from a quadtree
+// over 512 block roots: a tile is split while it overlaps the voxel area or
+// is closer to it than its own size, so tiles get coarser with distance and
+// never overlap each other or the voxel chunks. Replaces out, and returns the
+// distance from the centre of the voxel area to the edge of the LOD area.
+int selectLodTiles(glm::ivec2 detailMin, glm::ivec2 detailMax, std::vector<LodTileRect>& out);
+
+// Samples terrainHeight over the tile and appends its mesh: a grid of
+// vertices, flattened to the water level over lakes, with a skirt hanging
+// down from each edge so neighbouring tiles (or chunks) of a different scale
+// don't show cracks.
+void buildLodMesh(const LodTileRect& tile, std::vector<Vertex>& vertexData, std::vector<uint16_t>& idxData);
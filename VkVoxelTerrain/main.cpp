@@ -1,10 +1,35 @@
 #include "renderer.h"
 
 #include <iostream>
+#include <string>
 
-int main() {
+// VkVoxelTerrain [--replay camera_paths/<name>.campath [--report out.json]]
+//
+// --replay flies the path with a fixed timestep, writes a frame time report
+// and quits. On machines without a GPU it runs on a software driver, e.g.
+// Mesa's lavapipe under a virtual X server:
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json xvfb-run ./VkVoxelTerrain --replay ...
+int main(int argc, char** argv) {
     Renderer app;
 
+    std::string replayPath, reportPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (arg == "--report" && i + 1 < argc) {
+            reportPath = argv[++i];
+        }
+        else {
+            std::cerr << "usage: " << argv[0] << " [--replay path.campath [--report out.json]]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (!replayPath.empty()) {
+        app.replayOnStart(replayPath, reportPath);
+    }
+
     try {
         app.run();
     }
@@ -14,4 +39,4 @@ int main() {
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,114 @@
+#include "memory_tracker.h"
+
+MemoryTracker& MemoryTracker::instance() {
+    static MemoryTracker tracker;
+    return tracker;
+}
+
+MemoryTracker::MemoryTracker()
+    : hostCounters(), deviceCounters(), hostAll(), deviceAll(), deviceMutex(), deviceAllocations(),
+    heapsMutex(), heapList(), budgetSupported(false)
+{
+}
+
+const char* MemoryTracker::hostCategoryName(HostCategory category) {
+    static const char* names[HOST_CATEGORY_COUNT] = { "chunk blocks", "chunk meshes", "pool tasks", "chunk light" };
+    return names[category];
+}
+
+const char* MemoryTracker::deviceCategoryName(DeviceCategory category) {
+    static const char* names[DEVICE_CATEGORY_COUNT] = {
+        "chunk buffers", "lod buffers", "textures", "attachments", "staging", "uniforms"
+    };
+    return names[category];
+}
+
+void MemoryTracker::Counter::add(uint64_t n) {
+    uint64_t now = bytes.fetch_add(n, std::memory_order_relaxed) + n;
+    count.fetch_add(1, std::memory_order_relaxed);
+    uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+    while (now > peak && !peakBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryTracker::Counter::remove(uint64_t n) {
+    bytes.fetch_sub(n, std::memory_order_relaxed);
+    count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+MemoryTracker::Usage MemoryTracker::Counter::usage() const {
+    return { bytes.load(std::memory_order_relaxed), peakBytes.load(std::memory_order_relaxed),
+        count.load(std::memory_order_relaxed) };
+}
+
+void MemoryTracker::hostAllocated(HostCategory category, uint64_t bytes) {
+    hostCounters[category].add(bytes);
+    hostAll.add(bytes);
+}
+
+void MemoryTracker::hostFreed(HostCategory category, uint64_t bytes) {
+    hostCounters[category].remove(bytes);
+    hostAll.remove(bytes);
+}
+
+void MemoryTracker::deviceAllocated(uint64_t handle, DeviceCategory category, uint64_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        deviceAllocations[handle] = { category, bytes };
+    }
+    deviceCounters[category].add(bytes);
+    deviceAll.add(bytes);
+}
+
+void MemoryTracker::deviceFreed(uint64_t handle) {
+    DeviceAllocation allocation;
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        auto it = deviceAllocations.find(handle);
+        if (it == deviceAllocations.end()) {
+            return;
+        }
+        allocation = it->second;
+        deviceAllocations.erase(it);
+    }
+    deviceCounters[allocation.category].remove(allocation.bytes);
+    deviceAll.remove(allocation.bytes);
+}
+
+MemoryTracker::Usage MemoryTracker::host(HostCategory category) const {
+    return hostCounters[category].usage();
+}
+
+MemoryTracker::Usage MemoryTracker::device(DeviceCategory category) const {
+    return deviceCounters[category].usage();
+}
+
+MemoryTracker::Usage MemoryTracker::hostTotal() const {
+    return hostAll.usage();
+}
+
+MemoryTracker::Usage MemoryTracker::deviceTotal() const {
+    return deviceAll.usage();
+}
+
+void MemoryTracker::resetPeaks() {
+    for (Counter& counter : hostCounters) {
+        counter.peakBytes.store(counter.bytes.load());
+    }
+    for (Counter& counter : deviceCounters) {
+        counter.peakBytes.store(counter.bytes.load());
+    }
+    hostAll.peakBytes.store(hostAll.bytes.load());
+    deviceAll.peakBytes.store(deviceAll.bytes.load());
+}
+
+void MemoryTracker::setHeaps(const std::vector<Heap>& heaps, bool budgetSupported) {
+    std::lock_guard<std::mutex> lock(heapsMutex);
+    heapList = heaps;
+    this->budgetSupported = budgetSupported;
+}
+
+std::vector<MemoryTracker::Heap> MemoryTracker::heaps() const {
+    std::lock_guard<std::mutex> lock(heapsMutex);
+    return heapList;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Counts the bytes the world holds, on the host per subsystem and on the
+// device per kind of allocation, with the high-water mark of each. Host
+// bytes are reported by their owners (Chunk, ThreadPool) and device bytes by
+// createBuffer/createImage, so only allocations made through them are seen;
+// the driver's own view of each heap comes from VK_EXT_memory_budget.
+//
+// Doesn't depend on Vulkan, so headless tools can read it (and assert on it)
+// through the world library.
+class MemoryTracker {
+public:
+    enum HostCategory {
+        HOST_CHUNK_BLOCKS,  // every Chunk's block array
+        HOST_CHUNK_MESH,    // vertex and index vectors waiting to be uploaded
+        HOST_POOL_TASKS,    // queued ThreadPool tasks and their bound arguments
+        HOST_CHUNK_LIGHT,   // ChunkLight sections that aren't uniform
+        HOST_CATEGORY_COUNT
+    };
+    enum DeviceCategory {
+        DEVICE_CHUNK_BUFFERS,
+        DEVICE_LOD_BUFFERS,
+        DEVICE_TEXTURES,
+        DEVICE_ATTACHMENTS,
+        DEVICE_STAGING,
+        DEVICE_UNIFORMS,
+        DEVICE_CATEGORY_COUNT
+    };
+
+    struct Usage {
+        uint64_t bytes;
+        uint64_t peakBytes;
+        // live allocations, for averages like bytes per Chunk
+        uint64_t count;
+    };
+    // One device memory heap as the driver sees it, from VK_EXT_memory_budget.
+    // Without the extension, budget is the heap's size and usage is unknown (0).
+    struct Heap {
+        uint64_t size;
+        uint64_t budget;
+        uint64_t usage;
+        bool deviceLocal;
+    };
+
+    static MemoryTracker& instance();
+    static const char* hostCategoryName(HostCategory category);
+    static const char* deviceCategoryName(DeviceCategory category);
+
+    void hostAllocated(HostCategory category, uint64_t bytes);
+    void hostFreed(HostCategory category, uint64_t bytes);
+    // handle is the VkDeviceMemory the bytes were allocated as
+    void deviceAllocated(uint64_t handle, DeviceCategory category, uint64_t bytes);
+    void deviceFreed(uint64_t handle);
+
+    Usage host(HostCategory category) const;
+    Usage device(DeviceCategory category) const;
+    Usage hostTotal() const;
+    Usage deviceTotal() const;
+    // Starts every high-water mark again from the current bytes
+    void resetPeaks();
+
+    void setHeaps(const std::vector<Heap>& heaps, bool budgetSupported);
+    std::vector<Heap> heaps() const;
+    bool isBudgetSupported() const { return budgetSupported; }
+
+private:
+    MemoryTracker();
+
+    struct Counter {
+        std::atomic<uint64_t> bytes{ 0 };
+        std::atomic<uint64_t> peakBytes{ 0 };
+        std::atomic<uint64_t> count{ 0 };
+
+        void add(uint64_t n);
+        void remove(uint64_t n);
+        Usage usage() const;
+    };
+    struct DeviceAllocation {
+        DeviceCategory category;
+        uint64_t bytes;
+    };
+
+    std::array<Counter, HOST_CATEGORY_COUNT> hostCounters;
+    std::array<Counter, DEVICE_CATEGORY_COUNT> deviceCounters;
+    Counter hostAll;
+    Counter deviceAll;
+
+    std::mutex deviceMutex;
+    std::unordered_map<uint64_t, DeviceAllocation> deviceAllocations;
+
+    mutable std::mutex heapsMutex;
+    std::vector<Heap> heapList;
+    std::atomic<bool> budgetSupported;
+};
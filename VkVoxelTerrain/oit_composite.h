@@ -0,0 +1,50 @@
+#pragma once
+#include "globals.h"
+
+class Renderer;
+
+// The subpasses of Renderer's render pass
+constexpr uint32_t SUBPASS_OPAQUE = 0;          // chunks and LOD tiles, depth writes on
+constexpr uint32_t SUBPASS_TRANSLUCENT = 1;     // water into the OIT targets, depth test only
+constexpr uint32_t SUBPASS_COMPOSITE = 2;       // OIT targets over the opaque colour, then the GUI
+
+// Weighted blended order-independent transparency. Translucent faces are
+// drawn in any order into two multisampled targets: accumulation (weighted
+// premultiplied colour and alpha, summed) and revealage (the product of
+// 1 - alpha). The composite subpass reads both as input attachments and
+// blends their average colour over the opaque image with one fullscreen triangle.
+class OitComposite {
+public:
+    static constexpr VkFormat ACCUM_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr VkFormat REVEAL_FORMAT = VK_FORMAT_R16_SFLOAT;
+
+    VkImageView accumImageView;
+    VkImageView revealImageView;
+
+    OitComposite(Renderer* vulkanContext);
+
+    // The targets are the size of the swapchain, so these run again whenever
+    // it is recreated
+    void createTargets();
+    void destroyTargets();
+    // Needs the render pass and the targets
+    void buildPipeline();
+    // Records the fullscreen composite, inside SUBPASS_COMPOSITE
+    void draw(VkCommandBuffer cmdBuffer);
+    void destroyResources();
+
+private:
+    Renderer* context;
+
+    VkImage accumImage, revealImage;
+    VkDeviceMemory accumImageMemory, revealImageMemory;
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    // Points the input attachments at the current targets
+    void updateDescriptorSet();
+};
@@ -0,0 +1,84 @@
+#include "overdraw_benchmark.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+OverdrawBenchmark::OverdrawBenchmark()
+    : running(false), configs(), results(), current(0), frameInConfig(0)
+{
+}
+
+void OverdrawBenchmark::start() {
+    configs = {
+        { false, false },
+        { true, false },
+        { false, true },
+        { true, true },
+    };
+    results.clear();
+    current = 0;
+    frameInConfig = 0;
+    running = true;
+}
+
+bool OverdrawBenchmark::addFrame(uint64_t fragmentInvocations, float opaqueGpuMs, float frameMs) {
+    if (!running) {
+        return false;
+    }
+
+    frameInConfig++;
+    if (frameInConfig == WARMUP_FRAMES + 1) {
+        results.push_back({ configs[current], 0, 0.0, 0.f, 0.f });
+    }
+    if (frameInConfig <= WARMUP_FRAMES) {
+        return false;
+    }
+
+    Result& result = results.back();
+    result.frames++;
+    result.fragmentInvocations += static_cast<double>(fragmentInvocations);
+    result.opaqueGpuMs += opaqueGpuMs;
+    result.frameMs += frameMs;
+
+    if (result.frames < MEASURED_FRAMES) {
+        return false;
+    }
+
+    result.fragmentInvocations /= result.frames;
+    result.opaqueGpuMs /= result.frames;
+    result.frameMs /= result.frames;
+
+    frameInConfig = 0;
+    if (++current == configs.size()) {
+        current = configs.size() - 1;
+        running = false;
+    }
+    return true;
+}
+
+void OverdrawBenchmark::writeReport(const std::string& path) const {
+    std::cout << "\nOverdraw benchmark (" << MEASURED_FRAMES << " frames per row)\n";
+    std::cout << std::setw(14) << "order" << std::setw(10) << "pre-pass"
+        << std::setw(18) << "frag invocations" << std::setw(14) << "vs baseline"
+        << std::setw(12) << "opaque ms" << std::setw(12) << "frame ms" << "\n";
+
+    std::ofstream csv(path);
+    csv << "order,depth_prepass,frames,fragment_invocations,relative_invocations,opaque_gpu_ms,frame_ms\n";
+
+    double baseline = results.empty() ? 0.0 : results.front().fragmentInvocations;
+    for (const Result& result : results) {
+        const char* order = result.config.frontToBack ? "front-to-back" : "raster";
+        const char* prepass = result.config.depthPrepass ? "on" : "off";
+        double relative = baseline > 0.0 ? result.fragmentInvocations / baseline : 0.0;
+
+        std::cout << std::setw(14) << order << std::setw(10) << prepass
+            << std::setw(18) << std::fixed << std::setprecision(0) << result.fragmentInvocations
+            << std::setw(14) << std::setprecision(3) << relative
+            << std::setw(12) << result.opaqueGpuMs << std::setw(12) << result.frameMs << "\n";
+        csv << order << "," << prepass << "," << result.frames << ","
+            << std::setprecision(0) << result.fragmentInvocations << ","
+            << std::setprecision(3) << relative << "," << result.opaqueGpuMs << "," << result.frameMs << "\n";
+    }
+    std::cout << "Written to " << path << std::endl;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compares the ways the opaque terrain can be drawn: raster or front to back
+// zone order, each with and without a depth pre-pass. Each configuration is
+// held for a fixed number of frames after a warm-up, which also covers the
+// frames in flight still reporting the previous configuration's queries.
+// The fragment shader invocations come from a pipeline statistics query
+// around the opaque subpass, so the run uses inline recording.
+//
+// Keep the camera still while it runs so every configuration sees the same view.
+class OverdrawBenchmark {
+public:
+    struct Config {
+        bool frontToBack;
+        bool depthPrepass;
+    };
+
+    struct Result {
+        Config config;
+        int frames;
+        double fragmentInvocations;     // per frame, opaque subpass
+        float opaqueGpuMs;              // opaque subpass, from timestamps
+        float frameMs;                  // whole main loop iteration
+    };
+
+    OverdrawBenchmark();
+
+    void start();
+    bool isRunning() const { return running; }
+    // The configuration the next frame should be rendered with
+    const Config& currentConfig() const { return configs[current]; }
+    // Feed one frame's numbers. Returns true when the configuration changed
+    // (or the sweep finished), so the caller knows to apply it.
+    bool addFrame(uint64_t fragmentInvocations, float opaqueGpuMs, float frameMs);
+
+    const std::vector<Result>& getResults() const { return results; }
+    // Prints a table of the results to stdout and writes them as CSV to path
+    void writeReport(const std::string& path) const;
+
+private:
+    static constexpr int WARMUP_FRAMES = 30;
+    static constexpr int MEASURED_FRAMES = 120;
+
+    bool running;
+    std::vector<Config> configs;
+    std::vector<Result> results;
+    size_t current;
+    int frameInConfig;
+};
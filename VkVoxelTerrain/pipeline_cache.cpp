@@ -0,0 +1,149 @@
+#include "pipeline_cache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// 64-bit FNV-1a, enough to catch a torn or corrupted file
+static uint64_t checksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+PipelineCache::PipelineCache()
+    : device(VK_NULL_HANDLE), cache(VK_NULL_HANDLE), expected{}, path(), loaded(false), loadedSize(0), savedSize(0)
+{
+}
+
+void PipelineCache::init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path) {
+    this->device = device;
+    this->path = path;
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    expected.magic = FILE_MAGIC;
+    expected.version = FILE_VERSION;
+    expected.vendorID = properties.vendorID;
+    expected.deviceID = properties.deviceID;
+    expected.driverVersion = properties.driverVersion;
+    std::memcpy(expected.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    std::vector<char> data = readValidated();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+        // the driver can still refuse data that passed our checks, so retry empty
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        data.clear();
+        if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    loaded = !data.empty();
+    loadedSize = data.size();
+    savedSize = data.size();
+}
+
+std::vector<char> PipelineCache::readValidated() const {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return {};
+    }
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    if (fileSize < sizeof(FileHeader)) {
+        return {};
+    }
+
+    FileHeader header{};
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+
+    if (header.magic != expected.magic || header.version != expected.version
+        || header.vendorID != expected.vendorID || header.deviceID != expected.deviceID
+        || header.driverVersion != expected.driverVersion
+        || std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0
+        || header.dataSize != fileSize - sizeof(FileHeader)) {
+        std::cout << "Pipeline cache " << path << " is from another device or driver, starting empty" << std::endl;
+        return {};
+    }
+
+    std::vector<char> data(header.dataSize);
+    file.read(data.data(), data.size());
+    if (!file || checksum(data.data(), data.size()) != header.checksum) {
+        std::cout << "Pipeline cache " << path << " is corrupt, starting empty" << std::endl;
+        return {};
+    }
+
+    // the driver's own header must agree with ours as well
+    VkPipelineCacheHeaderVersionOne driverHeader{};
+    if (data.size() < sizeof(driverHeader)) {
+        return {};
+    }
+    std::memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+    if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        || driverHeader.vendorID != expected.vendorID || driverHeader.deviceID != expected.deviceID
+        || std::memcmp(driverHeader.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return {};
+    }
+
+    return data;
+}
+
+void PipelineCache::save() {
+    if (cache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS || size == savedSize) {
+        return;
+    }
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+        return;
+    }
+    data.resize(size);
+
+    FileHeader header = expected;
+    header.dataSize = data.size();
+    header.checksum = checksum(data.data(), data.size());
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        file.write(data.data(), data.size());
+        if (!file) {
+            std::cout << "Failed to write pipeline cache " << tempPath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::cout << "Failed to replace pipeline cache " << path << ": " << error.message() << std::endl;
+        return;
+    }
+    savedSize = data.size();
+}
+
+void PipelineCache::cleanup() {
+    if (cache != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(device, cache, nullptr);
+        cache = VK_NULL_HANDLE;
+    }
+}
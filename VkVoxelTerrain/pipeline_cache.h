@@ -0,0 +1,54 @@
+#pragma once
+#include "globals.h"
+
+#include <string>
+
+// A VkPipelineCache that is kept on disk between runs. The file is the
+// driver's cache data behind a small header holding the device's vendor,
+// device and driver version, its pipelineCacheUUID, and a checksum of the
+// data. A file written by another GPU or driver, or a truncated one, is
+// ignored and the cache starts empty.
+//
+// Pipelines can be created from several threads against the same cache:
+// Vulkan synchronises access to a VkPipelineCache internally.
+class PipelineCache {
+public:
+    PipelineCache();
+
+    void init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+    VkPipelineCache handle() const { return cache; }
+    // True if init found a valid file for this device
+    bool loadedFromDisk() const { return loaded; }
+    size_t loadedBytes() const { return loadedSize; }
+    // Writes the cache to disk, unless it hasn't grown since it was loaded or
+    // last saved. Goes through a temporary file, so an interrupted write
+    // never leaves a partial cache behind.
+    void save();
+    void cleanup();
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+
+    static constexpr uint32_t FILE_MAGIC = 0x43505656; // "VVPC"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    VkDevice device;
+    VkPipelineCache cache;
+    FileHeader expected;
+    std::string path;
+    bool loaded;
+    size_t loadedSize;
+    size_t savedSize;
+
+    // Returns the cache data in the file, or nothing if it doesn't belong to this device
+    std::vector<char> readValidated() const;
+};
@@ -0,0 +1,274 @@
+#include "profiler.h"
+#include "trace_recorder.h"
+
+#include "external/imgui/imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+Profiler::Scope::Scope(int id)
+    : id(id),
+    startNs(Profiler::instance().isEnabled() || TraceRecorder::instance().isEnabled() ? nowNs() : -1)
+{
+}
+
+Profiler::Scope::~Scope() {
+    if (startNs < 0) {
+        return;
+    }
+    int64_t endNs = nowNs();
+    Profiler& profiler = Profiler::instance();
+    if (profiler.isEnabled()) {
+        profiler.scopes[id].frameNs.fetch_add(endNs - startNs, std::memory_order_relaxed);
+    }
+    // every profiled scope also shows up in the trace
+    TraceRecorder& trace = TraceRecorder::instance();
+    if (trace.isEnabled()) {
+        trace.record(profiler.scopes[id].name, "frame", startNs, endNs);
+    }
+}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : enabled(false), registerMutex(), scopes(), scopeCount(0), frameNumber(0),
+    device(VK_NULL_HANDLE), queryPool(VK_NULL_HANDLE), timestampPeriod(0.f), recordingFrame(0), gpuRanges()
+{
+}
+
+int64_t Profiler::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int Profiler::findScope(const char* name) const {
+    int count = scopeCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (std::strcmp(scopes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Profiler::registerScope(const char* name, bool gpu) {
+    std::lock_guard<std::mutex> lock(registerMutex);
+    int existing = findScope(name);
+    if (existing >= 0) {
+        return existing;
+    }
+
+    int id = scopeCount.load(std::memory_order_relaxed);
+    if (id == MAX_SCOPES) {
+        throw std::runtime_error("too many profiler scopes!");
+    }
+    ScopeData& scope = scopes[id];
+    scope.name = name;
+    scope.gpu = gpu;
+    scope.frameNs.store(0, std::memory_order_relaxed);
+    scope.lastMs = 0.f;
+    scope.maxMs = 0.f;
+    scope.history.fill(0.f);
+    scope.historyNext = 0;
+    scope.historyCount = 0;
+    // readers only look at scopes below the count
+    scopeCount.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+void Profiler::setEnabled(bool enable) {
+    if (enable && !isEnabled()) {
+        // start the graphs afresh rather than joining them across the gap
+        int count = scopeCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            scopes[i].frameNs.store(0, std::memory_order_relaxed);
+            scopes[i].historyNext = 0;
+            scopes[i].historyCount = 0;
+            scopes[i].maxMs = 0.f;
+        }
+    }
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+void Profiler::pushHistory(ScopeData& scope, float ms) {
+    scope.lastMs = ms;
+    scope.history[scope.historyNext] = ms;
+    scope.historyNext = (scope.historyNext + 1) % HISTORY;
+    scope.historyCount = std::min(scope.historyCount + 1, HISTORY);
+    scope.maxMs = *std::max_element(scope.history.begin(), scope.history.begin() + scope.historyCount);
+}
+
+void Profiler::endFrame() {
+    frameNumber++;
+    if (!isEnabled()) {
+        return;
+    }
+
+    int count = scopeCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        ScopeData& scope = scopes[i];
+        if (!scope.gpu) {
+            pushHistory(scope, scope.frameNs.exchange(0, std::memory_order_relaxed) / 1e6f);
+        }
+    }
+}
+
+void Profiler::createGpuQueries(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if (!properties.limits.timestampComputeAndGraphics) {
+        return;
+    }
+
+    this->device = device;
+    timestampPeriod = properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2 * MAX_GPU_RANGES * framesInFlight;
+
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    std::array<int, MAX_GPU_RANGES> unused;
+    unused.fill(-1);
+    gpuRanges.assign(framesInFlight, unused);
+}
+
+void Profiler::destroyGpuQueries() {
+    if (queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device, queryPool, nullptr);
+        queryPool = VK_NULL_HANDLE;
+    }
+}
+
+void Profiler::beginGpuFrame(VkCommandBuffer cmdBuffer, uint32_t frame) {
+    if (queryPool == VK_NULL_HANDLE) {
+        return;
+    }
+    recordingFrame = frame;
+    gpuRanges[frame].fill(-1);
+    vkCmdResetQueryPool(cmdBuffer, queryPool, 2 * MAX_GPU_RANGES * frame, 2 * MAX_GPU_RANGES);
+}
+
+uint32_t Profiler::gpuBegin(VkCommandBuffer cmdBuffer, const char* name) {
+    if (queryPool == VK_NULL_HANDLE) {
+        return MAX_GPU_RANGES;
+    }
+
+    std::array<int, MAX_GPU_RANGES>& ranges = gpuRanges[recordingFrame];
+    uint32_t range = 0;
+    while (range < MAX_GPU_RANGES && ranges[range] >= 0) {
+        range++;
+    }
+    if (range == MAX_GPU_RANGES) {
+        return range;
+    }
+
+    int scope = findScope(name);
+    ranges[range] = scope >= 0 ? scope : registerScope(name, true);
+    vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool,
+        2 * (MAX_GPU_RANGES * recordingFrame + range));
+    return range;
+}
+
+void Profiler::gpuEnd(VkCommandBuffer cmdBuffer, uint32_t range) {
+    if (queryPool == VK_NULL_HANDLE || range >= MAX_GPU_RANGES) {
+        return;
+    }
+    vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool,
+        2 * (MAX_GPU_RANGES * recordingFrame + range) + 1);
+}
+
+void Profiler::readGpuFrame(uint32_t frame) {
+    if (queryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::array<int, MAX_GPU_RANGES>& ranges = gpuRanges[frame];
+    uint32_t used = 0;
+    while (used < MAX_GPU_RANGES && ranges[used] >= 0) {
+        used++;
+    }
+    if (used == 0) {
+        return;
+    }
+
+    uint64_t timestamps[2 * MAX_GPU_RANGES];
+    if (vkGetQueryPoolResults(device, queryPool, 2 * MAX_GPU_RANGES * frame, 2 * used, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < used; i++) {
+        float ms = (timestamps[2 * i + 1] - timestamps[2 * i]) * timestampPeriod / 1e6f;
+        ScopeData& scope = scopes[ranges[i]];
+        if (isEnabled()) {
+            pushHistory(scope, ms);
+        }
+        else {
+            scope.lastMs = ms;
+        }
+    }
+    // read once: a frame that records no ranges mustn't report stale ones
+    ranges.fill(-1);
+}
+
+Profiler::FrameTimings Profiler::latestFrame() const {
+    FrameTimings frame{ frameNumber, {} };
+    int count = scopeCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        frame.timings.push_back({ scopes[i].name, scopes[i].gpu, scopes[i].lastMs });
+    }
+    return frame;
+}
+
+float Profiler::lastMs(const char* name) const {
+    int scope = findScope(name);
+    return scope >= 0 ? scopes[scope].lastMs : 0.f;
+}
+
+void Profiler::drawPanel(bool* open) {
+    ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", open)) {
+        ImGui::End();
+        return;
+    }
+
+    int count = scopeCount.load(std::memory_order_acquire);
+    for (int pass = 0; pass < 2; pass++) {
+        bool gpu = pass == 1;
+        ImGui::SeparatorText(gpu ? "GPU" : "CPU");
+        if (gpu && queryPool == VK_NULL_HANDLE) {
+            ImGui::Text("no timestamp support on the graphics queue");
+            continue;
+        }
+
+        for (int i = 0; i < count; i++) {
+            const ScopeData& scope = scopes[i];
+            if (scope.gpu != gpu) {
+                continue;
+            }
+            float sum = 0.f;
+            for (int h = 0; h < scope.historyCount; h++) {
+                sum += scope.history[h];
+            }
+            float average = scope.historyCount > 0 ? sum / scope.historyCount : 0.f;
+
+            ImGui::Text("%-26s %7.3f ms  avg %7.3f  max %7.3f", scope.name, scope.lastMs, average, scope.maxMs);
+            // the ring starts at the oldest sample once it has wrapped
+            int offset = scope.historyCount == HISTORY ? scope.historyNext : 0;
+            ImGui::PushID(i);
+            ImGui::PlotLines("##history", scope.history.data(), scope.historyCount, offset, nullptr,
+                0.f, std::max(scope.maxMs, 0.001f), ImVec2(-1.f, 32.f));
+            ImGui::PopID();
+        }
+    }
+    ImGui::End();
+}
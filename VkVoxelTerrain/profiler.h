@@ -0,0 +1,120 @@
+#pragma once
+#include "globals.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Per-frame timings of named CPU scopes and GPU timestamp ranges.
+//
+// CPU scopes are declared with PROFILE_SCOPE("name"). A name is registered
+// once, and every scope adds its duration to that name's total for the
+// frame, so a scope that runs several times a frame, or on worker threads,
+// shows the sum. Each scope is also recorded as a TraceRecorder event. With
+// both disabled a scope costs two relaxed atomic loads.
+//
+// GPU ranges are timestamp pairs written into the frame's command buffers.
+// They are read back once the frame's fence has been waited on, so they lag
+// the CPU timings by MAX_FRAMES_IN_FLIGHT frames. They are written whether or
+// not the profiler is enabled: the overlay and the overdraw benchmark read
+// them, and a few timestamps a frame cost nothing measurable.
+class Profiler {
+public:
+    static constexpr int HISTORY = 240;             // frames kept for the graphs
+    static constexpr int MAX_SCOPES = 64;
+    static constexpr uint32_t MAX_GPU_RANGES = 8;   // per frame
+
+    struct Timing {
+        const char* name;
+        bool gpu;
+        float ms;
+    };
+
+    // CPU scopes as of the last endFrame(), GPU ranges as of the last readback
+    struct FrameTimings {
+        uint64_t frame;
+        std::vector<Timing> timings;
+    };
+
+    class Scope {
+    public:
+        explicit Scope(int id);
+        ~Scope();
+    private:
+        int id;
+        int64_t startNs;
+    };
+
+    static Profiler& instance();
+
+    // Safe from any thread. Registering a name twice returns the same id.
+    int registerScope(const char* name, bool gpu = false);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enable);
+
+    // Closes the CPU frame: each scope's total becomes its latest value and
+    // goes into its history
+    void endFrame();
+
+    void createGpuQueries(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight);
+    void destroyGpuQueries();
+    // False if the graphics queue can't write timestamps
+    bool hasGpuQueries() const { return queryPool != VK_NULL_HANDLE; }
+    // Resets the frame's queries. Outside a render pass, before any range.
+    void beginGpuFrame(VkCommandBuffer cmdBuffer, uint32_t frame);
+    // Opens a named range. The end can be written to a different command
+    // buffer of the same frame, primary or secondary. Both timestamps wait
+    // for the work recorded before them, so back-to-back ranges don't
+    // overlap. Main thread only.
+    uint32_t gpuBegin(VkCommandBuffer cmdBuffer, const char* name);
+    void gpuEnd(VkCommandBuffer cmdBuffer, uint32_t range);
+    // Reads back the frame's ranges, once its fence has signalled
+    void readGpuFrame(uint32_t frame);
+
+    FrameTimings latestFrame() const;
+    // The latest value of a CPU scope or GPU range, 0 if it hasn't run
+    float lastMs(const char* name) const;
+
+    // Graphs and averages of every scope, in its own ImGui window
+    void drawPanel(bool* open);
+
+private:
+    struct ScopeData {
+        const char* name;
+        bool gpu;
+        std::atomic<int64_t> frameNs;
+        float lastMs;
+        float maxMs;
+        std::array<float, HISTORY> history;
+        int historyNext;
+        int historyCount;
+    };
+
+    Profiler();
+
+    static int64_t nowNs();
+    void pushHistory(ScopeData& scope, float ms);
+    int findScope(const char* name) const;
+
+    std::atomic<bool> enabled;
+    std::mutex registerMutex;
+    std::array<ScopeData, MAX_SCOPES> scopes;
+    std::atomic<int> scopeCount;
+    uint64_t frameNumber;
+
+    VkDevice device;
+    VkQueryPool queryPool;
+    float timestampPeriod;
+    uint32_t recordingFrame;
+    // ranges opened per frame in flight: scope id, or -1 for unused
+    std::vector<std::array<int, MAX_GPU_RANGES>> gpuRanges;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing block under `name` (a string literal)
+#define PROFILE_SCOPE(name) \
+    static const int PROFILE_CONCAT(profileScopeId, __LINE__) = Profiler::instance().registerScope(name); \
+    Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileScopeId, __LINE__))
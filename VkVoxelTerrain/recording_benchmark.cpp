@@ -0,0 +1,78 @@
+#include "recording_benchmark.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+RecordingBenchmark::RecordingBenchmark()
+    : running(false), configs(), results(), current(0), frameInConfig(0)
+{
+}
+
+void RecordingBenchmark::start(int maxDrawMultiplier) {
+    configs.clear();
+    results.clear();
+    for (int multiplier = 1; multiplier <= maxDrawMultiplier; multiplier++) {
+        configs.push_back({ multiplier, false });
+        configs.push_back({ multiplier, true });
+    }
+    current = 0;
+    frameInConfig = 0;
+    running = !configs.empty();
+}
+
+bool RecordingBenchmark::addFrame(float frameMs, float recordMs) {
+    if (!running) {
+        return false;
+    }
+
+    frameInConfig++;
+    if (frameInConfig == WARMUP_FRAMES + 1) {
+        results.push_back({ configs[current], 0, 0.f, 0.f, 0.f });
+    }
+    if (frameInConfig <= WARMUP_FRAMES) {
+        return false;
+    }
+
+    Result& result = results.back();
+    result.frames++;
+    result.frameMs += frameMs;
+    result.recordMs += recordMs;
+    result.maxRecordMs = std::max(result.maxRecordMs, recordMs);
+
+    if (result.frames < MEASURED_FRAMES) {
+        return false;
+    }
+
+    result.frameMs /= result.frames;
+    result.recordMs /= result.frames;
+
+    frameInConfig = 0;
+    if (++current == configs.size()) {
+        current = configs.size() - 1;
+        running = false;
+    }
+    return true;
+}
+
+void RecordingBenchmark::writeReport(const std::string& path) const {
+    std::cout << "\nCommand recording benchmark (" << MEASURED_FRAMES << " frames per row)\n";
+    std::cout << std::setw(8) << "zones" << std::setw(10) << "path"
+        << std::setw(12) << "frame ms" << std::setw(12) << "record ms" << std::setw(16) << "max record ms" << "\n";
+
+    std::ofstream csv(path);
+    csv << "draw_multiplier,zones,path,frames,frame_ms,record_ms,max_record_ms\n";
+
+    for (const Result& result : results) {
+        int side = 2 * result.config.drawMultiplier + 1;
+        const char* mode = result.config.parallel ? "parallel" : "inline";
+
+        std::cout << std::setw(8) << side * side << std::setw(10) << mode
+            << std::setw(12) << std::fixed << std::setprecision(3) << result.frameMs
+            << std::setw(12) << result.recordMs << std::setw(16) << result.maxRecordMs << "\n";
+        csv << result.config.drawMultiplier << "," << side * side << "," << mode << "," << result.frames << ","
+            << result.frameMs << "," << result.recordMs << "," << result.maxRecordMs << "\n";
+    }
+    std::cout << "Written to " << path << std::endl;
+}
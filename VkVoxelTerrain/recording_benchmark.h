@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Sweeps the terrain draw radius for both the inline and the parallel
+// (secondary command buffer) recording paths. Each configuration is held for
+// a fixed number of frames after a short warm-up, and the average CPU frame
+// time and command recording time are kept per configuration.
+//
+// Keep the camera still while it runs so every configuration sees the same view.
+class RecordingBenchmark {
+public:
+    struct Config {
+        int drawMultiplier;
+        bool parallel;
+    };
+
+    struct Result {
+        Config config;
+        int frames;
+        float frameMs;      // whole main loop iteration
+        float recordMs;     // recordCommandBuffer only
+        float maxRecordMs;
+    };
+
+    RecordingBenchmark();
+
+    void start(int maxDrawMultiplier);
+    bool isRunning() const { return running; }
+    // The configuration the next frame should be rendered with
+    const Config& currentConfig() const { return configs[current]; }
+    // Feed one frame's timings. Returns true when the configuration changed
+    // (or the sweep finished), so the caller knows to apply it.
+    bool addFrame(float frameMs, float recordMs);
+
+    const std::vector<Result>& getResults() const { return results; }
+    // Prints a table of the results to stdout and writes them as CSV to path
+    void writeReport(const std::string& path) const;
+
+private:
+    static constexpr int WARMUP_FRAMES = 60;
+    static constexpr int MEASURED_FRAMES = 300;
+
+    bool running;
+    std::vector<Config> configs;
+    std::vector<Result> results;
+    size_t current;
+    int frameInConfig;
+};
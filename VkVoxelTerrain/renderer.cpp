@@ -7,6 +7,8 @@
 #include "vulkan_swapchain.h"
 #include "vulkan_resources.h"
 #include "terrain.h"
+#include "trace_recorder.h"
+#include "memory_tracker.h"
 
 #include "external/imgui/imgui.h"
 #include "external/imgui/backends/imgui_impl_vulkan.h"
@@ -17,6 +19,25 @@
 #include <optional>
 #include <set>
 #include <stdexcept>
+#include <chrono>
+#include <future>
+#include <filesystem>
+#include <iostream>
+
+static const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+static const char* TRACE_PATH = "trace.json";
+// F5 records here and F6 replays it
+static const char* RECORDED_PATH = "camera_paths/recorded.campath";
+// keyframes closer together than this aren't recorded
+static const float PATH_RECORD_INTERVAL = 1.f / 30.f;
+// textures/cook.bat writes the cooked atlas next to the PNG
+static const char* ATLAS_COOKED_PATH = "textures/minecraft_textures_all.vtex";
+static const char* ATLAS_PNG_PATH = "textures/minecraft_textures_all.png";
+
+// GPU ranges of each frame, in the profiler
+static const char* GPU_TERRAIN = "terrain (opaque subpass)";
+static const char* GPU_TRANSLUCENT = "water + composite";
+static const char* GPU_IMGUI = "imgui";
 
 static void im_gui_check_vk_result(VkResult err)
 {
@@ -54,22 +75,71 @@ Renderer::Renderer()
     commandPoolTransfer(VK_NULL_HANDLE),
     currentFrame(0),
     mipLevels(),
+    textureFormat(VK_FORMAT_R8G8B8A8_SRGB),
+    textureStats(),
     textureImage(VK_NULL_HANDLE),
     textureImageMemory(VK_NULL_HANDLE),
     textureImageView(VK_NULL_HANDLE),
     textureSampler(VK_NULL_HANDLE),
     msaaSamples(VK_SAMPLE_COUNT_1_BIT),
+    pipelineCache(),
+    startup(),
+    opaqueGpuMs(0.f),
+    statisticsQueryPool(VK_NULL_HANDLE),
+    statisticsInherited(false),
+    statisticsWritten(),
+    statisticsWholePass(),
+    fragmentInvocations(0),
+    fragmentInvocationsWholePass(false),
+    memoryBudgetSupported(false),
     framebufferResized(false),
+    showProfiler(false),
+    ambientOcclusion(true),
+    recordTimeMs(0.f),
+    recordingBenchmark(),
+    overdrawBenchmark(),
+    parallelBeforeOverdraw(true),
+    cameraReplay(),
+    replayReportPath(),
+    startupReplayPath(),
+    exitAfterReplay(false),
+    recordedPath(),
+    recordingPath(false),
+    pathRecordStart(0.f),
     camera(WIDTH, HEIGHT, glm::vec3(32., 150., 32.)),
-    terrain(this)
+    terrain(this),
+    oit(this),
+    simulation(terrain, camera)
 {
     // Empty constructor body
 }
 
+void Renderer::replayOnStart(const std::string& pathFile, const std::string& reportPath) {
+    startupReplayPath = pathFile;
+    replayReportPath = reportPath;
+    exitAfterReplay = true;
+}
+
+void Renderer::startReplay(const std::string& pathFile, const std::string& reportPath) {
+    CameraPath path = CameraPath::load(pathFile);
+    std::string name = std::filesystem::path(pathFile).stem().string();
+    replayReportPath = reportPath.empty() ? "replay_" + name + ".json" : reportPath;
+    // time to visible in the report only covers this run
+    terrain.pipelineStats.reset();
+    cameraReplay.start(path, name);
+}
+
 void Renderer::run() {
-    initWindow();
+    TraceRecorder::instance().setThreadName("main");
+    {
+        StartupTimeline::Scope scope(startup, "window");
+        initWindow();
+    }
     initVulkan();
-    initImGui();
+    {
+        StartupTimeline::Scope scope(startup, "imgui");
+        initImGui();
+    }
     mainLoop();
     cleanup();
 }
@@ -90,8 +160,9 @@ void Renderer::initImGui() {
     init_info.MSAASamples = msaaSamples;
     init_info.UseDynamicRendering = false;
     init_info.RenderPass = renderPass;
-    // init_info.PipelineCache = YOUR_PIPELINE_CACHE;
-    init_info.Subpass = 0;
+    init_info.PipelineCache = pipelineCache.handle();
+    // drawn over the composited scene
+    init_info.Subpass = SUBPASS_COMPOSITE;
     init_info.MinImageCount = 2;
     init_info.ImageCount = swapChainImages.size();
     init_info.CheckVkResultFn = im_gui_check_vk_result;
@@ -118,83 +189,219 @@ void Renderer::framebufferResizeCallback(GLFWwindow* window, int width, int heig
 }
 
 void Renderer::initVulkan() {
-    // Initialize Vulkan instance, devices, surfaces and queues
-    createInstance(instance);
-    setupDebugMessenger(instance, debugMessenger);
-    createSurface(instance, window, surface);
+    // Reading the atlas needs nothing from Vulkan, so it runs while the
+    // device and swapchain are brought up
+    std::future<TextureSource> textureSource = std::async(std::launch::async, [this] {
+        StartupTimeline::Scope scope(startup, "load texture");
+        return loadTextureSource(ATLAS_COOKED_PATH, ATLAS_PNG_PATH);
+    });
 
-    pickPhysicalDevice(instance, surface, physicalDevice);
-    msaaSamples = getMaxUsableSampleCount(physicalDevice); 
+    {
+        StartupTimeline::Scope scope(startup, "instance and device");
 
-    createLogicalDevice(physicalDevice, surface, device, queueGraphics, queuePresent, queueTransfer);
+        // Initialize Vulkan instance, devices, surfaces and queues
+        createInstance(instance);
+        setupDebugMessenger(instance, debugMessenger);
+        createSurface(instance, window, surface);
 
-    // Initialize swapchain
-    createSwapChain(
-        device,
-        physicalDevice,
-        surface,
-        window,
-        swapChain,
-        swapChainImages,
-        swapChainImageFormat,
-        swapChainExtent
-    );
-    createSwapChainImageViews(
-        device,
-        swapChainImageFormat,
-        swapChainImageViews,
-        swapChainImages
-    );
+        pickPhysicalDevice(instance, surface, physicalDevice);
+        msaaSamples = getMaxUsableSampleCount(physicalDevice); 
 
-    // Create commmand pools, per-frame command buffers, sync 
-    createCommandPools();
-    createPerFrameCommandBuffers();
-    createSyncObjects();
+        createLogicalDevice(physicalDevice, surface, device, queueGraphics, queuePresent, queueTransfer);
+        memoryBudgetSupported = isMemoryBudgetSupported(physicalDevice);
+    }
 
-    // create multi-sampled color buffer
-    createColorResources();
+    {
+        StartupTimeline::Scope scope(startup, "load pipeline cache");
+        pipelineCache.init(device, physicalDevice, PIPELINE_CACHE_PATH);
+    }
 
-    // Create depth buffer
-    createDepthResources();
+    {
+        StartupTimeline::Scope scope(startup, "swapchain and targets");
+
+        // Initialize swapchain
+        createSwapChain(
+            device,
+            physicalDevice,
+            surface,
+            window,
+            swapChain,
+            swapChainImages,
+            swapChainImageFormat,
+            swapChainExtent
+        );
+        createSwapChainImageViews(
+            device,
+            swapChainImageFormat,
+            swapChainImageViews,
+            swapChainImages
+        );
 
-    // Create renderpass and framebuffer
-    createRenderPass();
-    createFramebuffers();
+        // Create commmand pools, per-frame command buffers, sync 
+        createCommandPools();
+        createPerFrameCommandBuffers();
+        createSyncObjects();
+        createQueryPools();
+
+        // create multi-sampled color buffer
+        createColorResources();
+
+        // Create depth buffer
+        createDepthResources();
 
-    // Main graphics pipeline
-    terrain.buildPipelines();
+        // translucent pass targets
+        oit.createTargets();
+
+        // Create renderpass and framebuffer
+        createRenderPass();
+        createFramebuffers();
+    }
+
+    // Pipelines only need the render pass. The terrain and composite shaders
+    // are loaded and compiled on their own threads, against the shared
+    // pipeline cache, while this thread uploads the texture.
+    std::future<void> terrainPipelines = std::async(std::launch::async, [this] {
+        StartupTimeline::Scope scope(startup, "terrain pipelines");
+        terrain.buildPipelines();
+    });
+    std::future<void> compositePipeline = std::async(std::launch::async, [this] {
+        StartupTimeline::Scope scope(startup, "composite pipeline");
+        oit.buildPipeline();
+    });
 
     // Inputs to shaders
-    createTextureImage();
-    createTextureImageView();
-    createTextureSampler();
+    TextureSource texture;
+    {
+        StartupTimeline::Scope scope(startup, "wait for texture load");
+        texture = textureSource.get();
+    }
+    {
+        StartupTimeline::Scope scope(startup, "upload texture");
+        createTextureImage(texture);
+        createTextureImageView();
+        createTextureSampler();
+    }
     createUniformBuffers();
     createDescriptorPool();
+
+    // the descriptor sets are allocated with the terrain's set layout
+    {
+        StartupTimeline::Scope scope(startup, "wait for pipelines");
+        terrainPipelines.get();
+        compositePipeline.get();
+    }
     createDescriptorSets();
 }
 
 void Renderer::mainLoop() {
-    float deltaTime = 0.0f; // Time between current frame and last frame
-    float lastFrame = 0.0f; // Time of last frame
+    float firstFrameStart = startup.now();
+
+    if (!startupReplayPath.empty()) {
+        startReplay(startupReplayPath, replayReportPath);
+    }
+
+    // the player moves and the world expands on the simulation thread from
+    // here on; this thread only samples input, uploads and draws
+    simulation.start();
 
     while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        auto frameStart = std::chrono::high_resolution_clock::now();
+
+        {
+            PROFILE_SCOPE("processInput");
+            processInput(window);
+            glfwPollEvents();
+        }
 
-        processInput(window, deltaTime);
-        glfwPollEvents();
+        if (cameraReplay.isRunning()) {
+            // the simulation follows the path so the world expands along it
+            CameraPose pose = cameraReplay.currentPose();
+            camera.setPose(pose.position, pose.yaw, pose.pitch);
+            simulation.setPose(pose.position, pose.yaw, pose.pitch);
+        }
+        else {
+            SimSnapshot pose = simulation.interpolated(Simulation::now());
+            camera.setPose(pose.position, pose.yaw, pose.pitch);
+        }
 
-        terrain.tryExpansion(camera.getPosition());
+        {
+            PROFILE_SCOPE("updateChunks");
+            terrain.updateChunks();
+        }
 
-        ImGui_ImplVulkan_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-        createGUIOverlay();
+        {
+            PROFILE_SCOPE("gui");
+            ImGui_ImplVulkan_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+            createGUIOverlay();
+            if (showProfiler) {
+                Profiler::instance().drawPanel(&showProfiler);
+                if (!showProfiler) {
+                    Profiler::instance().setEnabled(false);
+                }
+            }
+        }
 
         drawFrame();
+        Profiler::instance().endFrame();
+
+        if (!startup.isFinished()) {
+            startup.add("first frame", firstFrameStart, startup.now());
+            startup.finish(pipelineCache.loadedFromDisk()
+                ? "pipeline cache loaded, " + std::to_string(pipelineCache.loadedBytes() / 1024) + " KB"
+                : "cold pipeline cache");
+            // every startup pipeline, ImGui's included, exists by now
+            pipelineCache.save();
+        }
+
+        if (recordingPath) {
+            float time = static_cast<float>(glfwGetTime()) - pathRecordStart;
+            if (recordedPath.empty() || time - recordedPath.duration() >= PATH_RECORD_INTERVAL) {
+                recordedPath.add(time, { camera.getPosition(), camera.getYaw(), camera.getPitch() });
+            }
+        }
+
+        if (cameraReplay.isRunning()) {
+            float frameMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+            if (cameraReplay.addFrame(frameMs)) {
+                CameraReplay::writeReport(cameraReplay.report(terrain.pipelineStats), replayReportPath);
+                if (exitAfterReplay) {
+                    glfwSetWindowShouldClose(window, GLFW_TRUE);
+                }
+            }
+        }
+
+        if (recordingBenchmark.isRunning()) {
+            float frameMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+            if (recordingBenchmark.addFrame(frameMs, recordTimeMs)) {
+                if (recordingBenchmark.isRunning()) {
+                    const RecordingBenchmark::Config& config = recordingBenchmark.currentConfig();
+                    terrain.setDrawMultiplier(config.drawMultiplier);
+                    terrain.parallelRecording = config.parallel;
+                }
+                else {
+                    recordingBenchmark.writeReport("recording_benchmark.csv");
+                }
+            }
+        }
+
+        if (overdrawBenchmark.isRunning()) {
+            float frameMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+            if (overdrawBenchmark.addFrame(fragmentInvocations, opaqueGpuMs, frameMs)) {
+                if (overdrawBenchmark.isRunning()) {
+                    terrain.frontToBack = overdrawBenchmark.currentConfig().frontToBack;
+                    terrain.depthPrepass = overdrawBenchmark.currentConfig().depthPrepass;
+                }
+                else {
+                    overdrawBenchmark.writeReport("overdraw_benchmark.csv");
+                    terrain.parallelRecording = parallelBeforeOverdraw;
+                }
+            }
+        }
     }
 
+    simulation.stop();
     vkDeviceWaitIdle(device);
 }
 
@@ -223,9 +430,180 @@ void Renderer::createGUIOverlay() {
     {
         ImGui::Text("vkMiniMinecraft\n" "by Michael Mason");
         ImGui::Separator();
+        ImGui::Text("Startup: %.0f ms to first frame, pipeline cache %s", startup.timeToFirstFrameMs(),
+            pipelineCache.loadedFromDisk() ? "warm" : "cold");
+        ImGui::Text("Atlas: %s, load %.1f ms, upload %.1f ms, %.0f KB", textureStats.source.c_str(),
+            textureStats.loadMs, textureStats.uploadMs, textureStats.deviceBytes / 1024.f);
+        ImGui::Text("[F3] profiler  [F4] dump last %.0f s of trace to %s", TraceRecorder::instance().windowSeconds, TRACE_PATH);
+        if (cameraReplay.isRunning()) {
+            ImGui::Text("Replaying camera path, input is ignored...");
+        }
+        else if (recordingPath) {
+            ImGui::Text("[F5] stop recording camera path (%zu keyframes)", recordedPath.size());
+        }
+        else {
+            ImGui::Text("[F5] record camera path  [F6] replay %s", RECORDED_PATH);
+        }
         glm::vec3 campos = camera.getPosition();
         ImGui::Text("Camera Position: (%.1f, %.1f, %.1f)", campos.x, campos.y, campos.z);
         ImGui::Text("Zone Location: (%d, %d)", roundDown(int(campos.x), 64), roundDown(int(campos.z), 64)); 
+        Simulation::Stats sim = simulation.stats();
+        ImGui::Text("Simulation: %d Hz, tick %.3f ms, %llu ticks (%llu dropped)", Simulation::TICK_HZ, sim.tickMs,
+            static_cast<unsigned long long>(sim.ticks), static_cast<unsigned long long>(sim.droppedTicks));
+        ImGui::Text("Movement [G]: %s%s  [Space] jump", sim.flying ? "flying" : "walking",
+            !sim.flying && sim.onGround ? " (on ground)" : "");
+        ImGui::Text("Place [1/2]: %s", sim.placeBlock == GLOWSTONE ? "glowstone" : "stone");
+        LightEngine::Stats light = terrain.lightStats();
+        ImGui::Text("Light: %zu chunks, %llu tasks, %llu messages, %llu blocks relit", light.chunks,
+            static_cast<unsigned long long>(light.tasks), static_cast<unsigned long long>(light.messages),
+            static_cast<unsigned long long>(light.cellsChanged));
+        WaterSimulation::Stats waterStats = terrain.waterStats();
+        ImGui::Text("Water: %zu active cells in %zu chunks, %zu flowing, tick %.3f ms", waterStats.activeCells,
+            waterStats.activeChunks, waterStats.flowingCells, waterStats.tickMs);
+        int waterBudget = static_cast<int>(terrain.getWaterBudget());
+        if (ImGui::SliderInt("Water cells per tick", &waterBudget, 256, 65536)) {
+            terrain.setWaterBudget(static_cast<size_t>(waterBudget));
+        }
+        ImGui::Separator();
+        const SectionCullStats& cull = terrain.cullStats;
+        ImGui::Text("Section Culling [C]: %s", terrain.sectionCullingEnabled ? "on" : "off");
+        ImGui::Text("Sections Drawn: %d (culled %d, visited %d)", cull.sectionsDrawn, cull.sectionsCulled, cull.sectionsVisited);
+        ImGui::Text("Cull Time: %.3f ms", cull.cullTimeMs);
+        ImGui::Separator();
+        ImGui::Text("Recording [P]: %s, draw radius %d zones", terrain.parallelRecording ? "parallel" : "inline", terrain.getDrawMultiplier());
+        ImGui::Text("Record Time: %.3f ms (terrain %.3f ms)", recordTimeMs, terrain.drawTimeMs);
+        if (terrain.parallelRecording) {
+            const CommandCacheStats& cache = terrain.cacheStats;
+            int zones = cache.zonesRecorded + cache.zonesReused;
+            ImGui::Text("Command Cache [K]: %s", terrain.commandCaching ? "on" : "off");
+            ImGui::Text("Zones Reused: %d / %d (%.0f%%)", cache.zonesReused, zones, zones > 0 ? 100.f * cache.zonesReused / zones : 0.f);
+            ImGui::Text("Zone Record Time: %.3f ms (saved ~%.3f ms)", cache.recordMs, cache.savedMs);
+            ImGui::Text("Zones Culled: %d", cache.zonesCulled);
+        }
+        if (recordingBenchmark.isRunning()) {
+            ImGui::Text("Benchmark running, keep the camera still...");
+        }
+        else {
+            ImGui::Text("[B] run recording benchmark");
+        }
+        ImGui::Separator();
+        int voxelDistance = (2 * terrain.getDrawMultiplier() + 1) * 32;
+        ImGui::Text("Terrain LOD [L]: %s, view distance %d blocks (voxel %d)", terrain.lod.enabled ? "on" : "off",
+            terrain.lod.enabled ? terrain.lod.getViewDistance() : voxelDistance, voxelDistance);
+        auto lodRow = [](const char* name, const LodLevelStats& level) {
+            ImGui::Text("%s: %d drawn / %d (%d pending), %zu tris, %.1f MB, build %.2f ms", name, level.drawn, level.tiles,
+                level.pending, level.triangles, level.bytes / (1024.f * 1024.f), level.buildMs);
+        };
+        lodRow("1x", terrain.getDetailStats());
+        if (terrain.lod.enabled) {
+            const char* names[LOD_LEVELS] = { "2x", "4x", "8x" };
+            for (int i = 0; i < LOD_LEVELS; i++) {
+                lodRow(names[i], terrain.lod.stats[i]);
+            }
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Opaque Order [F]: %s, Depth Pre-pass [Z]: %s", terrain.frontToBack ? "front to back" : "raster",
+            terrain.depthPrepass ? "on" : "off");
+        ImGui::Text("Ambient Occlusion [V]: %s", ambientOcclusion ? "on" : "off");
+        if (Profiler::instance().hasGpuQueries()) {
+            ImGui::Text("Opaque Pass: %.3f ms GPU", opaqueGpuMs);
+        }
+        if (statisticsQueryPool != VK_NULL_HANDLE && (!terrain.parallelRecording || statisticsInherited)) {
+            ImGui::Text("Fragment Invocations (%s): %llu", fragmentInvocationsWholePass ? "all subpasses" : "opaque",
+                static_cast<unsigned long long>(fragmentInvocations));
+        }
+        else if (statisticsQueryPool != VK_NULL_HANDLE) {
+            ImGui::Text("Fragment Invocations: inline recording only");
+        }
+        if (overdrawBenchmark.isRunning()) {
+            ImGui::Text("Overdraw benchmark running, keep the camera still...");
+        }
+        else if (statisticsQueryPool != VK_NULL_HANDLE) {
+            ImGui::Text("[O] run overdraw benchmark");
+        }
+        ImGui::Separator();
+        const TranslucentStats& water = terrain.translucentStats;
+        ImGui::Text("Water OIT [T]: %s, %d chunks, %zu tris", terrain.translucentPass ? "on" : "off", water.chunksDrawn, water.triangles);
+        if (Profiler::instance().hasGpuQueries()) {
+            ImGui::Text("Translucent + Composite: %.3f ms GPU, %.3f ms record", water.gpuMs, water.recordMs);
+        }
+        else {
+            ImGui::Text("Translucent + Composite: %.3f ms record (no GPU timestamps)", water.recordMs);
+        }
+        ImGui::Separator();
+        if (ImGui::CollapsingHeader("Chunk pipeline")) {
+            const ChunkPipelineStats& pipeline = terrain.pipelineStats;
+            auto row = [](const char* name, const ChunkPipelineStats::Percentiles& p) {
+                ImGui::Text("%-16s p50 %7.1f  p95 %7.1f  p99 %7.1f ms  (%llu)", name, p.p50, p.p95, p.p99,
+                    static_cast<unsigned long long>(p.count));
+            };
+            row("zone visible", pipeline.zoneTimeToVisible());
+            row("chunk visible", pipeline.chunkTimeToVisible());
+            for (int stage = 0; stage < ChunkPipelineStats::STAGE_COUNT; stage++) {
+                row(ChunkPipelineStats::stageName(stage), pipeline.stage(stage));
+            }
+            // block edits, from the click to the new buffer being drawn from
+            ChunkPipelineStats::Percentiles edits = pipeline.editTimeToVisible();
+            row("edit visible", edits);
+            row("remesh", pipeline.remeshTime());
+            const float frameAt144HzMs = 1000.f / 144.f;
+            if (edits.count > 0) {
+                ImGui::Text("Edit p95 %s one 144 Hz frame (%.2f ms), %llu sections remeshed",
+                    edits.p95 <= frameAt144HzMs ? "within" : "over", frameAt144HzMs,
+                    static_cast<unsigned long long>(pipeline.sectionsRemeshed()));
+            }
+            ImGui::SliderFloat("Remesh wait (ms)", &terrain.remeshWaitMs, 0.f, 5.f);
+            ChunkQueueDepths depths = terrain.queueDepths();
+            ImGui::Text("Zones: %d queued, %d generating", depths.zonesQueued, depths.zonesGenerating);
+            ImGui::Text("Chunks: %d pending, %d mesh queued, %d meshing, %d drawable, %d remeshing", depths.chunksPending,
+                depths.chunksMeshQueued, depths.chunksMeshing, depths.chunksDrawable, depths.chunksRemeshing);
+            ImGui::Text("Thread pool: %d tasks queued", depths.poolTasks);
+        }
+
+        if (ImGui::CollapsingHeader("Memory")) {
+            MemoryTracker& memory = MemoryTracker::instance();
+            const float MB = 1024.f * 1024.f;
+            auto row = [MB](const char* name, const MemoryTracker::Usage& usage) {
+                ImGui::Text("%-14s %8.1f MB  peak %8.1f MB  (%llu)", name, usage.bytes / MB, usage.peakBytes / MB,
+                    static_cast<unsigned long long>(usage.count));
+            };
+            ImGui::Text("Host");
+            for (int i = 0; i < MemoryTracker::HOST_CATEGORY_COUNT; i++) {
+                auto category = static_cast<MemoryTracker::HostCategory>(i);
+                row(MemoryTracker::hostCategoryName(category), memory.host(category));
+            }
+            row("total", memory.hostTotal());
+            ImGui::Text("Device");
+            for (int i = 0; i < MemoryTracker::DEVICE_CATEGORY_COUNT; i++) {
+                auto category = static_cast<MemoryTracker::DeviceCategory>(i);
+                row(MemoryTracker::deviceCategoryName(category), memory.device(category));
+            }
+            row("total", memory.deviceTotal());
+
+            // every Chunk holds its blocks, only uploaded ones hold a buffer
+            MemoryTracker::Usage blocks = memory.host(MemoryTracker::HOST_CHUNK_BLOCKS);
+            MemoryTracker::Usage buffers = memory.device(MemoryTracker::DEVICE_CHUNK_BUFFERS);
+            ImGui::Text("Per chunk: %.1f KB blocks, %.1f KB buffer", blocks.count ? blocks.bytes / 1024.f / blocks.count : 0.f,
+                buffers.count ? buffers.bytes / 1024.f / buffers.count : 0.f);
+
+            updateMemoryHeaps(instance, physicalDevice, memoryBudgetSupported);
+            std::vector<MemoryTracker::Heap> heaps = memory.heaps();
+            for (size_t i = 0; i < heaps.size(); i++) {
+                const MemoryTracker::Heap& heap = heaps[i];
+                if (memory.isBudgetSupported()) {
+                    ImGui::Text("Heap %zu%s: %.0f of %.0f MB budget (%.0f MB heap)", i, heap.deviceLocal ? " (device)" : "",
+                        heap.usage / MB, heap.budget / MB, heap.size / MB);
+                }
+                else {
+                    ImGui::Text("Heap %zu%s: %.0f MB, no VK_EXT_memory_budget", i, heap.deviceLocal ? " (device)" : "",
+                        heap.size / MB);
+                }
+            }
+            if (ImGui::Button("Reset peaks")) {
+                memory.resetPeaks();
+            }
+        }
 
         /*int counter = 1;
         for (const auto& chunkID : terrain.m_generatedTerrain) {
@@ -237,7 +615,7 @@ void Renderer::createGUIOverlay() {
     ImGui::End();
 }
 
-void Renderer::processInput(GLFWwindow* window, float delta)
+void Renderer::processInput(GLFWwindow* window)
 {
     static Input input;
     input.reset();
@@ -260,6 +638,113 @@ void Renderer::processInput(GLFWwindow* window, float delta)
     if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
         input.qPressed = true;
     }
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+        input.spacePressed = true;
+    }
+
+    // toggles fire on key release so holding the key doesn't flicker
+    static bool cWasPressed = false, pWasPressed = false, bWasPressed = false, kWasPressed = false, lWasPressed = false,
+        tWasPressed = false, fWasPressed = false, zWasPressed = false, oWasPressed = false, f3WasPressed = false, f4WasPressed = false,
+        f5WasPressed = false, f6WasPressed = false, gWasPressed = false, vWasPressed = false,
+        oneWasPressed = false, twoWasPressed = false;
+    auto released = [window](int key, bool& wasPressed) {
+        bool pressed = glfwGetKey(window, key) == GLFW_PRESS;
+        bool result = wasPressed && !pressed;
+        wasPressed = pressed;
+        return result;
+    };
+    if (released(GLFW_KEY_C, cWasPressed)) {
+        terrain.sectionCullingEnabled = !terrain.sectionCullingEnabled;
+    }
+    if (released(GLFW_KEY_P, pWasPressed)) {
+        terrain.parallelRecording = !terrain.parallelRecording;
+    }
+    if (released(GLFW_KEY_K, kWasPressed)) {
+        terrain.commandCaching = !terrain.commandCaching;
+    }
+    if (released(GLFW_KEY_L, lWasPressed)) {
+        terrain.lod.enabled = !terrain.lod.enabled;
+    }
+    if (released(GLFW_KEY_T, tWasPressed)) {
+        terrain.translucentPass = !terrain.translucentPass;
+    }
+    if (released(GLFW_KEY_F, fWasPressed)) {
+        terrain.frontToBack = !terrain.frontToBack;
+    }
+    if (released(GLFW_KEY_Z, zWasPressed)) {
+        terrain.depthPrepass = !terrain.depthPrepass;
+    }
+    if (released(GLFW_KEY_V, vWasPressed)) {
+        ambientOcclusion = !ambientOcclusion;
+    }
+    if (released(GLFW_KEY_F3, f3WasPressed)) {
+        // the CPU scopes only record while the panel is open
+        showProfiler = !showProfiler;
+        Profiler::instance().setEnabled(showProfiler);
+    }
+    if (released(GLFW_KEY_F4, f4WasPressed)) {
+        auto start = std::chrono::high_resolution_clock::now();
+        int events = TraceRecorder::instance().writeChromeTrace(TRACE_PATH);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        if (events < 0) {
+            std::cerr << "failed to write " << TRACE_PATH << std::endl;
+        }
+        else {
+            std::cout << "wrote " << events << " trace events to " << TRACE_PATH << " in " << ms << " ms" << std::endl;
+        }
+    }
+    if (released(GLFW_KEY_F5, f5WasPressed) && !cameraReplay.isRunning()) {
+        recordingPath = !recordingPath;
+        if (recordingPath) {
+            recordedPath.clear();
+            pathRecordStart = static_cast<float>(glfwGetTime());
+        }
+        else {
+            std::filesystem::create_directories(std::filesystem::path(RECORDED_PATH).parent_path());
+            recordedPath.save(RECORDED_PATH);
+            std::cout << "Recorded " << recordedPath.duration() << " s of camera path to " << RECORDED_PATH << std::endl;
+        }
+    }
+    if (released(GLFW_KEY_F6, f6WasPressed) && !recordingPath && !cameraReplay.isRunning()) {
+        try {
+            startReplay(RECORDED_PATH, "");
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    if (released(GLFW_KEY_O, oWasPressed) && statisticsQueryPool != VK_NULL_HANDLE && !overdrawBenchmark.isRunning()
+        && !recordingBenchmark.isRunning()) {
+        overdrawBenchmark.start();
+        parallelBeforeOverdraw = terrain.parallelRecording;
+        terrain.parallelRecording = false;
+        terrain.frontToBack = overdrawBenchmark.currentConfig().frontToBack;
+        terrain.depthPrepass = overdrawBenchmark.currentConfig().depthPrepass;
+    }
+    if (released(GLFW_KEY_B, bWasPressed) && !recordingBenchmark.isRunning() && !overdrawBenchmark.isRunning()) {
+        recordingBenchmark.start(terrain.getMaxDrawMultiplier());
+        terrain.setDrawMultiplier(recordingBenchmark.currentConfig().drawMultiplier);
+        terrain.parallelRecording = recordingBenchmark.currentConfig().parallel;
+    }
+
+    bool toggleFlying = released(GLFW_KEY_G, gWasPressed);
+    if (released(GLFW_KEY_1, oneWasPressed)) {
+        simulation.setPlaceBlock(STONE);
+    }
+    if (released(GLFW_KEY_2, twoWasPressed)) {
+        simulation.setPlaceBlock(GLOWSTONE);
+    }
+
+    // block edits fire on the press, not the release, so they show sooner
+    static bool leftWasPressed = false, rightWasPressed = false;
+    auto clicked = [window](int button, bool& wasPressed) {
+        bool pressed = glfwGetMouseButton(window, button) == GLFW_PRESS;
+        bool result = pressed && !wasPressed;
+        wasPressed = pressed;
+        return result;
+    };
+    bool breakBlock = clicked(GLFW_MOUSE_BUTTON_LEFT, leftWasPressed);
+    bool placeBlock = clicked(GLFW_MOUSE_BUTTON_RIGHT, rightWasPressed);
 
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
@@ -268,7 +753,10 @@ void Renderer::processInput(GLFWwindow* window, float delta)
     input.mouseX = (int)MOUSE_X;
     input.mouseY = (int)MOUSE_Y;
 
-    camera.processInput(input, delta);
+    // the replay owns the camera while it runs
+    if (!cameraReplay.isRunning()) {
+        simulation.addInput(input, breakBlock, placeBlock, toggleFlying);
+    }
 
     MOUSE_X = 0.f;
     MOUSE_Y = 0.f;
@@ -294,11 +782,13 @@ void Renderer::mouseCallback(GLFWwindow* window, double xpos, double ypos) {
 void Renderer::cleanupSwapChain() {
     vkDestroyImageView(device, colorImageView, nullptr);
     vkDestroyImage(device, colorImage, nullptr);
-    vkFreeMemory(device, colorImageMemory, nullptr);
+    freeDeviceMemory(device, colorImageMemory);
 
     vkDestroyImageView(device, depthImageView, nullptr);
     vkDestroyImage(device, depthImage, nullptr);
-    vkFreeMemory(device, depthImageMemory, nullptr);
+    freeDeviceMemory(device, depthImageMemory);
+
+    oit.destroyTargets();
 
     for (auto framebuffer : swapChainFramebuffers) {
         vkDestroyFramebuffer(device, framebuffer, nullptr);
@@ -322,16 +812,17 @@ void Renderer::cleanup() {
     vkDestroyImageView(device, textureImageView, nullptr);
 
     vkDestroyImage(device, textureImage, nullptr);
-    vkFreeMemory(device, textureImageMemory, nullptr);
+    freeDeviceMemory(device, textureImageMemory);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-        vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+        freeDeviceMemory(device, uniformBuffersMemory[i]);
     }
 
     vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
     terrain.destroyResources();
+    oit.destroyResources();
 
     vkDestroyRenderPass(device, renderPass, nullptr);
 
@@ -341,6 +832,15 @@ void Renderer::cleanup() {
         vkDestroyFence(device, inFlightFences[i], nullptr);
     }
 
+    Profiler::instance().destroyGpuQueries();
+    if (statisticsQueryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device, statisticsQueryPool, nullptr);
+    }
+
+    pipelineCache.save();
+    pipelineCache.cleanup();
+
+    secondaryCommandPools.cleanup();
     vkDestroyCommandPool(device, commandPoolGraphics, nullptr);
     vkDestroyCommandPool(device, commandPoolTransfer, nullptr);
 
@@ -388,6 +888,7 @@ void Renderer::recreateSwapChain() {
     );
     createColorResources();
     createDepthResources();
+    oit.createTargets();
     createFramebuffers();
 }
 
@@ -438,30 +939,122 @@ void Renderer::createRenderPass() {
     colorAttachmentResolveRef.attachment = 2;
     colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pResolveAttachments = &colorAttachmentResolveRef;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-    std::array<VkAttachmentDescription, 3> attachments = { colorAttachment, depthAttachment, colorAttachmentResolve };
+    // weighted blended OIT targets, cleared every frame and only read
+    // inside the pass, so neither is stored
+    VkAttachmentDescription accumAttachment{};
+    accumAttachment.format = OitComposite::ACCUM_FORMAT;
+    accumAttachment.samples = msaaSamples;
+    accumAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    accumAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    accumAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    accumAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    accumAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    accumAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentDescription revealAttachment = accumAttachment;
+    revealAttachment.format = OitComposite::REVEAL_FORMAT;
+
+    // opaque subpass
+    VkSubpassDescription opaqueSubpass{};
+    opaqueSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    opaqueSubpass.colorAttachmentCount = 1;
+    opaqueSubpass.pColorAttachments = &colorAttachmentRef;
+    opaqueSubpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    // translucent subpass: writes the OIT targets, depth tested against the
+    // opaque geometry but never written
+    std::array<VkAttachmentReference, 2> oitAttachmentRefs{};
+    oitAttachmentRefs[0].attachment = 3;
+    oitAttachmentRefs[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    oitAttachmentRefs[1].attachment = 4;
+    oitAttachmentRefs[1].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthReadOnlyRef{};
+    depthReadOnlyRef.attachment = 1;
+    depthReadOnlyRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    VkSubpassDescription translucentSubpass{};
+    translucentSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    translucentSubpass.colorAttachmentCount = static_cast<uint32_t>(oitAttachmentRefs.size());
+    translucentSubpass.pColorAttachments = oitAttachmentRefs.data();
+    translucentSubpass.pDepthStencilAttachment = &depthReadOnlyRef;
+    // the opaque colour isn't touched here but the composite needs it
+    uint32_t preservedColor = 0;
+    translucentSubpass.preserveAttachmentCount = 1;
+    translucentSubpass.pPreserveAttachments = &preservedColor;
+
+    // composite subpass: reads the OIT targets, blends onto the color
+    // attachment and resolves it to the swapchain
+    std::array<VkAttachmentReference, 2> oitInputRefs{};
+    oitInputRefs[0].attachment = 3;
+    oitInputRefs[0].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    oitInputRefs[1].attachment = 4;
+    oitInputRefs[1].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkSubpassDescription compositeSubpass{};
+    compositeSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    compositeSubpass.inputAttachmentCount = static_cast<uint32_t>(oitInputRefs.size());
+    compositeSubpass.pInputAttachments = oitInputRefs.data();
+    compositeSubpass.colorAttachmentCount = 1;
+    compositeSubpass.pColorAttachments = &colorAttachmentRef;
+    compositeSubpass.pResolveAttachments = &colorAttachmentResolveRef;
+
+    std::array<VkSubpassDescription, 3> subpasses = { opaqueSubpass, translucentSubpass, compositeSubpass };
+
+    std::array<VkSubpassDependency, 5> dependencies{};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = SUBPASS_OPAQUE;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // opaque depth has to be complete before water is tested against it
+    dependencies[1].srcSubpass = SUBPASS_OPAQUE;
+    dependencies[1].dstSubpass = SUBPASS_TRANSLUCENT;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    // the composite reads the OIT targets at its own sample
+    dependencies[2].srcSubpass = SUBPASS_TRANSLUCENT;
+    dependencies[2].dstSubpass = SUBPASS_COMPOSITE;
+    dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[2].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    // and blends onto the opaque colour
+    dependencies[3].srcSubpass = SUBPASS_OPAQUE;
+    dependencies[3].dstSubpass = SUBPASS_COMPOSITE;
+    dependencies[3].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[3].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[3].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[3].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[3].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    // the OIT targets are cleared and written again only once the last
+    // frame's composite has read them
+    dependencies[4].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[4].dstSubpass = SUBPASS_TRANSLUCENT;
+    dependencies[4].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[4].srcAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    dependencies[4].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[4].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    std::array<VkAttachmentDescription, 5> attachments = { colorAttachment, depthAttachment, colorAttachmentResolve,
+        accumAttachment, revealAttachment };
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
     renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+    renderPassInfo.pSubpasses = subpasses.data();
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
 
     if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
@@ -514,14 +1107,132 @@ void Renderer::createDescriptorSets() {
     }
 }
 
-void Renderer::createTextureImage() {
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load("textures/minecraft_textures_all.png", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
+Renderer::TextureSource Renderer::loadTextureSource(const char* cookedPath, const char* pngPath) {
+    auto start = std::chrono::high_resolution_clock::now();
+    TextureSource source{};
+    if (!source.cooked.open(cookedPath)) {
+        decodeTexturePixels(source, pngPath);
+    }
+    source.loadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return source;
+}
+
+void Renderer::decodeTexturePixels(TextureSource& source, const char* pngPath) {
+    int channels;
+    source.pixels = stbi_load(pngPath, &source.width, &source.height, &channels, STBI_rgb_alpha);
 
-    if (!pixels) {
+    if (!source.pixels) {
         throw std::runtime_error("failed to load texture image!");
     }
+}
+
+void Renderer::createTextureImage(TextureSource& source) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (source.cooked.isOpen()) {
+        // block compressed formats need textureCompressionBC, and the sampler
+        // filters linearly between mip levels
+        VkFormatProperties properties{};
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, source.cooked.format(), &properties);
+        VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        if ((properties.optimalTilingFeatures & needed) != needed) {
+            std::cout << "Cooked atlas format " << source.cooked.formatName() << " can't be sampled here, decoding the PNG" << std::endl;
+            source.cooked.close();
+            auto decodeStart = std::chrono::high_resolution_clock::now();
+            decodeTexturePixels(source, ATLAS_PNG_PATH);
+            source.loadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+            start = std::chrono::high_resolution_clock::now();
+        }
+    }
+
+    if (source.cooked.isOpen()) {
+        createTextureImageFromCooked(source.cooked);
+        textureStats.source = std::string("cooked ") + source.cooked.formatName();
+        source.cooked.close();
+    }
+    else {
+        createTextureImageFromPixels(source);
+        textureStats.source = "PNG, mips blitted on the GPU";
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, textureImage, &requirements);
+    textureStats.loadMs = source.loadMs;
+    textureStats.uploadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    textureStats.deviceBytes = requirements.size;
+
+    std::cout << "Atlas: " << textureStats.source << ", " << mipLevels << " levels, load " << textureStats.loadMs
+        << " ms, upload " << textureStats.uploadMs << " ms, " << textureStats.deviceBytes / 1024 << " KB of device memory" << std::endl;
+}
+
+void Renderer::createTextureImageFromCooked(const CookedTexture& cooked) {
+    mipLevels = cooked.mipLevels();
+    textureFormat = cooked.format();
+    VkDeviceSize dataSize = cooked.levelDataSize();
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+
+    createBuffer(device, physicalDevice, surface,
+        dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        stagingBuffer, stagingBufferMemory, MemoryTracker::DEVICE_STAGING);
+
+    // every level in one copy, straight out of the mapped file
+    void* data;
+    vkMapMemory(device, stagingBufferMemory, 0, dataSize, 0, &data);
+    memcpy(data, cooked.levelData(), static_cast<size_t>(dataSize));
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    createImage(device, physicalDevice, surface,
+        cooked.width(), cooked.height(), mipLevels, VK_SAMPLE_COUNT_1_BIT,
+        textureFormat,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, MemoryTracker::DEVICE_TEXTURES);
+
+    // one submission: to transfer dst, copy all levels, to shader read
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPoolGraphics);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = textureImage;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+
+    std::vector<VkBufferImageCopy> regions = cooked.copyRegions();
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()), regions.data());
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &barrier);
+
+    endSingleTimeCommands(device, commandPoolGraphics, queueGraphics, commandBuffer);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    freeDeviceMemory(device, stagingBufferMemory);
+}
+
+void Renderer::createTextureImageFromPixels(const TextureSource& source) {
+    int texWidth = source.width, texHeight = source.height;
+    stbi_uc* pixels = source.pixels;
+    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
 
     mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
@@ -532,7 +1243,7 @@ void Renderer::createTextureImage() {
     createBuffer(device, physicalDevice, surface,
         imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        stagingBuffer, stagingBufferMemory);
+        stagingBuffer, stagingBufferMemory, MemoryTracker::DEVICE_STAGING);
 
     // copy image into staging buffer
     void* data;
@@ -548,7 +1259,7 @@ void Renderer::createTextureImage() {
         VK_FORMAT_R8G8B8A8_SRGB,
         VK_IMAGE_TILING_OPTIMAL,
         VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, MemoryTracker::DEVICE_TEXTURES);
 
     // copy staging buffer to image
     transitionImageLayout(device, commandPoolTransfer, queueTransfer,
@@ -566,11 +1277,11 @@ void Renderer::createTextureImage() {
     generateMipmaps(device, physicalDevice, commandPoolGraphics, queueGraphics, textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
 
     vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    freeDeviceMemory(device, stagingBufferMemory);
 }
 
 void Renderer::createTextureImageView() {
-    textureImageView = createImageView(device, textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+    textureImageView = createImageView(device, textureImage, textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
 }
 
 void Renderer::createDepthResources() {
@@ -578,7 +1289,8 @@ void Renderer::createDepthResources() {
     createImage(device, physicalDevice, surface,
         swapChainExtent.width, swapChainExtent.height, 1, msaaSamples,
         depthFormat,
-        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+        VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory,
+        MemoryTracker::DEVICE_ATTACHMENTS);
     depthImageView = createImageView(device, depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
 
@@ -621,7 +1333,8 @@ void Renderer::createUniformBuffers() {
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
             uniformBuffers[i],
-            uniformBuffersMemory[i]
+            uniformBuffersMemory[i],
+            MemoryTracker::DEVICE_UNIFORMS
         );
 
         vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
@@ -632,10 +1345,12 @@ void Renderer::createFramebuffers() {
     swapChainFramebuffers.resize(swapChainImageViews.size());
 
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-        std::array<VkImageView, 3> attachments = {
+        std::array<VkImageView, 5> attachments = {
             colorImageView,
             depthImageView,
             swapChainImageViews[i],
+            oit.accumImageView,
+            oit.revealImageView,
         };
 
         VkFramebufferCreateInfo framebufferInfo{};
@@ -677,6 +1392,8 @@ void Renderer::createCommandPools() {
             throw std::runtime_error("failed to create command pool!");
         }
     }
+
+    secondaryCommandPools.init(device, queueFamilyIndices.graphicsFamily.value(), terrain.threadPool.size() + 1);
 }
 
 void Renderer::createPerFrameCommandBuffers() {
@@ -720,7 +1437,7 @@ void Renderer::createColorResources()
     createImage(device, physicalDevice, surface, swapChainExtent.width, swapChainExtent.height, 1, 
         msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, 
         VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory, MemoryTracker::DEVICE_ATTACHMENTS);
     colorImageView = createImageView(device, colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 }
 
@@ -739,15 +1456,15 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
     renderPassInfo.renderArea.offset = { 0, 0 };
     renderPassInfo.renderArea.extent = swapChainExtent;
 
-    std::array<VkClearValue, 2> clearValues{};
+    std::array<VkClearValue, 5> clearValues{};
     clearValues[0].color = { {0.509, 0.784, 0.898, 1.0f} };  // sky blue! :3
     clearValues[1].depthStencil = { 1.0f, 0 };
+    clearValues[3].color = { {0.f, 0.f, 0.f, 0.f} };        // nothing accumulated
+    clearValues[4].color = { {1.f, 0.f, 0.f, 0.f} };        // fully revealed
 
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
     // update viewport / scissor
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -756,21 +1473,121 @@ void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
     viewport.height = (float)swapChainExtent.height;
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = { 0, 0 };
     scissor.extent = swapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-    // draw
+    // GPU ranges for the opaque subpass, the translucent pass and composite,
+    // and the GUI. Each one ends where the next begins, in whichever command
+    // buffer records that subpass.
+    Profiler& profiler = Profiler::instance();
+    profiler.beginGpuFrame(commandBuffer, currentFrame);
+    uint32_t terrainRange = profiler.gpuBegin(commandBuffer, GPU_TERRAIN);
+
+    // a subpass of secondary command buffers can't begin a query, so there
+    // it spans the render pass and the secondaries inherit it
+    bool countInvocations = statisticsQueryPool != VK_NULL_HANDLE && (!terrain.parallelRecording || statisticsInherited);
+    if (statisticsQueryPool != VK_NULL_HANDLE) {
+        statisticsWritten[currentFrame] = countInvocations;
+        statisticsWholePass[currentFrame] = terrain.parallelRecording;
+        if (countInvocations) {
+            vkCmdResetQueryPool(commandBuffer, statisticsQueryPool, currentFrame, 1);
+        }
+    }
 
-    terrain.draw(camera.getPosition(), commandBuffer, descriptorSets[currentFrame]);
+    uint32_t translucentRange = 0;
+    auto recordTranslucent = [&](VkCommandBuffer cmdBuffer) {
+        profiler.gpuEnd(cmdBuffer, terrainRange);
+        translucentRange = profiler.gpuBegin(cmdBuffer, GPU_TRANSLUCENT);
+        if (terrain.translucentPass) {
+            terrain.drawTranslucent(cmdBuffer, descriptorSets[currentFrame]);
+        }
+        else {
+            terrain.translucentStats = TranslucentStats();
+        }
+    };
+    auto recordComposite = [&](VkCommandBuffer cmdBuffer) {
+        if (terrain.translucentPass) {
+            oit.draw(cmdBuffer);
+        }
+        profiler.gpuEnd(cmdBuffer, translucentRange);
+        uint32_t imguiRange = profiler.gpuBegin(cmdBuffer, GPU_IMGUI);
+        ImGui::Render();
+        ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
+        profiler.gpuEnd(cmdBuffer, imguiRange);
+    };
+
+    if (terrain.parallelRecording) {
+        if (countInvocations) {
+            vkCmdBeginQuery(commandBuffer, statisticsQueryPool, currentFrame, 0);
+        }
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        // safe to reset, drawFrame has waited on this frame's fence
+        secondaryCommandPools.resetFrame(currentFrame);
+
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = renderPass;
+        inheritance.subpass = SUBPASS_OPAQUE;
+        inheritance.framebuffer = swapChainFramebuffers[imageIndex];
+        // always, so the cached zone buffers can run with or without the query
+        if (statisticsInherited) {
+            inheritance.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        }
 
-    ImGui::Render();
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+        std::vector<VkCommandBuffer> secondaryBuffers = terrain.drawParallel(camera.getPosition(), camera.getForward(),
+            inheritance, viewport, scissor, currentFrame, descriptorSets[currentFrame]);
+        if (!secondaryBuffers.empty()) {
+            vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+        }
+
+        // nothing can be recorded inline in these subpasses either, so the
+        // translucent pass and the composite + GUI get a secondary command
+        // buffer each, from the main thread's slot
+        size_t mainSlot = secondaryCommandPools.slotCount() - 1;
+        auto recordSubpass = [&](uint32_t subpass, auto record) {
+            vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            inheritance.subpass = subpass;
+            VkCommandBuffer cmdBuffer = secondaryCommandPools.acquire(currentFrame, mainSlot);
+            beginSecondaryCommandBuffer(cmdBuffer, inheritance);
+            vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+            vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+            record(cmdBuffer);
+            if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to record subpass command buffer!");
+            }
+            vkCmdExecuteCommands(commandBuffer, 1, &cmdBuffer);
+        };
+        recordSubpass(SUBPASS_TRANSLUCENT, recordTranslucent);
+        recordSubpass(SUBPASS_COMPOSITE, recordComposite);
+    }
+    else {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        // draw
+        if (countInvocations) {
+            vkCmdBeginQuery(commandBuffer, statisticsQueryPool, currentFrame, 0);
+        }
+        terrain.draw(camera.getPosition(), camera.getForward(), commandBuffer, descriptorSets[currentFrame]);
+        if (countInvocations) {
+            vkCmdEndQuery(commandBuffer, statisticsQueryPool, currentFrame);
+        }
+
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+        recordTranslucent(commandBuffer);
+
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+        recordComposite(commandBuffer);
+    }
 
     vkCmdEndRenderPass(commandBuffer);
+    if (countInvocations && terrain.parallelRecording) {
+        vkCmdEndQuery(commandBuffer, statisticsQueryPool, currentFrame);
+    }
 
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
@@ -782,6 +1599,7 @@ void Renderer::updateUniformBuffer(uint32_t currentImage) {
     ubo.model = glm::mat4(1.0f);
 
     ubo.viewproj = camera.getViewProjectionMatrix();
+    ubo.aoStrength = ambientOcclusion ? 1.f : 0.f;
     memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
 }
 
@@ -806,11 +1624,57 @@ void Renderer::createSyncObjects() {
     }
 }
 
+void Renderer::createQueryPools() {
+    Profiler::instance().createGpuQueries(device, physicalDevice, MAX_FRAMES_IN_FLIGHT);
+
+    // createLogicalDevice enables the features when they are supported
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    if (features.pipelineStatisticsQuery) {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolInfo.queryCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        queryPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+        if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &statisticsQueryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+        }
+        statisticsWritten.assign(MAX_FRAMES_IN_FLIGHT, false);
+        statisticsWholePass.assign(MAX_FRAMES_IN_FLIGHT, false);
+        statisticsInherited = features.inheritedQueries;
+    }
+}
+
+void Renderer::readFrameQueries() {
+    Profiler& profiler = Profiler::instance();
+    profiler.readGpuFrame(currentFrame);
+    opaqueGpuMs = profiler.lastMs(GPU_TERRAIN);
+    terrain.translucentStats.gpuMs = profiler.lastMs(GPU_TRANSLUCENT);
+
+    if (statisticsQueryPool != VK_NULL_HANDLE && statisticsWritten[currentFrame]) {
+        uint64_t invocations;
+        if (vkGetQueryPoolResults(device, statisticsQueryPool, currentFrame, 1, sizeof(invocations), &invocations,
+            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            fragmentInvocations = invocations;
+            fragmentInvocationsWholePass = statisticsWholePass[currentFrame];
+        }
+    }
+}
+
 void Renderer::drawFrame() {
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    {
+        PROFILE_SCOPE("vkWaitForFences");
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+    readFrameQueries();
 
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result;
+    {
+        PROFILE_SCOPE("vkAcquireNextImageKHR");
+        result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
@@ -823,7 +1687,12 @@ void Renderer::drawFrame() {
     vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
     vkResetCommandBuffer(commandBuffersGraphics[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
-    recordCommandBuffer(commandBuffersGraphics[currentFrame], imageIndex);
+    auto recordStart = std::chrono::high_resolution_clock::now();
+    {
+        PROFILE_SCOPE("recordCommandBuffer");
+        recordCommandBuffer(commandBuffersGraphics[currentFrame], imageIndex);
+    }
+    recordTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
 
     updateUniformBuffer(currentFrame);
 
@@ -843,8 +1712,11 @@ void Renderer::drawFrame() {
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(queueGraphics, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+    {
+        PROFILE_SCOPE("vkQueueSubmit");
+        if (vkQueueSubmit(queueGraphics, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
     }
 
     VkPresentInfoKHR presentInfo{};
@@ -859,7 +1731,10 @@ void Renderer::drawFrame() {
 
     presentInfo.pImageIndices = &imageIndex;
 
-    result = vkQueuePresentKHR(queuePresent, &presentInfo);
+    {
+        PROFILE_SCOPE("vkQueuePresentKHR");
+        result = vkQueuePresentKHR(queuePresent, &presentInfo);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
         framebufferResized = false;
@@ -5,26 +5,69 @@
 #include "glm_includes.h"
 #include "terrain.h"
 #include "camera_fps.h"
+#include "framecommandpools.h"
+#include "recording_benchmark.h"
+#include "overdraw_benchmark.h"
+#include "camera_replay.h"
+#include "oit_composite.h"
+#include "pipeline_cache.h"
+#include "startup_timeline.h"
+#include "cooked_texture.h"
+#include "profiler.h"
+#include "simulation.h"
+
+#include <string>
 
 class Renderer {
     friend Terrain;
+    friend TerrainLod;
+    friend OitComposite;
 public:
     Renderer(); 
     void run();
+    // Replays the camera path file once the renderer is up, writes the
+    // report to reportPath (replay_<name>.json if empty) and quits
+    void replayOnStart(const std::string& pathFile, const std::string& reportPath);
 
 private:
+    // The atlas as read off the main thread: the cooked container when there
+    // is one, otherwise RGBA8 pixels decoded by stb_image, freed once uploaded
+    struct TextureSource {
+        CookedTexture cooked;
+        int width;
+        int height;
+        stbi_uc* pixels;
+        float loadMs;       // mapping or decoding
+    };
+
+    // How the atlas got to the GPU, for the overlay
+    struct TextureLoadStats {
+        std::string source;
+        float loadMs;
+        float uploadMs;
+        VkDeviceSize deviceBytes;
+    };
+
     void initWindow();
     void initVulkan();
     void initImGui();
     void mainLoop();
-    void processInput(GLFWwindow* window, float delta);
+    // Samples the keyboard and mouse for the simulation, and handles the toggles
+    void processInput(GLFWwindow* window);
     void createGUIOverlay();
     void cleanup();
     void cleanupSwapChain();
     void recreateSwapChain();
     void createRenderPass();
     void createDescriptorSets();
-    void createTextureImage();
+    static TextureSource loadTextureSource(const char* cookedPath, const char* pngPath);
+    static void decodeTexturePixels(TextureSource& source, const char* pngPath);
+    // Creates textureImage from whichever form the source holds
+    void createTextureImage(TextureSource& source);
+    // Loads the camera path and starts flying it; throws if it can't be read
+    void startReplay(const std::string& pathFile, const std::string& reportPath);
+    void createTextureImageFromCooked(const CookedTexture& cooked);
+    void createTextureImageFromPixels(const TextureSource& source);
     void createTextureImageView();
     void createDepthResources();
     void createTextureSampler();
@@ -37,6 +80,10 @@ private:
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
     void updateUniformBuffer(uint32_t currentImage);
     void createSyncObjects();
+    void createQueryPools();
+    // Reads the timestamps and pipeline statistics of the frame slot that is
+    // about to be reused, once its fence has been waited on
+    void readFrameQueries();
     void drawFrame();
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
@@ -74,12 +121,17 @@ private:
 
     VkCommandPool commandPoolGraphics, commandPoolTransfer;
     std::vector<VkCommandBuffer> commandBuffersGraphics;
+    // secondary command buffers for parallel terrain recording, one slot per
+    // worker thread plus one for the main thread
+    FrameCommandPools secondaryCommandPools;
 
     std::vector<VkSemaphore> imageAvailableSemaphores, renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
     uint32_t currentFrame;
 
     uint32_t mipLevels; 
+    VkFormat textureFormat;
+    TextureLoadStats textureStats;
     VkImage textureImage;
     VkDeviceMemory textureImageMemory;
     VkImageView textureImageView;
@@ -87,13 +139,55 @@ private:
 
     VkSampleCountFlagBits msaaSamples; 
 
+    // shared by every pipeline, saved to disk after the first frame and on exit
+    PipelineCache pipelineCache;
+    StartupTimeline startup;
+
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
 
+    // GPU time of the opaque subpass, from the profiler's GPU_TERRAIN range
+    float opaqueGpuMs;
+    // fragment shader invocations, one query per frame in flight. Inline it
+    // covers the opaque subpass. With secondary command buffers the query
+    // can only be begun outside the render pass, so it covers every subpass,
+    // and needs the inheritedQueries feature to be active while they run.
+    // VK_NULL_HANDLE if pipeline statistics aren't supported.
+    VkQueryPool statisticsQueryPool;
+    bool statisticsInherited;
+    // per frame in flight: the query was written, and spans the whole render pass
+    std::vector<bool> statisticsWritten;
+    std::vector<bool> statisticsWholePass;
+    uint64_t fragmentInvocations;
+    bool fragmentInvocationsWholePass;
+    // VK_EXT_memory_budget was enabled, so the memory panel shows the driver's budget
+    bool memoryBudgetSupported;
+
     bool framebufferResized;
+    bool showProfiler;
+    // baked ambient occlusion shading, off to compare its GPU cost
+    bool ambientOcclusion;
+    float recordTimeMs;
+    RecordingBenchmark recordingBenchmark;
+    OverdrawBenchmark overdrawBenchmark;
+    // recording path to go back to when the overdraw benchmark finishes
+    bool parallelBeforeOverdraw;
+    CameraReplay cameraReplay;
+    std::string replayReportPath;
+    // set by replayOnStart
+    std::string startupReplayPath;
+    bool exitAfterReplay;
+    // the camera path being recorded with F5
+    CameraPath recordedPath;
+    bool recordingPath;
+    float pathRecordStart;
+    // drawn from: the simulation's player, interpolated between ticks, or
+    // the camera path being replayed
     CameraFPS camera;
     Terrain terrain;
+    OitComposite oit;
+    Simulation simulation;
 };
 
 #endif // RENDERER_H
@@ -1,5 +1,18 @@
-C:/VulkanSDK/1.4.313.0/Bin/glslc.exe shader.vert -o vert.spv
-C:/VulkanSDK/1.4.313.0/Bin/glslc.exe shader.frag -o frag.spv
-C:/VulkanSDK/1.4.313.0/Bin/glslc.exe shader_chunked.vert -o vert_chunked.spv
-C:/VulkanSDK/1.4.313.0/Bin/glslc.exe shader_chunked.frag -o frag_chunked.spv
+rem Compiles the GLSL shaders into the .spv files the renderer loads. The
+rem project's pre-build step runs this; the .spv files aren't committed, so
+rem the shaders have to be built before the first run. Needs the Vulkan SDK,
+rem found through the VULKAN_SDK variable its installer sets.
+if not defined VULKAN_SDK (
+    echo VULKAN_SDK is not set, install the Vulkan SDK to compile the shaders
+    exit /b 1
+)
+set GLSLC="%VULKAN_SDK%\Bin\glslc.exe"
+%GLSLC% shader.vert -o vert.spv || exit /b 1
+%GLSLC% shader.frag -o frag.spv || exit /b 1
+%GLSLC% shader_chunked.vert -o vert_chunked.spv || exit /b 1
+%GLSLC% shader_chunked.frag -o frag_chunked.spv || exit /b 1
+%GLSLC% shader_water.frag -o frag_water.spv || exit /b 1
+%GLSLC% shader_composite.vert -o vert_composite.spv || exit /b 1
+%GLSLC% shader_composite.frag -o frag_composite.spv || exit /b 1
+%GLSLC% -DMULTISAMPLED shader_composite.frag -o frag_composite_ms.spv || exit /b 1
 echo Ran Compile Script
\ No newline at end of file
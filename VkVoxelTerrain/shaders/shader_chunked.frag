@@ -5,6 +5,8 @@ layout(binding = 1) uniform sampler2D texSampler;
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragNormal;  // Interpolated normal from vertex shader
+layout(location = 3) in float fragAo;      // baked ambient occlusion, 1 where unoccluded
+layout(location = 4) in float fragLight;   // sky or block light, whichever is brighter
 
 layout(location = 0) out vec4 outColor;
 
@@ -20,7 +22,7 @@ void main() {
 
     // Sample the texture and apply diffuse shading and vertex color
     vec4 texColor = texture(texSampler, fragTexCoord);
-    vec3 shadedColor = texColor.rgb * diff;
+    vec3 shadedColor = texColor.rgb * diff * fragAo * fragLight;
 
     outColor = vec4(shadedColor, texColor.a);
 }
@@ -3,6 +3,7 @@
 layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 viewproj;
+    float aoStrength;
 } ubo;
 
 
@@ -10,15 +11,32 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal; 
 layout(location = 2) in vec3 inColor;
 layout(location = 3) in vec2 inTexCoord;
+layout(location = 4) in uint inAo;
+layout(location = 5) in vec2 inLight;      // sky light, block light, 0 to 1
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 outNormal; 
+layout(location = 3) out float fragAo;
+layout(location = 4) out float fragLight;
+
+// brightness of each baked ambient occlusion level, 0 the most occluded
+const float AO_CURVE[4] = float[](0.5, 0.7, 0.85, 1.0);
+// each light level is this much dimmer than the one above it, and nothing
+// is darker than MIN_LIGHT so caves can still be made out
+const float LIGHT_FALLOFF = 0.8;
+const float MIN_LIGHT = 0.05;
+
+// the depth pre-pass and the EQUAL colour pass must compute identical depths
+invariant gl_Position;
 
 void main() {
     gl_Position = ubo.viewproj * ubo.model * vec4(inPosition, 1.0);
     fragColor = inColor; 
     fragTexCoord = inTexCoord;
+    fragAo = mix(1.0, AO_CURVE[inAo], ubo.aoStrength);
+    float level = max(inLight.x, inLight.y) * 15.0;
+    fragLight = max(pow(LIGHT_FALLOFF, 15.0 - level), MIN_LIGHT);
 
     mat3 normalMatrix = transpose(inverse(mat3(ubo.model)));
     outNormal = normalize(normalMatrix * inNormal);
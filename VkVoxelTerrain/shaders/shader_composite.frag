@@ -0,0 +1,29 @@
+#version 450
+
+// Resolves the weighted blended translucent targets over the opaque colour.
+// Blended with src alpha / one minus src alpha. Compiled twice: with
+// MULTISAMPLED defined the targets are read per sample.
+
+#ifdef MULTISAMPLED
+layout(input_attachment_index = 0, binding = 0) uniform subpassInputMS accumInput;
+layout(input_attachment_index = 1, binding = 1) uniform subpassInputMS revealInput;
+#define LOAD(target) subpassLoad(target, gl_SampleID)
+#else
+layout(input_attachment_index = 0, binding = 0) uniform subpassInput accumInput;
+layout(input_attachment_index = 1, binding = 1) uniform subpassInput revealInput;
+#define LOAD(target) subpassLoad(target)
+#endif
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float reveal = LOAD(revealInput).r;
+    // nothing translucent covers this sample
+    if (reveal >= 0.9999) {
+        discard;
+    }
+
+    vec4 accum = LOAD(accumInput);
+    vec3 average = accum.rgb / max(accum.a, 1e-5);
+    outColor = vec4(average, 1.0 - reveal);
+}
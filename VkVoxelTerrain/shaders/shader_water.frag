@@ -0,0 +1,36 @@
+#version 450
+
+// Translucent pass of weighted blended order-independent transparency
+// (McGuire & Bavoil 2013). Every fragment is added into the accumulation
+// target weighted by its depth, and multiplies the revealage target by
+// (1 - alpha), so the draw order doesn't matter.
+
+layout(binding = 1) uniform sampler2D texSampler;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragNormal;
+layout(location = 4) in float fragLight;
+
+layout(location = 0) out vec4 outAccum;
+layout(location = 1) out float outReveal;
+
+const float WATER_ALPHA = 0.6;
+
+void main() {
+    // same lighting as shader_chunked.frag
+    vec3 lightDir = normalize(vec3(1.0, 1.0, -1.0));
+    vec3 N = normalize(fragNormal);
+    float diff = max(dot(N, lightDir), 0.4);
+
+    vec4 texColor = texture(texSampler, fragTexCoord);
+    vec3 color = texColor.rgb * diff * fragLight;
+    float alpha = WATER_ALPHA;
+
+    // weight function (eq. 10 of the paper), nearer fragments count for more
+    float z = gl_FragCoord.z;
+    float weight = clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - z * 0.9, 3.0), 1e-2, 3e3);
+
+    outAccum = vec4(color * alpha, alpha) * weight;
+    outReveal = alpha;
+}
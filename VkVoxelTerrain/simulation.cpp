@@ -0,0 +1,221 @@
+#include "simulation.h"
+#include "terrain.h"
+#include "trace_recorder.h"
+
+#include <stdexcept>
+
+// how far away blocks can be broken or placed with the mouse
+static const float BLOCK_REACH = 3.f;
+
+Simulation::Simulation(Terrain& terrain, const CameraFPS& startCamera)
+    : terrain(terrain), camera(startCamera), player(), thread(), running(false), inputMutex(), pendingInput(),
+    pendingBreak(false), pendingPlace(false), pendingToggleFlying(false), poseSet(false), pendingPose(), snapshotMutex(),
+    snapshots(), droppedTicks(0), tickMs(0.f), flying(true), onGround(false),
+    placeType(STONE)
+{
+    player.position = camera.getPosition() - glm::vec3(0.f, EYE_HEIGHT, 0.f);
+    SimSnapshot first;
+    first.position = camera.getPosition();
+    first.yaw = camera.getYaw();
+    first.pitch = camera.getPitch();
+    snapshots[0] = snapshots[1] = first;
+}
+
+Simulation::~Simulation() {
+    stop();
+}
+
+double Simulation::now() {
+    return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+}
+
+void Simulation::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    thread.join();
+}
+
+void Simulation::addInput(const Input& input, bool breakBlock, bool placeBlock, bool toggleFlying) {
+    std::lock_guard<std::mutex> lock(inputMutex);
+    int mouseX = pendingInput.mouseX + input.mouseX;
+    int mouseY = pendingInput.mouseY + input.mouseY;
+    pendingInput = input;
+    pendingInput.mouseX = mouseX;
+    pendingInput.mouseY = mouseY;
+    pendingBreak = pendingBreak || breakBlock;
+    pendingPlace = pendingPlace || placeBlock;
+    pendingToggleFlying = pendingToggleFlying != toggleFlying;
+}
+
+void Simulation::setPose(const glm::vec3& position, float yaw, float pitch) {
+    std::lock_guard<std::mutex> lock(inputMutex);
+    poseSet = true;
+    pendingPose.position = position;
+    pendingPose.yaw = yaw;
+    pendingPose.pitch = pitch;
+}
+
+void Simulation::setPlaceBlock(BlockType type) {
+    placeType = type;
+}
+
+SimSnapshot Simulation::interpolated(double now) const {
+    SimSnapshot previous, current;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        previous = snapshots[0];
+        current = snapshots[1];
+    }
+    // the latest tick shows in full one tick after it was due
+    float alpha = static_cast<float>(glm::clamp((now - current.time) / TICK_SECONDS, 0.0, 1.0));
+    SimSnapshot result = current;
+    result.position = glm::mix(previous.position, current.position, alpha);
+    result.yaw = glm::mix(previous.yaw, current.yaw, alpha);
+    result.pitch = glm::mix(previous.pitch, current.pitch, alpha);
+    return result;
+}
+
+SimSnapshot Simulation::latest() const {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    return snapshots[1];
+}
+
+Simulation::Stats Simulation::stats() const {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    return { snapshots[1].tick, droppedTicks.load(), tickMs.load(), flying.load(), onGround.load(), placeType.load() };
+}
+
+void Simulation::run() {
+    TraceRecorder::instance().setThreadName("simulation");
+    const auto tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(TICK_SECONDS));
+    Clock::time_point next = Clock::now();
+    uint64_t tickNumber = latest().tick;
+
+    while (running.load()) {
+        tick(++tickNumber, std::chrono::duration<double>(next.time_since_epoch()).count());
+        next += tickDuration;
+
+        // after a stall (a breakpoint, the machine sleeping) run a few ticks
+        // back to back, but don't try to make up for all of it
+        Clock::time_point now = Clock::now();
+        if (now - next > tickDuration * MAX_CATCH_UP_TICKS) {
+            uint64_t behind = static_cast<uint64_t>((now - next) / tickDuration);
+            droppedTicks += behind;
+            next += tickDuration * behind;
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+static bool overlapsBlock(const Aabb& box, const glm::ivec3& block) {
+    glm::vec3 lo(block), hi = lo + 1.f;
+    return box.min.x < hi.x && box.max.x > lo.x && box.min.y < hi.y && box.max.y > lo.y
+        && box.min.z < hi.z && box.max.z > lo.z;
+}
+
+BodyControl Simulation::steer(const Input& input) {
+    BodyControl control;
+    if (player.flying) {
+        // where the camera points, up and down included
+        glm::vec3 direction(0.f);
+        direction += camera.getForward() * static_cast<float>(input.wPressed - input.sPressed);
+        direction += camera.getRight() * static_cast<float>(input.dPressed - input.aPressed);
+        direction += camera.getUp() * static_cast<float>(input.ePressed - input.qPressed);
+        control.moveVelocity = direction * camera.getMovementSpeed();
+        return control;
+    }
+    // level with the ground, however far up or down the camera looks
+    glm::vec3 forward = camera.getForward();
+    forward.y = 0.f;
+    forward = glm::length(forward) > 0.f ? glm::normalize(forward) : glm::vec3(0.f);
+    glm::vec3 right = camera.getRight();
+    glm::vec3 direction = forward * static_cast<float>(input.wPressed - input.sPressed)
+        + right * static_cast<float>(input.dPressed - input.aPressed);
+    if (glm::length(direction) > 0.f) {
+        direction = glm::normalize(direction);
+    }
+    control.moveVelocity = direction * WALK_SPEED;
+    control.jump = input.spacePressed;
+    return control;
+}
+
+void Simulation::tick(uint64_t tickNumber, double time) {
+    TRACE_SCOPE("simulation tick", "simulation");
+    auto start = Clock::now();
+
+    Input input;
+    bool breakBlock, placeBlock, toggleFlying, teleported;
+    SimSnapshot pose;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        input = pendingInput;
+        breakBlock = pendingBreak;
+        placeBlock = pendingPlace;
+        toggleFlying = pendingToggleFlying;
+        teleported = poseSet;
+        pose = pendingPose;
+        pendingInput.mouseX = 0;
+        pendingInput.mouseY = 0;
+        pendingBreak = pendingPlace = pendingToggleFlying = poseSet = false;
+    }
+
+    if (teleported) {
+        camera.setPose(pose.position, pose.yaw, pose.pitch);
+        player.position = pose.position - glm::vec3(0.f, EYE_HEIGHT, 0.f);
+        player.velocity = glm::vec3(0.f);
+    }
+    if (toggleFlying) {
+        player.flying = !player.flying;
+        player.velocity = glm::vec3(0.f);
+    }
+    camera.processMouse(input.mouseX, input.mouseY);
+    // a fixed step, so movement is the same at any frame rate
+    terrain.stepBody(player, steer(input), static_cast<float>(TICK_SECONDS));
+    camera.setPose(player.position + glm::vec3(0.f, EYE_HEIGHT, 0.f), camera.getYaw(), camera.getPitch());
+    flying = player.flying;
+    onGround = player.onGround;
+
+    if (breakBlock || placeBlock) {
+        RayHit hit = terrain.raycast(camera.getPosition(), camera.getForward(), BLOCK_REACH);
+        try {
+            if (hit.hit && breakBlock) {
+                terrain.setBlockAt(hit.block.x, hit.block.y, hit.block.z, EMPTY);
+            }
+            // not from inside a block, or it would replace the one the camera
+            // is in, and not where the player stands, or they would be stuck in it
+            else if (hit.hit && placeBlock && hit.normal != glm::ivec3(0) && !overlapsBlock(player.bounds(), hit.previous)) {
+                terrain.setBlockAt(hit.previous.x, hit.previous.y, hit.previous.z, placeType.load());
+            }
+        }
+        catch (const std::out_of_range&) {
+            // the face was on the edge of the world or a Chunk that isn't there yet
+        }
+    }
+
+    if (tickNumber % WATER_TICK_INTERVAL == 0) {
+        terrain.tickWater();
+    }
+    terrain.tryExpansion(camera.getPosition());
+
+    SimSnapshot snapshot;
+    snapshot.tick = tickNumber;
+    snapshot.time = time;
+    snapshot.position = camera.getPosition();
+    snapshot.yaw = camera.getYaw();
+    snapshot.pitch = camera.getPitch();
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        // a teleport isn't interpolated across
+        snapshots[0] = teleported ? snapshot : snapshots[1];
+        snapshots[1] = snapshot;
+    }
+    tickMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
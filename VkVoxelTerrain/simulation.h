@@ -0,0 +1,111 @@
+#pragma once
+#include "glm_includes.h"
+#include "camera_fps.h"
+#include "types.h"
+#include "voxel_collision.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+class Terrain;
+
+// The player's state after one simulation tick, what the render thread draws from
+struct SimSnapshot {
+    uint64_t tick = 0;
+    double time = 0.0;      // Simulation::now() the tick was due at
+    glm::vec3 position = glm::vec3(0.f);
+    float yaw = 0.f;        // degrees, like CameraFPS
+    float pitch = 0.f;
+};
+
+// Runs the game state (the player's body and camera, block edits, flowing
+// water, which zones to generate) on its own thread at a fixed TICK_HZ, so
+// movement doesn't depend on the frame rate and a slow frame (a long chunk
+// upload, say) doesn't hold up input. Each tick publishes a snapshot; the render thread
+// draws between the last two, a tick behind, so motion stays smooth at any
+// frame rate. Neither thread waits on the other beyond a copy under a lock.
+class Simulation {
+public:
+    static constexpr int TICK_HZ = 60;
+    static constexpr double TICK_SECONDS = 1.0 / TICK_HZ;
+    // ticks the simulation will run back to back to catch up after a stall,
+    // any more are dropped
+    static constexpr int MAX_CATCH_UP_TICKS = 5;
+    // blocks per second on foot; flying uses the camera's speed
+    static constexpr float WALK_SPEED = 4.3f;
+    // from the bottom of the player's body up to the camera
+    static constexpr float EYE_HEIGHT = 1.6f;
+    // water moves a block every this many ticks, 15 times a second
+    static constexpr int WATER_TICK_INTERVAL = 4;
+
+    // Starts the player where startCamera is
+    Simulation(Terrain& terrain, const CameraFPS& startCamera);
+    ~Simulation();
+
+    void start();
+    void stop();
+
+    // Render thread: the keys held now, and the mouse movement and clicks
+    // since the last call. Mouse movement, clicks and toggleFlying add up
+    // until a tick takes them. toggleFlying switches between flying and
+    // walking with gravity.
+    void addInput(const Input& input, bool breakBlock, bool placeBlock, bool toggleFlying);
+    // Moves the player's camera there and stops it, without interpolating
+    // from where it was. For replaying a camera path.
+    void setPose(const glm::vec3& position, float yaw, float pitch);
+    // The block a place click puts down, STONE to begin with
+    void setPlaceBlock(BlockType type);
+
+    // The pose to draw at time now: between the last two snapshots, a tick behind
+    SimSnapshot interpolated(double now) const;
+    SimSnapshot latest() const;
+
+    struct Stats {
+        uint64_t ticks;
+        uint64_t droppedTicks;     // skipped to catch up after a stall
+        float tickMs;              // CPU time of the last tick
+        bool flying;
+        bool onGround;
+        BlockType placeBlock;
+    };
+    Stats stats() const;
+
+    // Seconds on the clock snapshots are stamped with
+    static double now();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Terrain& terrain;
+    // only touched on the simulation thread once it is running
+    CameraFPS camera;
+    PhysicsBody player;
+
+    std::thread thread;
+    std::atomic<bool> running;
+
+    std::mutex inputMutex;
+    Input pendingInput;
+    bool pendingBreak;
+    bool pendingPlace;
+    bool pendingToggleFlying;
+    bool poseSet;
+    SimSnapshot pendingPose;
+
+    // [0] the tick before [1], the latest
+    mutable std::mutex snapshotMutex;
+    SimSnapshot snapshots[2];
+
+    std::atomic<uint64_t> droppedTicks;
+    std::atomic<float> tickMs;
+    std::atomic<bool> flying;
+    std::atomic<bool> onGround;
+    std::atomic<BlockType> placeType;
+
+    void run();
+    void tick(uint64_t tickNumber, double time);
+    // What the held keys ask the player's body to do
+    BodyControl steer(const Input& input);
+};
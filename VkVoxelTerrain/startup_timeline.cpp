@@ -0,0 +1,64 @@
+#include "startup_timeline.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+// Taken during static initialisation, before main runs
+static const StartupTimeline::Clock::time_point PROCESS_START = StartupTimeline::Clock::now();
+
+StartupTimeline::Scope::Scope(StartupTimeline& timeline, const char* name)
+    : timeline(timeline), name(name), startMs(timeline.now())
+{
+}
+
+StartupTimeline::Scope::~Scope() {
+    timeline.add(name, startMs, timeline.now());
+}
+
+StartupTimeline::StartupTimeline()
+    : mutex(), spans(), mainThread(std::this_thread::get_id()), finished(false), firstFrameMs(0.f)
+{
+}
+
+float StartupTimeline::now() const {
+    return std::chrono::duration<float, std::milli>(Clock::now() - PROCESS_START).count();
+}
+
+void StartupTimeline::add(const char* name, float startMs, float endMs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    spans.push_back({ name, startMs, endMs, std::this_thread::get_id() });
+}
+
+void StartupTimeline::finish(const std::string& note) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (finished) {
+        return;
+    }
+    finished = true;
+    firstFrameMs = now();
+
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.startMs < b.startMs; });
+
+    // worker threads are numbered in the order they first appear
+    std::map<std::thread::id, int> workers;
+    std::cout << "\nStartup timeline (ms since process start)\n";
+    std::cout << std::left << std::setw(28) << "step" << std::right << std::setw(10) << "start"
+        << std::setw(10) << "end" << std::setw(10) << "ms" << "  thread\n";
+    for (const Span& span : spans) {
+        std::string thread = "main";
+        if (span.thread != mainThread) {
+            auto it = workers.emplace(span.thread, static_cast<int>(workers.size()) + 1).first;
+            thread = "worker " + std::to_string(it->second);
+        }
+        std::cout << std::left << std::setw(28) << span.name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << span.startMs << std::setw(10) << span.endMs
+            << std::setw(10) << span.endMs - span.startMs << "  " << thread << "\n";
+    }
+    std::cout << "Time to first frame: " << std::fixed << std::setprecision(1) << firstFrameMs << " ms";
+    if (!note.empty()) {
+        std::cout << " (" << note << ")";
+    }
+    std::cout << std::endl;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records when each startup step ran, relative to process start, and on which
+// thread, so overlapping work on the init threads shows up as such. Steps can
+// be recorded from any thread.
+class StartupTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Span {
+        std::string name;
+        float startMs;
+        float endMs;
+        std::thread::id thread;
+    };
+
+    // Times a step from construction to destruction
+    class Scope {
+    public:
+        Scope(StartupTimeline& timeline, const char* name);
+        ~Scope();
+    private:
+        StartupTimeline& timeline;
+        const char* name;
+        float startMs;
+    };
+
+    StartupTimeline();
+
+    // Milliseconds since the process started
+    float now() const;
+    void add(const char* name, float startMs, float endMs);
+    // Called after the first present. Ends the timeline and prints it to stdout.
+    void finish(const std::string& note);
+
+    bool isFinished() const { return finished; }
+    float timeToFirstFrameMs() const { return firstFrameMs; }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<Span> spans;
+    std::thread::id mainThread;
+    bool finished;
+    float firstFrameMs;
+};
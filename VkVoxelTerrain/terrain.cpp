@@ -3,11 +3,20 @@
 #include "vulkan_setup.h"
 #include "types.h"
 #include "renderer.h"
+#include "vulkan_resources.h"
+#include "trace_recorder.h"
+#include "memory_tracker.h"
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 #include <thread>
 #include <mutex>
+#include <queue>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <algorithm>
+#include <numeric>
 
 // a "zone" is a 4*4 area of chunks (64 * 64 blocks)
 // a "chunk" contains 16 * 256 * 16 blocks
@@ -16,6 +25,13 @@
 #define ZONE_SIZE 64                    // the length of a zone (in blocks) 
 #define CHUNK_LENGTH 16                 // chunk length/width
 
+// frames a zone's cached command buffers are kept after it leaves the draw
+// radius, must be at least MAX_FRAMES_IN_FLIGHT
+#define ZONE_CACHE_MAX_AGE 120
+
+// zoneChunkOrder value for drawing a zone's Chunks in slot order
+#define RASTER_CHUNK_ORDER 16
+
 #define TERRAIN_DRAW_RADIUS         ZONE_SIZE * TERRAIN_DRAW_MULTIPLIER
 #define TERRAIN_CREATE_RADIUS       ZONE_SIZE * TERRAIN_CREATE_MULTIPLIER
 
@@ -24,11 +40,20 @@ int roundDown(int n, int m) {
 }
 
 Terrain::Terrain(Renderer* vulkanContext)
-    : context(vulkanContext), m_chunks(), m_chunks_mutex(), m_generatedTerrain(), pipelineChunks(VK_NULL_HANDLE),
-    descriptorSetLayout(VK_NULL_HANDLE), pipelineLayout(VK_NULL_HANDLE), currentPipeline(nullptr),
-    threadPool(16), pendingChunks(), pendingChunksMutex(), drawableChunks(), drawableChunksMutex(),
-    transferCmdPoolManager{}
-{}
+    : context(vulkanContext), m_chunks(), m_chunks_mutex(), m_generatedTerrain(), pipelineChunks(VK_NULL_HANDLE), pipelineWater(VK_NULL_HANDLE), pipelineDepthPrepass(VK_NULL_HANDLE), pipelineChunksEqual(VK_NULL_HANDLE),
+    threadPool(16), lightEngine(threadPool), water(threadPool), pendingChunks(), pendingChunksMutex(), drawableChunks(), drawableChunksMutex(), zoneProgress(), zoneProgressMutex(),
+    transferCmdPoolManager{}, dirtyChunks(), dirtyChunksMutex(), sectionMeshes(), remeshing(), editsRemeshing(0), remeshedChunks(),
+    remeshedChunksMutex(), remeshedChunksReady(), retiredBuffers(), frameNumber(0), cullFrame(0), cullResultValid(false), drawMultiplier(TERRAIN_DRAW_MULTIPLIER),
+    drawList(), drawZones(), drawZoneVersions(), drawListOrigin(0), drawListSide(0), drawListMultiplier(0),
+    drawOrderNear(), drawOrderRaster(), cameraChunk(0), zoneVersions(), zoneCommandCache(), prepassCommandCache(), cacheFrameNumber(0), avgZoneRecordMs(0.f),
+    descriptorSetLayout(VK_NULL_HANDLE), pipelineLayout(VK_NULL_HANDLE), currentPipeline(nullptr), sectionCullingEnabled(true), cullStats(),
+    parallelRecording(true), commandCaching(true), cacheStats(), drawTimeMs(0.f), lod(vulkanContext), frontToBack(true), depthPrepass(false), translucentPass(true), translucentStats(), pipelineStats(), remeshWaitMs(2.f)
+{
+    // light changes show the way block edits do, without relighting again
+    lightEngine.setChangeListener([this](const glm::ivec3& min, const glm::ivec3& max) {
+        markRemesh(min, max, false);
+    });
+}
 
 Terrain::~Terrain() {
 }
@@ -83,8 +108,8 @@ void Terrain::buildPipelines()
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
     // Vertex Input
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    auto bindingDescription = vertexBindingDescription();
+    auto attributeDescriptions = vertexAttributeDescriptions();
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -189,13 +214,75 @@ void Terrain::buildPipelines()
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.layout = pipelineLayout;
     pipelineInfo.renderPass = context->renderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.subpass = SUBPASS_OPAQUE;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(context->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipelineChunks) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(context->device, context->pipelineCache.handle(), 1, &pipelineInfo, nullptr, &pipelineChunks) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    // Depth pre-pass: the vertex stage alone, writing depth but no colour
+    VkPipelineColorBlendAttachmentState noColorWrite = colorBlendAttachment;
+    noColorWrite.colorWriteMask = 0;
+    colorBlending.pAttachments = &noColorWrite;
+    pipelineInfo.stageCount = 1;
+
+    if (vkCreateGraphicsPipelines(context->device, context->pipelineCache.handle(), 1, &pipelineInfo, nullptr, &pipelineDepthPrepass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pre-pass pipeline!");
+    }
+
+    // Colour pass after the pre-pass: only the nearest surface of each sample
+    // passes, and the depth buffer is already complete
+    colorBlending.pAttachments = &colorBlendAttachment;
+    pipelineInfo.stageCount = 2;
+    depthStencil.depthWriteEnable = VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+    if (vkCreateGraphicsPipelines(context->device, context->pipelineCache.handle(), 1, &pipelineInfo, nullptr, &pipelineChunksEqual) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+    // Water: same vertices and descriptors, but drawn into the two OIT
+    // targets. Depth is tested against the opaque pass without being
+    // written, and both sides are drawn so lakes can be seen from below.
+    auto waterShaderCode = readFile("shaders/frag_water.spv");
+    VkShaderModule waterShaderModule = createShaderModule(context->device, waterShaderCode);
+    shaderStages[1].module = waterShaderModule;
+
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    depthStencil.depthWriteEnable = VK_FALSE;
+
+    // accumulation target: weighted colour and alpha are summed
+    std::array<VkPipelineColorBlendAttachmentState, 2> oitBlendAttachments{};
+    oitBlendAttachments[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    oitBlendAttachments[0].blendEnable = VK_TRUE;
+    oitBlendAttachments[0].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    oitBlendAttachments[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    oitBlendAttachments[0].colorBlendOp = VK_BLEND_OP_ADD;
+    oitBlendAttachments[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    oitBlendAttachments[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    oitBlendAttachments[0].alphaBlendOp = VK_BLEND_OP_ADD;
+
+    // revealage target: multiplied by (1 - alpha) of every fragment
+    oitBlendAttachments[1].colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+    oitBlendAttachments[1].blendEnable = VK_TRUE;
+    oitBlendAttachments[1].srcColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    oitBlendAttachments[1].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+    oitBlendAttachments[1].colorBlendOp = VK_BLEND_OP_ADD;
+    oitBlendAttachments[1].srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    oitBlendAttachments[1].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    oitBlendAttachments[1].alphaBlendOp = VK_BLEND_OP_ADD;
+
+    colorBlending.attachmentCount = static_cast<uint32_t>(oitBlendAttachments.size());
+    colorBlending.pAttachments = oitBlendAttachments.data();
+    pipelineInfo.subpass = SUBPASS_TRANSLUCENT;
+
+    if (vkCreateGraphicsPipelines(context->device, context->pipelineCache.handle(), 1, &pipelineInfo, nullptr, &pipelineWater) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create water pipeline!");
+    }
 
+    vkDestroyShaderModule(context->device, waterShaderModule, nullptr);
     vkDestroyShaderModule(context->device, fragShaderModule, nullptr);
     vkDestroyShaderModule(context->device, vertShaderModule, nullptr);
 
@@ -205,42 +292,52 @@ void Terrain::buildPipelines()
 
     QueueFamilyIndices indices = findQueueFamilies(context->physicalDevice, context->surface);
     transferCmdPoolManager.init(context->device, indices.transferFamily.value());
+    zoneCommandCache.init(context->device, indices.graphicsFamily.value());
+    prepassCommandCache.init(context->device, indices.graphicsFamily.value());
 }
 
 void Terrain::destroyResources()
 {
+    lightEngine.shutdown();
     threadPool.destroy();
+    lod.destroyResources();
     transferCmdPoolManager.cleanup(); 
+    zoneCommandCache.cleanup();
+    prepassCommandCache.cleanup();
     vkDestroyDescriptorSetLayout(context->device, descriptorSetLayout, nullptr);
 
     vkDestroyPipeline(context->device, pipelineChunks, nullptr);
+    vkDestroyPipeline(context->device, pipelineWater, nullptr);
+    vkDestroyPipeline(context->device, pipelineDepthPrepass, nullptr);
+    vkDestroyPipeline(context->device, pipelineChunksEqual, nullptr);
     vkDestroyPipelineLayout(context->device, pipelineLayout, nullptr);
 
+    freeRetiredBuffers(true);
     for (const auto& pair : m_chunks) {
-        const uPtr<Chunk>& chunk = pair.second;
+        const uPtr<GpuChunk>& chunk = pair.second;
         if (chunk)
         {
             vkDestroyBuffer(context->device, chunk->VertexBuffer, nullptr);
-            vkFreeMemory(context->device, chunk->VertexBufferMemory, nullptr);
+            freeDeviceMemory(context->device, chunk->VertexBufferMemory);
         }
     }
 }
 
 // Surround calls to this with try-catch if you don't know whether
 // the coordinates at x, y, z have a corresponding Chunk
+// For more than a few blocks, use a BlockCursor or readRegion instead.
 BlockType Terrain::getBlockAt(int x, int y, int z)
 {
-    if (hasChunkAt(x, z)) {
+    // & ~15 floors to the Chunk's corner, negatives included
+    std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+    const GpuChunk* c = findChunk(x & ~15, z & ~15);
+    if (c != nullptr) {
         // Just disallow action below or above min/max height,
         // but don't crash the game over it.
         if (y < 0 || y >= 256) {
             return EMPTY;
         }
-        const uPtr<Chunk>& c = getChunkAt(x, z);
-        glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
-        return c->getBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
-            static_cast<unsigned int>(y),
-            static_cast<unsigned int>(z - chunkOrigin.y));
+        return c->getBlockAt(x & 15, y, z & 15);
     }
     else {
         throw std::out_of_range("Coordinates " + std::to_string(x) +
@@ -262,96 +359,408 @@ bool Terrain::hasChunkAt(int x, int z) {
     return m_chunks.find(toKey(16 * xFloor, 16 * zFloor)) != m_chunks.end();
 }
 
-// Combine two 32-bit ints into one 64-bit int
-// where the upper 32 bits are X and the lower 32 bits are Z
-int64_t toKey(int x, int z) {
-    int64_t xz = 0xffffffffffffffff;
-    int64_t x64 = x;
-    int64_t z64 = z;
+uPtr<GpuChunk>& Terrain::getChunkAt(int x, int z) {
+    int xFloor = static_cast<int>(glm::floor(x / 16.f));
+    int zFloor = static_cast<int>(glm::floor(z / 16.f));
+    std::lock_guard<std::mutex> lock{ m_chunks_mutex }; 
+    return m_chunks[toKey(16 * xFloor, 16 * zFloor)];
+}
 
-    // Set all lower 32 bits to 1 so we can & with Z later
-    xz = (xz & (x64 << 32)) | 0x00000000ffffffff;
+void Terrain::setBlockAt(int x, int y, int z, BlockType t)
+{
+    {
+        // looks the Chunk up itself, getChunkAt would take the lock again
+        std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+        // a Chunk still being generated has its blocks written by its worker
+        GpuChunk* c = findGeneratedChunk(x & ~15, z & ~15);
+        if (c != nullptr) {
+            std::unique_lock<std::shared_mutex> blockLock(c->blockMutex());
+            c->setBlockAt(x & 15, y, z & 15, t);
+        }
+        else {
+            throw std::out_of_range("Coordinates " + std::to_string(x) +
+                                    " " + std::to_string(y) + " " +
+                                    std::to_string(z) + " have no Chunk!");
+        }
+    }
+    markEdited(glm::ivec3(x, y, z), glm::ivec3(x, y, z));
+}
 
-    // Set all upper 32 bits to 1 so we can & with XZ
-    z64 = z64 | 0xffffffff00000000;
+GpuChunk* Terrain::findGeneratedChunk(int x, int z) const {
+    GpuChunk* chunk = findChunk(x, z);
+    return chunk != nullptr && chunk->isGenerated() ? chunk : nullptr;
+}
 
-    // Combine
-    xz = xz & z64;
-    return xz;
+// XPOS, XNEG, ZPOS, ZNEG, then XPOS_ZPOS, XPOS_ZNEG, XNEG_ZPOS, XNEG_ZNEG,
+// like ChunkBorders
+static const glm::ivec2 neighbourOffsets[8] = {
+    { CHUNK_LENGTH, 0 }, { -CHUNK_LENGTH, 0 }, { 0, CHUNK_LENGTH }, { 0, -CHUNK_LENGTH },
+    { CHUNK_LENGTH, CHUNK_LENGTH }, { CHUNK_LENGTH, -CHUNK_LENGTH }, { -CHUNK_LENGTH, CHUNK_LENGTH }, { -CHUNK_LENGTH, -CHUNK_LENGTH }
+};
+
+std::array<const Chunk*, 8> Terrain::generatedNeighbours(glm::ivec2 origin) const {
+    std::array<const Chunk*, 8> neighbours;
+    for (int i = 0; i < 8; i++) {
+        neighbours[i] = findGeneratedChunk(origin.x + neighbourOffsets[i].x, origin.y + neighbourOffsets[i].y);
+    }
+    return neighbours;
 }
 
-glm::ivec2 toCoords(int64_t k) {
-    // Z is lower 32 bits
-    int64_t z = k & 0x00000000ffffffff;
-    // If the most significant bit of Z is 1, then it's a negative number
-    // so we have to set all the upper 32 bits to 1.
-    // Note the 8    V
-    if(z & 0x0000000080000000) {
-        z = z | 0xffffffff00000000;
+void Terrain::publishGenerated(GpuChunk* chunk) {
+    glm::ivec2 origin = chunk->getOrigin();
+    std::vector<int64_t> stale;
+    {
+        // under the same lock the meshers look for neighbours with, so each
+        // one either sees this Chunk or is found here
+        std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+        chunk->markGenerated();
+        for (int i = 0; i < 8; i++) {
+            glm::ivec2 at = origin + neighbourOffsets[i];
+            GpuChunk* neighbour = findChunk(at.x, at.y);
+            // the neighbour has this Chunk on its opposite side or corner
+            uint8_t bit = static_cast<uint8_t>(1 << (i < 4 ? i ^ 1 : 11 - i));
+            if (neighbour != nullptr && (neighbour->missingNeighbours & bit)) {
+                neighbour->missingNeighbours &= ~bit;
+                stale.push_back(toKey(at.x, at.y));
+            }
+        }
+    }
+    if (stale.empty()) {
+        return;
     }
-    int64_t x = (k >> 32);
+    int64_t now = ChunkLifecycle::nowNs();
+    std::lock_guard<std::mutex> lock(dirtyChunksMutex);
+    for (int64_t key : stale) {
+        markDirty(key, 0xFFFF, now, false);
+    }
+}
 
-    return glm::ivec2(x, z);
+ChunkLookup Terrain::generatedChunks() {
+    return [this](int x, int z) -> Chunk* {
+        std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+        return findGeneratedChunk(x, z);
+    };
 }
 
-uPtr<Chunk>& Terrain::getChunkAt(int x, int z) {
-    int xFloor = static_cast<int>(glm::floor(x / 16.f));
-    int zFloor = static_cast<int>(glm::floor(z / 16.f));
-    std::lock_guard<std::mutex> lock{ m_chunks_mutex }; 
-    return m_chunks[toKey(16 * xFloor, 16 * zFloor)];
+BlockCursor Terrain::cursorAt(const glm::ivec3& position) {
+    return BlockCursor(generatedChunks(), position);
 }
 
-void Terrain::setBlockAt(int x, int y, int z, BlockType t)
-{
-    std::lock_guard<std::mutex> lock{ m_chunks_mutex };
-    if(hasChunkAt(x, z)) {
-        uPtr<Chunk> &c = getChunkAt(x, z);
-        glm::vec2 chunkOrigin = glm::vec2(floor(x / 16.f) * 16, floor(z / 16.f) * 16);
-        c->setBlockAt(static_cast<unsigned int>(x - chunkOrigin.x),
-                      static_cast<unsigned int>(y),
-                      static_cast<unsigned int>(z - chunkOrigin.y),
-                      t);
+size_t Terrain::readRegion(const glm::ivec3& min, const glm::ivec3& max, BlockType* out) {
+    return ::readRegion(generatedChunks(), min, max, out);
+}
+
+size_t Terrain::writeRegion(const glm::ivec3& min, const glm::ivec3& max, const BlockType* in) {
+    size_t written = ::writeRegion(generatedChunks(), min, max, in);
+    if (written > 0) {
+        markEdited(min, max);
     }
-    else {
-        throw std::out_of_range("Coordinates " + std::to_string(x) +
-                                " " + std::to_string(y) + " " +
-                                std::to_string(z) + " have no Chunk!");
+    return written;
+}
+
+size_t Terrain::applyEdits(const EditBatch& batch) {
+    return batch.apply(generatedChunks(), [this](const glm::ivec3& min, const glm::ivec3& max) {
+        markEdited(min, max);
+    });
+}
+
+void Terrain::markEdited(const glm::ivec3& min, const glm::ivec3& max) {
+    water.blocksChanged(min, max);
+    lightEngine.blocksChanged(min, max);
+    markRemesh(min, max, true);
+}
+
+void Terrain::tickWater() {
+    EditBatch edits;
+    water.tick(generatedChunks(), edits);
+    // the water already knows what it changed, so it isn't woken again
+    edits.apply(generatedChunks(), [this](const glm::ivec3& min, const glm::ivec3& max) {
+        lightEngine.blocksChanged(min, max);
+        markRemesh(min, max, false);
+    });
+}
+
+void Terrain::markRemesh(const glm::ivec3& min, const glm::ivec3& max, bool edited) {
+    // a block's faces are meshed in its own section, and its neighbours'
+    // faces towards it in theirs, so one block further in every direction
+    glm::ivec3 lo = min - 1;
+    glm::ivec3 hi = max + 1;
+    int firstSection = std::max(lo.y, 0) / SECTION_SIZE;
+    int lastSection = std::min(hi.y, 255) / SECTION_SIZE;
+    if (firstSection > lastSection || hi.x < lo.x || hi.z < lo.z) {
+        return;
+    }
+    uint16_t sections = static_cast<uint16_t>(((1u << (lastSection + 1)) - 1) & ~((1u << firstSection) - 1));
+    int64_t now = ChunkLifecycle::nowNs();
+
+    std::lock_guard<std::mutex> lock(dirtyChunksMutex);
+    // & ~15 floors to the Chunk's corner, negatives included
+    for (int z = lo.z & ~15; z <= hi.z; z += CHUNK_LENGTH) {
+        for (int x = lo.x & ~15; x <= hi.x; x += CHUNK_LENGTH) {
+            markDirty(toKey(x, z), sections, now, edited);
+        }
     }
 }
 
-void Terrain::threadCreateBlockData(glm::vec2 terrainCoord)
+void Terrain::markDirty(int64_t key, uint16_t sections, int64_t editNs, bool edited) {
+    auto [entry, inserted] = dirtyChunks.try_emplace(key, DirtyChunk{ sections, editNs, edited });
+    if (!inserted) {
+        entry->second.sections |= sections;
+        entry->second.edited = entry->second.edited || edited;
+    }
+}
+
+RayHit Terrain::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, bool stopAtWater)
 {
-    for (int z = terrainCoord[1]; z < terrainCoord[1] + ZONE_SIZE; z += 16) {
-        for (int x = terrainCoord[0]; x < terrainCoord[0] + ZONE_SIZE; x += 16) {
-            Chunk* chunk = instantiateChunkAt(x, z);
+    std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+    VoxelRaycaster raycaster([this](int x, int z) { return findGeneratedChunk(x, z); }, stopAtWater);
+    return raycaster.cast({ origin, direction, maxDistance });
+}
 
-            for (int chunkX = 0; chunkX < 16; chunkX++) {
-                for (int chunkZ = 0; chunkZ < 16; chunkZ++) {
-                    for (int height = 0; height < 256; height++) {
-                        int worldX = x + chunkX;
-                        int worldZ = z + chunkZ;
+void Terrain::raycastBatch(const std::vector<Ray>& rays, std::vector<RayHit>& hits, bool stopAtWater)
+{
+    std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+    VoxelRaycaster raycaster([this](int x, int z) { return findGeneratedChunk(x, z); }, stopAtWater);
+    raycaster.castBatch(rays, hits);
+}
 
-                        BlockType blockType = createBlock(worldX, height, worldZ);
+void Terrain::stepBody(PhysicsBody& body, const BodyControl& control, float dt)
+{
+    std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+    CollisionWorld world([this](int x, int z) { return findGeneratedChunk(x, z); });
+    ::stepBody(world, body, control, dt);
+}
 
-                        if (blockType != EMPTY) {
-                            chunk->setBlockAt(chunkX, height, chunkZ, blockType);
-                        }
-                    }
-                }
-            }
+void Terrain::stepBodies(std::vector<PhysicsBody>& bodies, const std::vector<BodyControl>& controls, float dt)
+{
+    std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+    CollisionWorld world([this](int x, int z) { return findGeneratedChunk(x, z); });
+    for (size_t i = 0; i < bodies.size(); i++) {
+        ::stepBody(world, bodies[i], controls[i], dt);
+    }
+}
+
+void Terrain::threadCreateBlockData(glm::vec2 terrainCoord, int64_t enqueuedNs)
+{
+    pipelineStats.zonesQueued--;
+    pipelineStats.zonesGenerating++;
+    for (int z = terrainCoord[1]; z < terrainCoord[1] + ZONE_SIZE; z += 16) {
+        for (int x = terrainCoord[0]; x < terrainCoord[0] + ZONE_SIZE; x += 16) {
+            TRACE_SCOPE("generate chunk", "generate", x, z);
+            GpuChunk* chunk = instantiateChunkAt(x, z);
+            chunk->lifecycle.stamps[ChunkLifecycle::ENQUEUED] = enqueuedNs;
+            chunk->lifecycle.stamp(ChunkLifecycle::GENERATE_START);
+            generateChunkBlocks(*chunk);
+            lightEngine.addChunk(*chunk);
+            // only now, or a neighbour remeshed in between would bake it unlit
+            publishGenerated(chunk);
+            chunk->lifecycle.stamp(ChunkLifecycle::GENERATE_END);
             std::lock_guard<std::mutex> lock(pendingChunksMutex);
             pendingChunks.push_back(chunk); 
         }
     }
+    pipelineStats.zonesGenerating--;
 }
 
-void Terrain::threadCreateBufferData(Chunk* chunk)
+void Terrain::threadCreateBufferData(GpuChunk* chunk)
 {
-    chunk->createVertexData();
+    pipelineStats.chunksMeshQueued--;
+    pipelineStats.chunksMeshing++;
+    chunk->lifecycle.stamp(ChunkLifecycle::MESH_START);
+    {
+        TRACE_SCOPE("mesh chunk", "mesh", chunk->getOrigin().x, chunk->getOrigin().y);
+        // the neighbours' blocks and light as a remesh sees them; the ones not
+        // generated yet remesh this Chunk once they are (see publishGenerated)
+        std::array<const Chunk*, 8> neighbours;
+        {
+            std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+            neighbours = generatedNeighbours(chunk->getOrigin());
+            chunk->missingNeighbours = 0;
+            for (int i = 0; i < 8; i++) {
+                if (neighbours[i] == nullptr) {
+                    chunk->missingNeighbours |= 1 << i;
+                }
+            }
+        }
+        auto borders = mkU<ChunkBorders>();
+        Chunk::copyBorders(neighbours, *borders);
+        chunk->createVertexData(borders.get());
+    }
+    chunk->lifecycle.stamp(ChunkLifecycle::MESH_END);
+    pipelineStats.chunksMeshing--;
     std::lock_guard<std::mutex> lock(drawableChunksMutex);
     drawableChunks.push_back(chunk); 
 }
 
+void Terrain::threadRemeshChunk(std::shared_ptr<RemeshJob> job)
+{
+    job->meshStartNs = ChunkLifecycle::nowNs();
+    {
+        glm::ivec2 origin = job->chunk->getOrigin();
+        TRACE_SCOPE("remesh chunk", "mesh", origin.x, origin.y);
+        if (!job->meshes) {
+            job->meshes = mkU<SectionMeshes>();
+            job->sections = 0xFFFF;
+        }
+        // the blocks are a copy, but the light is read in place
+        std::shared_lock<std::shared_mutex> lightLock(job->chunk->light.mutex());
+        for (int section = 0; section < SECTION_COUNT; section++) {
+            if (job->sections & (1 << section)) {
+                Chunk::meshSection(job->blocks.data(), job->chunk->light, origin, section, &job->borders, (*job->meshes)[section]);
+            }
+        }
+        job->mesh = ChunkMesh::assemble(*job->meshes);
+    }
+    job->meshEndNs = ChunkLifecycle::nowNs();
+
+    {
+        std::lock_guard<std::mutex> lock(remeshedChunksMutex);
+        remeshedChunks.push_back(std::move(job));
+    }
+    remeshedChunksReady.notify_one();
+}
+
+// What a Chunk's kept section meshes cost, for the MemoryTracker
+static uint64_t sectionMeshBytes(const SectionMeshes& meshes) {
+    uint64_t bytes = 0;
+    for (const SectionMesh& mesh : meshes) {
+        bytes += mesh.vertices.capacity() * sizeof(Vertex)
+            + (mesh.opaqueIndices.capacity() + mesh.waterIndices.capacity()) * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+void Terrain::startRemeshes()
+{
+    std::unordered_map<int64_t, DirtyChunk> dirty;
+    {
+        std::lock_guard<std::mutex> lock(dirtyChunksMutex);
+        dirty.swap(dirtyChunks);
+    }
+
+    std::vector<std::pair<int64_t, DirtyChunk>> waiting;
+    for (const auto& [key, entry] : dirty) {
+        glm::ivec2 origin = toCoords(key);
+        GpuChunk* chunk;
+        std::array<const Chunk*, 8> neighbours;
+        {
+            std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+            chunk = findGeneratedChunk(origin.x, origin.y);
+            neighbours = generatedNeighbours(origin);
+        }
+        // edits to Chunks that don't exist were dropped
+        if (chunk == nullptr) {
+            continue;
+        }
+        // a Chunk still on its way to its first upload is remeshed after it,
+        // one already being remeshed once that is swapped in
+        if (chunk->VertexBuffer == VK_NULL_HANDLE || remeshing.count(key) > 0) {
+            waiting.emplace_back(key, entry);
+            continue;
+        }
+
+        auto job = std::make_shared<RemeshJob>();
+        job->chunk = chunk;
+        job->sections = entry.sections;
+        job->editNs = entry.editNs;
+        job->edited = entry.edited;
+        {
+            // the simulation thread may be writing them
+            std::shared_lock<std::shared_mutex> lock(chunk->blockMutex());
+            job->blocks.assign(chunk->blockData(), chunk->blockData() + 65536);
+        }
+        Chunk::copyBorders(neighbours, job->borders);
+        auto kept = sectionMeshes.find(key);
+        if (kept != sectionMeshes.end()) {
+            MemoryTracker::instance().hostFreed(MemoryTracker::HOST_CHUNK_MESH, sectionMeshBytes(*kept->second));
+            job->meshes = std::move(kept->second);
+            sectionMeshes.erase(kept);
+        }
+
+        remeshing.insert(key);
+        if (job->edited) {
+            editsRemeshing++;
+        }
+        pipelineStats.chunksRemeshing++;
+        // ahead of generation and meshing so the edit shows as soon as possible
+        threadPool.enqueuePriority(&Terrain::threadRemeshChunk, this, job);
+    }
+
+    if (!waiting.empty()) {
+        std::lock_guard<std::mutex> lock(dirtyChunksMutex);
+        for (const auto& [key, entry] : waiting) {
+            auto [merged, inserted] = dirtyChunks.try_emplace(key, entry);
+            if (!inserted) {
+                merged->second.sections |= entry.sections;
+                merged->second.editNs = std::min(merged->second.editNs, entry.editNs);
+                merged->second.edited = merged->second.edited || entry.edited;
+            }
+        }
+    }
+}
+
+void Terrain::finishRemeshes(int64_t waitNs)
+{
+    std::vector<std::shared_ptr<RemeshJob>> finished;
+    {
+        std::unique_lock<std::mutex> lock(remeshedChunksMutex);
+        // light and water remeshes stream in behind the world and are
+        // swapped in whenever they finish, so only edits are waited for
+        if (waitNs > 0 && editsRemeshing > 0) {
+            remeshedChunksReady.wait_for(lock, std::chrono::nanoseconds(waitNs), [this] {
+                auto edited = std::count_if(remeshedChunks.begin(), remeshedChunks.end(),
+                    [](const std::shared_ptr<RemeshJob>& job) { return job->edited; });
+                return static_cast<size_t>(edited) == editsRemeshing;
+            });
+        }
+        finished.swap(remeshedChunks);
+    }
+
+    for (const std::shared_ptr<RemeshJob>& job : finished) {
+        GpuChunk* chunk = job->chunk;
+        glm::ivec2 origin = chunk->getOrigin();
+        {
+            TRACE_SCOPE("upload remesh", "upload", origin.x, origin.y);
+            RetiredBuffer retired{ VK_NULL_HANDLE, VK_NULL_HANDLE, frameNumber };
+            chunk->swapMesh(job->mesh, context->device, context->physicalDevice, context->surface,
+                context->commandPoolTransfer, context->queueTransfer, retired.buffer, retired.memory);
+            retiredBuffers.push_back(retired);
+        }
+        invalidateZoneAt(origin.x, origin.y);
+
+        int sectionCount = 0;
+        for (uint16_t bits = job->sections; bits != 0; bits &= bits - 1) {
+            sectionCount++;
+        }
+        if (job->edited) {
+            pipelineStats.editVisible(job->editNs, job->meshStartNs, job->meshEndNs, ChunkLifecycle::nowNs(), sectionCount);
+            editsRemeshing--;
+        }
+        pipelineStats.chunksRemeshing--;
+
+        int64_t key = toKey(origin.x, origin.y);
+        MemoryTracker::instance().hostAllocated(MemoryTracker::HOST_CHUNK_MESH, sectionMeshBytes(*job->meshes));
+        sectionMeshes[key] = std::move(job->meshes);
+        remeshing.erase(key);
+    }
+}
+
+void Terrain::freeRetiredBuffers(bool all)
+{
+    // a frame still in flight may have drawn from the old buffer, and frames
+    // are at most MAX_FRAMES_IN_FLIGHT behind, so wait one more to be safe
+    auto expired = [this, all](const RetiredBuffer& retired) {
+        return all || frameNumber > retired.frame + MAX_FRAMES_IN_FLIGHT;
+    };
+    for (const RetiredBuffer& retired : retiredBuffers) {
+        if (expired(retired)) {
+            vkDestroyBuffer(context->device, retired.buffer, nullptr);
+            freeDeviceMemory(context->device, retired.memory);
+        }
+    }
+    retiredBuffers.erase(std::remove_if(retiredBuffers.begin(), retiredBuffers.end(), expired), retiredBuffers.end());
+}
+
 void Terrain::tryExpansion(const glm::vec3& pos)
 {
     int terrainX = roundDown(int(pos.x), ZONE_SIZE); 
@@ -366,71 +775,693 @@ void Terrain::tryExpansion(const glm::vec3& pos)
             if (m_generatedTerrain.count(toKey(x, z)) == 0)
             {
                 m_generatedTerrain.insert(toKey(x, z));
-                threadPool.enqueue(&Terrain::threadCreateBlockData, this, glm::vec2(x, z));
+                int64_t enqueuedNs = ChunkLifecycle::nowNs();
+                {
+                    std::lock_guard<std::mutex> lock(zoneProgressMutex);
+                    zoneProgress[toKey(x, z)] = { enqueuedNs, 0 };
+                }
+                pipelineStats.zonesQueued++;
+                threadPool.enqueue(&Terrain::threadCreateBlockData, this, glm::vec2(x, z), enqueuedNs);
             }
         }
     }
+}
 
-    std::vector<Chunk*> chunksToProcess;
+void Terrain::updateChunks()
+{
+    frameNumber++;
+    freeRetiredBuffers(false);
+
+    std::vector<GpuChunk*> chunksToProcess;
 
     {
         std::lock_guard<std::mutex> lock(pendingChunksMutex);
         chunksToProcess.swap(pendingChunks); // Efficient: avoids copying
     }
 
-    for (Chunk* chunk : chunksToProcess) {
+    for (GpuChunk* chunk : chunksToProcess) {
+        addToDrawList(chunk);
+        chunk->lifecycle.stamp(ChunkLifecycle::MESH_QUEUED);
+        pipelineStats.chunksMeshQueued++;
         threadPool.enqueue(&Terrain::threadCreateBufferData, this, chunk);
     }
 
-    std::vector<Chunk*> copyChunks;
+    std::vector<GpuChunk*> copyChunks;
 
     {
         std::lock_guard<std::mutex> lock(drawableChunksMutex);
         copyChunks.swap(drawableChunks); // Efficient: avoids copying
     }
 
-    for (Chunk* chunk : copyChunks)
+    for (GpuChunk* chunk : copyChunks)
     {
+        TRACE_SCOPE("upload chunk", "upload", chunk->getOrigin().x, chunk->getOrigin().y);
+        chunk->lifecycle.stamp(ChunkLifecycle::UPLOAD_START);
         chunk->createVkBuffer(context->device, context->physicalDevice,
             context->surface, context->commandPoolTransfer, context->queueTransfer);
+        chunk->lifecycle.stamp(ChunkLifecycle::UPLOAD_END);
+        invalidateZoneAt(chunk->getOrigin().x, chunk->getOrigin().y);
+
+        pipelineStats.chunkVisible(chunk->lifecycle);
+        glm::ivec2 zone(roundDown(chunk->getOrigin().x, ZONE_SIZE), roundDown(chunk->getOrigin().y, ZONE_SIZE));
+        std::lock_guard<std::mutex> lock(zoneProgressMutex);
+        auto progress = zoneProgress.find(toKey(zone.x, zone.y));
+        if (progress != zoneProgress.end() && ++progress->second.chunksVisible == (ZONE_SIZE / 16) * (ZONE_SIZE / 16)) {
+            pipelineStats.zoneVisible(progress->second.enqueuedNs, chunk->lifecycle.stamps[ChunkLifecycle::UPLOAD_END]);
+            zoneProgress.erase(progress);
+        }
+    }
+
+    // edits the simulation made since the last frame are remeshed now, so
+    // waiting a little for them lets them show in this frame instead of the next one
+    startRemeshes();
+    finishRemeshes(static_cast<int64_t>(remeshWaitMs * 1e6f));
+
+    lod.update();
+}
+
+ChunkQueueDepths Terrain::queueDepths() {
+    ChunkQueueDepths depths;
+    depths.zonesQueued = pipelineStats.zonesQueued.load();
+    depths.zonesGenerating = pipelineStats.zonesGenerating.load();
+    depths.chunksMeshQueued = pipelineStats.chunksMeshQueued.load();
+    depths.chunksMeshing = pipelineStats.chunksMeshing.load();
+    depths.chunksRemeshing = pipelineStats.chunksRemeshing.load();
+    {
+        std::lock_guard<std::mutex> lock(pendingChunksMutex);
+        depths.chunksPending = static_cast<int>(pendingChunks.size());
+    }
+    {
+        std::lock_guard<std::mutex> lock(drawableChunksMutex);
+        depths.chunksDrawable = static_cast<int>(drawableChunks.size());
+    }
+    depths.poolTasks = static_cast<int>(threadPool.queued());
+    return depths;
+}
+
+void Terrain::invalidateZoneAt(int x, int z)
+{
+    x = roundDown(x, ZONE_SIZE);
+    z = roundDown(z, ZONE_SIZE);
+    uint32_t version = ++zoneVersions[toKey(x, z)];
+
+    int slot = drawListSlot(x, z);
+    if (slot >= 0) {
+        drawZoneVersions[slot / 16] = version;
+    }
+}
+
+void Terrain::rebuildDrawList(int x, int z)
+{
+    drawListSide = 2 * drawMultiplier + 1;
+    drawListMultiplier = drawMultiplier;
+    drawListOrigin = glm::ivec2(x, z) - ZONE_SIZE * drawMultiplier;
+
+    drawZones.clear();
+    drawZoneVersions.clear();
+    drawList.assign(drawListSide * drawListSide * 16, nullptr);
+
+    std::lock_guard<std::mutex> lock{ m_chunks_mutex };
+    size_t slot = 0;
+    for (int zoneZ = 0; zoneZ < drawListSide; zoneZ++) {
+        for (int zoneX = 0; zoneX < drawListSide; zoneX++) {
+            glm::ivec2 zone = drawListOrigin + glm::ivec2(zoneX, zoneZ) * ZONE_SIZE;
+            auto version = zoneVersions.find(toKey(zone.x, zone.y));
+            drawZones.push_back(zone);
+            drawZoneVersions.push_back(version != zoneVersions.end() ? version->second : 0);
+
+            for (int cz = zone.y; cz < zone.y + ZONE_SIZE; cz += CHUNK_LENGTH) {
+                for (int cx = zone.x; cx < zone.x + ZONE_SIZE; cx += CHUNK_LENGTH) {
+                    drawList[slot++] = findChunk(cx, cz);
+                }
+            }
+        }
+    }
+
+    // bucket the zones by ring around the player's zone, which is the centre
+    // one, so the order only changes along with the list
+    drawOrderRaster.resize(drawZones.size());
+    std::iota(drawOrderRaster.begin(), drawOrderRaster.end(), 0);
+    drawOrderNear.clear();
+    for (int ring = 0; ring <= drawListMultiplier; ring++) {
+        for (int zoneZ = 0; zoneZ < drawListSide; zoneZ++) {
+            for (int zoneX = 0; zoneX < drawListSide; zoneX++) {
+                if (std::max(std::abs(zoneX - drawListMultiplier), std::abs(zoneZ - drawListMultiplier)) == ring) {
+                    drawOrderNear.push_back(zoneZ * drawListSide + zoneX);
+                }
+            }
+        }
+    }
+}
+
+void Terrain::addToDrawList(GpuChunk* chunk)
+{
+    int slot = drawListSlot(chunk->getOrigin().x, chunk->getOrigin().y);
+    if (slot >= 0) {
+        drawList[slot] = chunk;
     }
 }
 
-Chunk* Terrain::instantiateChunkAt(int x, int z) {
-    uPtr<Chunk> chunk = mkU<Chunk>(x, z);
-    Chunk *cPtr = chunk.get();
+int Terrain::drawListSlot(int x, int z) const
+{
+    int localX = x - drawListOrigin.x;
+    int localZ = z - drawListOrigin.y;
+    int length = drawListSide * ZONE_SIZE;
+    if (localX < 0 || localZ < 0 || localX >= length || localZ >= length) {
+        return -1;
+    }
+    int zone = (localZ / ZONE_SIZE) * drawListSide + localX / ZONE_SIZE;
+    int chunk = ((localZ % ZONE_SIZE) / CHUNK_LENGTH) * 4 + (localX % ZONE_SIZE) / CHUNK_LENGTH;
+    return zone * 16 + chunk;
+}
+
+GpuChunk* Terrain::drawListAt(int x, int z) const
+{
+    int slot = drawListSlot(x, z);
+    return slot >= 0 ? drawList[slot] : nullptr;
+}
+
+GpuChunk* Terrain::instantiateChunkAt(int x, int z) {
+    uPtr<GpuChunk> chunk = mkU<GpuChunk>(x, z);
+    GpuChunk *cPtr = chunk.get();
     std::lock_guard<std::mutex> lock{ m_chunks_mutex }; 
     m_chunks[toKey(x, z)] = move(chunk); 
     return cPtr;
 }
 
-void Terrain::drawZone(glm::ivec2 zone, VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet) {
-    for (int z = zone[1]; z < zone[1] + ZONE_SIZE; z += 16) {
-        for (int x = zone[0]; x < zone[0] + ZONE_SIZE; x += 16) {
-            const uPtr<Chunk>& chunk = getChunkAt(x, z);
-            if (chunk && chunk->VertexBuffer != VK_NULL_HANDLE) {
-                VkBuffer vertexBuffers[] = { chunk->VertexBuffer };
-                VkDeviceSize offsets[] = { 0 };
-                vkCmdBindVertexBuffers(cmdBuffer, 0, 1, vertexBuffers, offsets);
-                vkCmdBindIndexBuffer(cmdBuffer, chunk->VertexBuffer, static_cast<VkDeviceSize>(sizeof(Vertex) * chunk->vertexSize), VK_INDEX_TYPE_UINT32);
-                vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-                vkCmdDrawIndexed(cmdBuffer, chunk->numIndices, 1, 0, 0, 0);
+// The orders a zone's 16 Chunks can be drawn in, as slot indices (z-major).
+// Order i < 16 goes outwards from slot i, RASTER_CHUNK_ORDER is slot order.
+static const std::array<std::array<uint8_t, 16>, 17>& chunkOrders() {
+    static const std::array<std::array<uint8_t, 16>, 17> orders = [] {
+        std::array<std::array<uint8_t, 16>, 17> result;
+        for (int near = 0; near <= RASTER_CHUNK_ORDER; near++) {
+            std::array<uint8_t, 16>& order = result[near];
+            std::iota(order.begin(), order.end(), uint8_t(0));
+            if (near == RASTER_CHUNK_ORDER) {
+                continue;
+            }
+            auto distance = [near](int slot) {
+                int dx = slot % 4 - near % 4, dz = slot / 4 - near / 4;
+                return dx * dx + dz * dz;
+            };
+            std::stable_sort(order.begin(), order.end(), [&](uint8_t a, uint8_t b) { return distance(a) < distance(b); });
+        }
+        return result;
+    }();
+    return orders;
+}
+
+uint8_t Terrain::zoneChunkOrder(size_t zoneIndex) const {
+    if (!frontToBack) {
+        return RASTER_CHUNK_ORDER;
+    }
+    // the zone's Chunk nearest to the camera's
+    glm::ivec2 local = glm::clamp((cameraChunk - drawZones[zoneIndex]) / CHUNK_LENGTH, 0, 3);
+    return static_cast<uint8_t>(local.y * 4 + local.x);
+}
+
+void Terrain::drawZone(size_t zoneIndex, VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet, SectionCullStats& stats, bool allSections) {
+    for (uint8_t i : chunkOrders()[zoneChunkOrder(zoneIndex)]) {
+        const GpuChunk* chunk = drawList[zoneIndex * 16 + i];
+        if (chunk && chunk->VertexBuffer != VK_NULL_HANDLE) {
+            uint16_t visible = allSections ? 0xffff : visibleSectionMask(*chunk);
+
+            VkBuffer vertexBuffers[] = { chunk->VertexBuffer };
+            VkDeviceSize offsets[] = { 0 };
+            vkCmdBindVertexBuffers(cmdBuffer, 0, 1, vertexBuffers, offsets);
+            vkCmdBindIndexBuffer(cmdBuffer, chunk->VertexBuffer, static_cast<VkDeviceSize>(sizeof(Vertex) * chunk->vertexSize), VK_INDEX_TYPE_UINT32);
+            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+            // sections are stored bottom to top, so neighbouring visible
+            // sections can be merged into a single draw
+            uint32_t runFirst = 0, runCount = 0;
+            for (int i = 0; i < SECTION_COUNT; i++) {
+                const ChunkSection& section = chunk->sections[i];
+                if (section.indexCount == 0) {
+                    continue;
+                }
+                if (!(visible & (1 << i))) {
+                    stats.sectionsCulled++;
+                    continue;
+                }
+                stats.sectionsDrawn++;
+                if (runCount > 0 && runFirst + runCount != section.firstIndex) {
+                    vkCmdDrawIndexed(cmdBuffer, runCount, 1, runFirst, 0, 0);
+                    runCount = 0;
+                }
+                if (runCount == 0) {
+                    runFirst = section.firstIndex;
+                }
+                runCount += section.indexCount;
+            }
+            if (runCount > 0) {
+                vkCmdDrawIndexed(cmdBuffer, runCount, 1, runFirst, 0, 0);
+            }
+        }
+    }
+}
+
+void Terrain::drawTranslucent(VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet) {
+    auto start = std::chrono::high_resolution_clock::now();
+    TranslucentStats stats;
+    stats.gpuMs = translucentStats.gpuMs;
+
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineWater);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+    for (const GpuChunk* chunk : drawList) {
+        if (!chunk || chunk->VertexBuffer == VK_NULL_HANDLE || chunk->waterIndexCount == 0) {
+            continue;
+        }
+        // water isn't split into sections, so it is drawn if the culler
+        // reached any part of the chunk
+        if (visibleSectionMask(*chunk) == 0) {
+            continue;
+        }
+
+        VkBuffer vertexBuffers[] = { chunk->VertexBuffer };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(cmdBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(cmdBuffer, chunk->VertexBuffer, static_cast<VkDeviceSize>(sizeof(Vertex) * chunk->vertexSize), VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(cmdBuffer, chunk->waterIndexCount, 1, chunk->waterFirstIndex, 0, 0);
+
+        stats.chunksDrawn++;
+        stats.triangles += chunk->waterIndexCount / 3;
+    }
+
+    stats.recordMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    translucentStats = stats;
+}
+
+uint16_t Terrain::visibleSectionMask(const Chunk& chunk) const {
+    if (!sectionCullingEnabled || !cullResultValid) {
+        return 0xffff;
+    }
+    return chunk.cullFrame == cullFrame ? chunk.visibleSections : 0;
+}
+
+ZoneCommandCache::Key Terrain::zoneCacheKey(size_t zoneIndex, VkPipeline pipeline, VkDescriptorSet descriptorSet, VkExtent2D extent) {
+    ZoneCommandCache::Key key;
+    key.version = drawZoneVersions[zoneIndex];
+    key.pipeline = pipeline;
+    key.descriptorSet = descriptorSet;
+    key.extent = extent;
+    key.chunkOrder = zoneChunkOrder(zoneIndex);
+    return key;
+}
+
+bool Terrain::zoneVisible(size_t zoneIndex) const {
+    for (int i = 0; i < 16; i++) {
+        const GpuChunk* chunk = drawList[zoneIndex * 16 + i];
+        if (chunk && chunk->VertexBuffer != VK_NULL_HANDLE && visibleSectionMask(*chunk) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Terrain::zoneSectionCount(size_t zoneIndex) const {
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+        const GpuChunk* chunk = drawList[zoneIndex * 16 + i];
+        if (chunk && chunk->VertexBuffer != VK_NULL_HANDLE) {
+            for (const ChunkSection& section : chunk->sections) {
+                count += section.indexCount > 0;
+            }
+        }
+    }
+    return count;
+}
+
+GpuChunk* Terrain::findChunk(int x, int z) const {
+    auto it = m_chunks.find(toKey(x, z));
+    return it != m_chunks.end() ? it->second.get() : nullptr;
+}
+
+void Terrain::cullSections(const glm::vec3& position, const glm::vec3& forward) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // half the diagonal of a section, so a section straddling the
+    // camera plane still counts as in front of it
+    const float sectionRadius = SECTION_SIZE * 0.8660254f;
+
+    struct Step {
+        glm::ivec3 section;     // (chunk origin x, section index, chunk origin z)
+        int entered;            // the face we came in through, -1 for the camera's section
+        uint8_t directions;     // every Direction taken so far on the way here
+    };
+
+    static const std::array<glm::ivec3, 6> dirOffsets = { {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+    } };
+
+    cullFrame++;
+    cullStats = SectionCullStats();
+
+    glm::ivec3 origin(roundDown(int(glm::floor(position.x)), CHUNK_LENGTH),
+        glm::clamp(int(glm::floor(position.y / SECTION_SIZE)), 0, SECTION_COUNT - 1),
+        roundDown(int(glm::floor(position.z)), CHUNK_LENGTH));
+
+    GpuChunk* originChunk = drawListAt(origin.x, origin.z);
+    cullResultValid = originChunk && originChunk->VertexBuffer != VK_NULL_HANDLE;
+    if (!cullResultValid) {
+        return;
+    }
+
+    // a section is marked visible when it is first queued, which also
+    // stops it from being queued twice
+    auto markVisited = [this](GpuChunk* chunk, int section) {
+        if (chunk->cullFrame != cullFrame) {
+            chunk->cullFrame = cullFrame;
+            chunk->visibleSections = 0;
+        }
+        if (chunk->visibleSections & (1 << section)) {
+            return false;
+        }
+        chunk->visibleSections |= 1 << section;
+        return true;
+    };
+
+    std::queue<Step> queue;
+    markVisited(originChunk, origin.y);
+    queue.push({ origin, -1, 0 });
+
+    while (!queue.empty()) {
+        Step step = queue.front();
+        queue.pop();
+        cullStats.sectionsVisited++;
+
+        GpuChunk* chunk = drawListAt(step.section.x, step.section.z);
+
+        for (int d = 0; d < 6; d++) {
+            Direction dir = Direction(d);
+            // never head back towards the camera
+            if (step.directions & (1 << (d ^ 1))) {
+                continue;
+            }
+            // chunks without a mesh yet are treated as see-through
+            if (step.entered >= 0 && chunk->VertexBuffer != VK_NULL_HANDLE &&
+                !chunk->sections[step.section.y].visibility.isConnected(Direction(step.entered), dir)) {
+                continue;
+            }
+
+            glm::ivec3 next = step.section + dirOffsets[d] * glm::ivec3(CHUNK_LENGTH, 1, CHUNK_LENGTH);
+            if (next.y < 0 || next.y >= SECTION_COUNT) {
+                continue;
             }
+
+            glm::vec3 center = glm::vec3(next.x, next.y * SECTION_SIZE, next.z) + glm::vec3(SECTION_SIZE * 0.5f);
+            if (glm::dot(center - position, forward) < -sectionRadius) {
+                continue;
+            }
+
+            // outside the draw radius there is no Chunk in the draw list
+            GpuChunk* nextChunk = drawListAt(next.x, next.z);
+            if (!nextChunk || !markVisited(nextChunk, next.y)) {
+                continue;
+            }
+            // opposite faces share a pair, XPOS/XNEG etc., so d ^ 1 is the face we enter through
+            queue.push({ next, d ^ 1, uint8_t(step.directions | (1 << d)) });
+        }
+    }
+
+    cullStats.cullTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+
+void Terrain::setDrawMultiplier(int multiplier) {
+    drawMultiplier = glm::clamp(multiplier, 1, TERRAIN_CREATE_MULTIPLIER);
+}
+
+LodLevelStats Terrain::getDetailStats() const {
+    LodLevelStats stats;
+    for (const GpuChunk* chunk : drawList) {
+        if (chunk && chunk->VertexBuffer != VK_NULL_HANDLE) {
+            stats.tiles++;
+            stats.triangles += chunk->numIndices / 3;
+            stats.bytes += chunk->bufferSize;
         }
     }
+    stats.drawn = stats.tiles;
+    return stats;
 }
 
+int Terrain::getMaxDrawMultiplier() const {
+    return TERRAIN_CREATE_MULTIPLIER;
+}
 
-void Terrain::draw(const glm::vec3& position, VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet) {
+const std::vector<glm::ivec2>& Terrain::prepareDraw(const glm::vec3& position, const glm::vec3& forward) {
     int tx = roundDown(int(position.x), ZONE_SIZE);
     int tz = roundDown(int(position.z), ZONE_SIZE);
 
-    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *currentPipeline);
+    // the list only moves when the player changes zone
+    glm::ivec2 center = drawListOrigin + ZONE_SIZE * drawListMultiplier;
+    if (drawListSide == 0 || drawListMultiplier != drawMultiplier || center != glm::ivec2(tx, tz)) {
+        rebuildDrawList(tx, tz);
+    }
+    lod.select(drawListOrigin, drawListOrigin + drawListSide * ZONE_SIZE, threadPool);
+    cameraChunk = glm::ivec2(roundDown(int(position.x), CHUNK_LENGTH), roundDown(int(position.z), CHUNK_LENGTH));
+
+    if (sectionCullingEnabled) {
+        cullSections(position, forward);
+    }
+    else {
+        cullStats = SectionCullStats();
+    }
+    return drawZones;
+}
+
+void Terrain::draw(const glm::vec3& position, const glm::vec3& forward, VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet) {
+    auto start = std::chrono::high_resolution_clock::now();
+    prepareDraw(position, forward);
 
-    for (int z = tz - TERRAIN_DRAW_RADIUS; z <= tz + TERRAIN_DRAW_RADIUS; z += ZONE_SIZE) {
-        for (int x = tx - TERRAIN_DRAW_RADIUS; x <= tx + TERRAIN_DRAW_RADIUS; x += ZONE_SIZE) {
-            drawZone(glm::ivec2(x, z), cmdBuffer, descriptorSet); 
+    const std::vector<size_t>& order = zoneOrder();
+
+    if (depthPrepass) {
+        // the same sections as the colour pass, counted only once
+        SectionCullStats prepassStats;
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineDepthPrepass);
+        for (size_t i : order) {
+            drawZone(i, cmdBuffer, descriptorSet, prepassStats);
         }
     }
+
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, opaquePipeline());
+    for (size_t i : order) {
+        drawZone(i, cmdBuffer, descriptorSet, cullStats);
+    }
+
+    // LOD tiles never overlap the chunks, so they skip the pre-pass
+    if (depthPrepass) {
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *currentPipeline);
+    }
+    lod.draw(position, forward, cmdBuffer, pipelineLayout, descriptorSet);
+    drawTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
 }
 
+// Shared between the main thread and the workers recording one frame. Workers
+// that are only picked up after every zone is recorded find nothing left to do,
+// so this outlives drawParallel through the shared_ptr the tasks hold.
+struct ParallelRecordJob {
+    std::vector<size_t> zones;      // indices into Terrain::drawZones
+    std::vector<VkPipeline> pipelines;  // each zone's pass: depth pre-pass or colour
+    std::vector<bool> depthOnly;    // the pre-pass draws the same sections again, so its stats are dropped
+    std::vector<size_t> outputs;    // where each zone's buffer goes in drawParallel's result
+    // with caching on, the cache entry each zone is recorded into
+    std::vector<ZoneCommandCache::Entry*> entries;
+    VkCommandBufferInheritanceInfo inheritance;
+    VkViewport viewport;
+    VkRect2D scissor;
+    VkDescriptorSet descriptorSet;
+    uint32_t frame;
+
+    std::vector<VkCommandBuffer> buffers;
+    std::vector<SectionCullStats> stats;
+    std::vector<float> recordMs;
+    std::atomic<size_t> next{ 0 };
+    std::atomic<size_t> done{ 0 };
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::exception_ptr error;
+};
+
+void Terrain::recordZones(std::shared_ptr<ParallelRecordJob> job, size_t slot) {
+    size_t i;
+    while ((i = job->next.fetch_add(1)) < job->zones.size()) {
+        try {
+            const glm::ivec2& origin = drawZones[job->zones[i]];
+            TRACE_SCOPE("record zone", "record", origin.x, origin.y);
+            auto start = std::chrono::high_resolution_clock::now();
+            bool cached = !job->entries.empty();
+            VkCommandBuffer cmdBuffer = cached ? job->entries[i]->frames[job->frame].buffer
+                : context->secondaryCommandPools.acquire(job->frame, slot);
+            beginSecondaryCommandBuffer(cmdBuffer, job->inheritance, !cached);
+
+            // dynamic state isn't inherited from the primary command buffer
+            vkCmdSetViewport(cmdBuffer, 0, 1, &job->viewport);
+            vkCmdSetScissor(cmdBuffer, 0, 1, &job->scissor);
+            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, job->pipelines[i]);
+            drawZone(job->zones[i], cmdBuffer, job->descriptorSet, job->stats[i], cached);
+
+            if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to record secondary command buffer!");
+            }
+            job->buffers[i] = cmdBuffer;
+            job->recordMs[i] = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(job->doneMutex);
+            job->error = std::current_exception();
+        }
+
+        if (job->done.fetch_add(1) + 1 == job->zones.size()) {
+            std::lock_guard<std::mutex> lock(job->doneMutex);
+            job->doneCondition.notify_one();
+        }
+    }
+}
+
+std::vector<VkCommandBuffer> Terrain::drawParallel(const glm::vec3& position, const glm::vec3& forward,
+    const VkCommandBufferInheritanceInfo& inheritance, const VkViewport& viewport, const VkRect2D& scissor,
+    uint32_t frame, VkDescriptorSet descriptorSet)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    const std::vector<glm::ivec2>& zones = prepareDraw(position, forward);
+    cacheStats = CommandCacheStats();
+
+    // with a depth pre-pass every zone is recorded twice, and all of the
+    // pre-pass buffers are executed before any of the colour ones
+    struct Pass {
+        VkPipeline pipeline;
+        ZoneCommandCache* cache;
+        bool depthOnly;
+    };
+    std::vector<Pass> passes;
+    if (depthPrepass) {
+        passes.push_back({ pipelineDepthPrepass, &prepassCommandCache, true });
+    }
+    passes.push_back({ opaquePipeline(), &zoneCommandCache, false });
+    std::vector<VkCommandBuffer> buffers(passes.size() * zones.size(), VK_NULL_HANDLE);
+
+    auto job = std::make_shared<ParallelRecordJob>();
+    job->inheritance = inheritance;
+    job->viewport = viewport;
+    job->scissor = scissor;
+    job->descriptorSet = descriptorSet;
+    job->frame = frame;
+
+    if (commandCaching) {
+        // a cached buffer is executed with whichever swapchain framebuffer
+        // is current, so it can't name the one it was recorded with
+        job->inheritance.framebuffer = VK_NULL_HANDLE;
+        cacheFrameNumber++;
+    }
+
+    size_t output = 0;
+    for (const Pass& pass : passes) {
+        for (size_t i : zoneOrder()) {
+            if (commandCaching) {
+                // the cached buffers draw every section, so a zone is culled
+                // whole or not at all
+                if (!zoneVisible(i)) {
+                    if (!pass.depthOnly) {
+                        cullStats.sectionsCulled += zoneSectionCount(i);
+                    }
+                    cacheStats.zonesCulled++;
+                    continue;
+                }
+                ZoneCommandCache::Key key = zoneCacheKey(i, pass.pipeline, descriptorSet, scissor.extent);
+                ZoneCommandCache::Entry* entry = pass.cache->acquire(toKey(zones[i].x, zones[i].y), cacheFrameNumber);
+                ZoneCommandCache::Frame& cached = entry->frames[frame];
+
+                if (cached.valid && cached.key == key) {
+                    buffers[output++] = cached.buffer;
+                    if (!pass.depthOnly) {
+                        cullStats.sectionsDrawn += cached.sectionsDrawn;
+                        cullStats.sectionsCulled += cached.sectionsCulled;
+                    }
+                    cacheStats.zonesReused++;
+                    continue;
+                }
+                // only marked valid again once it has been recorded
+                cached.valid = false;
+                cached.key = key;
+                job->entries.push_back(entry);
+            }
+            job->zones.push_back(i);
+            job->pipelines.push_back(pass.pipeline);
+            job->depthOnly.push_back(pass.depthOnly);
+            job->outputs.push_back(output++);
+        }
+    }
+
+    // the last slot belongs to the main thread, which records zones too
+    // instead of sitting idle while the workers finish generation tasks
+    size_t mainSlot = context->secondaryCommandPools.slotCount() - 1;
+    if (!job->zones.empty()) {
+        job->buffers.resize(job->zones.size(), VK_NULL_HANDLE);
+        job->stats.resize(job->zones.size());
+        job->recordMs.resize(job->zones.size(), 0.f);
+
+        size_t workerCount = std::min(job->zones.size() - 1, mainSlot);
+        for (size_t slot = 0; slot < workerCount; slot++) {
+            threadPool.enqueuePriority(&Terrain::recordZones, this, job, slot);
+        }
+        recordZones(job, mainSlot);
+
+        {
+            std::unique_lock<std::mutex> lock(job->doneMutex);
+            job->doneCondition.wait(lock, [&job] { return job->done.load() == job->zones.size(); });
+            if (job->error) {
+                std::rethrow_exception(job->error);
+            }
+        }
+    }
+
+    for (size_t j = 0; j < job->zones.size(); j++) {
+        const SectionCullStats& stats = job->stats[j];
+        buffers[job->outputs[j]] = job->buffers[j];
+        if (!job->depthOnly[j]) {
+            cullStats.sectionsDrawn += stats.sectionsDrawn;
+            cullStats.sectionsCulled += stats.sectionsCulled;
+        }
+        cacheStats.recordMs += job->recordMs[j];
+
+        if (commandCaching) {
+            ZoneCommandCache::Frame& cached = job->entries[j]->frames[frame];
+            cached.valid = true;
+            cached.sectionsDrawn = stats.sectionsDrawn;
+            cached.sectionsCulled = stats.sectionsCulled;
+            avgZoneRecordMs += (job->recordMs[j] - avgZoneRecordMs) * 0.05f;
+        }
+    }
+
+    // culled zones left their slots empty
+    buffers.erase(std::remove(buffers.begin(), buffers.end(), VK_NULL_HANDLE), buffers.end());
+
+    // LOD tiles are few and already grouped, one buffer from the main thread covers them
+    if (lod.enabled) {
+        VkCommandBuffer cmdBuffer = context->secondaryCommandPools.acquire(frame, mainSlot);
+        beginSecondaryCommandBuffer(cmdBuffer, job->inheritance);
+        vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *currentPipeline);
+        lod.draw(position, forward, cmdBuffer, pipelineLayout, descriptorSet);
+        if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record LOD command buffer!");
+        }
+        buffers.push_back(cmdBuffer);
+    }
+
+    if (commandCaching) {
+        cacheStats.zonesRecorded = static_cast<int>(job->zones.size());
+        cacheStats.savedMs = cacheStats.zonesReused * avgZoneRecordMs;
+        zoneCommandCache.evict(cacheFrameNumber, ZONE_CACHE_MAX_AGE);
+        prepassCommandCache.evict(cacheFrameNumber, ZONE_CACHE_MAX_AGE);
+    }
+    else {
+        cacheStats.zonesRecorded = static_cast<int>(job->zones.size());
+    }
+    drawTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return buffers;
+}
@@ -2,19 +2,51 @@
 #include "globals.h"
 #include "smartpointerhelp.h"
 #include "glm_includes.h"
-#include "chunk.h"
+#include "gpu_chunk.h"
 #include "threadpool.h"
 #include "commandpoolmanager.h"
+#include "zonecommandcache.h"
+#include "terrain_lod.h"
+#include "terrain_util.h"
+#include "voxel_raycast.h"
+#include "voxel_collision.h"
+#include "block_access.h"
+#include "edit_batch.h"
+#include "light_engine.h"
+#include "water_simulation.h"
 
 #include <array>
+#include <condition_variable>
 #include <unordered_map>
 #include <unordered_set>
 
-// Helper functions to convert (x, z) to and from hash map key
-int64_t toKey(int x, int z);
-glm::ivec2 toCoords(int64_t k);
-
 class Renderer; 
+struct ParallelRecordJob;
+
+// Per-frame counters for the section visibility culler, shown in the overlay
+struct SectionCullStats {
+    int sectionsVisited = 0;    // sections reached by the traversal
+    int sectionsDrawn = 0;      // non-empty sections that were drawn
+    int sectionsCulled = 0;     // non-empty sections in the draw radius that were skipped
+    float cullTimeMs = 0.f;
+};
+
+// Per-frame counters for the zone command buffer cache, shown in the overlay
+struct CommandCacheStats {
+    int zonesRecorded = 0;      // cache misses, recorded this frame (one per zone and pass)
+    int zonesReused = 0;        // cache hits, executed without recording
+    float recordMs = 0.f;       // summed recording time of the missed zones
+    float savedMs = 0.f;        // estimated recording time the hits saved
+    int zonesCulled = 0;        // not executed, the culler reached none of their sections
+};
+
+// Per-frame numbers for the translucent (water) pass, shown in the overlay
+struct TranslucentStats {
+    int chunksDrawn = 0;        // chunks whose water faces were drawn
+    size_t triangles = 0;
+    float recordMs = 0.f;       // CPU time to record the pass
+    float gpuMs = 0.f;          // GPU time of the translucent and composite subpasses, filled in by Renderer
+};
 
 // The container class for all of the Chunks in the game.
 // Ultimately, while Terrain will always store all Chunks,
@@ -29,7 +61,7 @@ private:
     // so that we can use them as a key for the map, as objects like std::pairs or
     // glm::ivec2s are not hashable by default, so they cannot be used as keys.
     Renderer* context; 
-    std::unordered_map<int64_t, uPtr<Chunk>> m_chunks;
+    std::unordered_map<int64_t, uPtr<GpuChunk>> m_chunks;
     std::mutex m_chunks_mutex; 
 
     // We will designate every 64 x 64 area of the world's x-z plane
@@ -47,20 +79,224 @@ private:
     // in the Terrain will never be deleted until the program is terminated.
     std::unordered_set<int64_t> m_generatedTerrain;
     VkPipeline pipelineChunks;
+    // water faces into the OIT targets of the translucent subpass
+    VkPipeline pipelineWater;
+    // depth only, no fragment shader, for the optional pre-pass
+    VkPipeline pipelineDepthPrepass;
+    // the chunk pipeline with an EQUAL depth test and no depth writes, for
+    // the colour pass after a pre-pass so every sample is shaded once
+    VkPipeline pipelineChunksEqual;
     ThreadPool threadPool; 
+    // sky and block light of every generated Chunk, on threadPool; its
+    // changes are remeshed like block edits
+    LightEngine lightEngine;
+    // flowing water, stepped by tickWater on the simulation thread
+    WaterSimulation water;
 
-    std::vector<Chunk*> pendingChunks; 
+    std::vector<GpuChunk*> pendingChunks; 
     std::mutex pendingChunksMutex; 
 
-    std::vector<Chunk*> drawableChunks; 
+    std::vector<GpuChunk*> drawableChunks; 
     std::mutex drawableChunksMutex; 
 
+    // zones whose Chunks aren't all uploaded yet, keyed by toKey of the
+    // zone's corner
+    struct ZoneProgress {
+        int64_t enqueuedNs;
+        int chunksVisible;
+    };
+    std::unordered_map<int64_t, ZoneProgress> zoneProgress;
+    // tryExpansion adds to zoneProgress on the simulation thread
+    std::mutex zoneProgressMutex;
+
     CommandPoolManager transferCmdPoolManager;
+
+    // Sections that block edits have changed since they were last meshed,
+    // keyed by toKey of the Chunk's corner
+    struct DirtyChunk {
+        uint16_t sections;      // one bit per section
+        int64_t editNs;         // the oldest edit not remeshed yet
+        bool edited;            // by a block edit, not only by light or water
+    };
+    std::unordered_map<int64_t, DirtyChunk> dirtyChunks;
+    std::mutex dirtyChunksMutex;
+
+    // Meshes the dirty sections of an edited Chunk on a worker. It works from
+    // copies of the Chunk's blocks and its neighbours' borders, so more edits
+    // can be made while it runs; those mark the Chunk dirty again.
+    struct RemeshJob {
+        GpuChunk* chunk;
+        uint16_t sections;
+        int64_t editNs;
+        bool edited;
+        int64_t meshStartNs;
+        int64_t meshEndNs;
+        std::vector<BlockType> blocks;
+        ChunkBorders borders;
+        // the Chunk's section meshes, handed to the job and back; empty on
+        // the Chunk's first remesh, which meshes every section
+        uPtr<SectionMeshes> meshes;
+        ChunkMesh mesh;
+    };
+    // section meshes of the Chunks that have been remeshed, by toKey of
+    // their corner. Only touched on the main thread.
+    std::unordered_map<int64_t, uPtr<SectionMeshes>> sectionMeshes;
+    // Chunks with a RemeshJob in flight, and how many of those jobs are for
+    // block edits. Only touched on the main thread.
+    std::unordered_set<int64_t> remeshing;
+    size_t editsRemeshing;
+    std::vector<std::shared_ptr<RemeshJob>> remeshedChunks;
+    std::mutex remeshedChunksMutex;
+    std::condition_variable remeshedChunksReady;
+
+    // Chunk buffers replaced by a remesh, freed once no frame in flight can
+    // still be drawing from them
+    struct RetiredBuffer {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        uint64_t frame;
+    };
+    std::vector<RetiredBuffer> retiredBuffers;
+    // counts updateChunks calls, which is once per frame
+    uint64_t frameNumber;
+
+    // markEdited without the relight or waking the water, for the
+    // LightEngine's and the water's own changes. Only remeshes of edited
+    // Chunks hold up the frame in finishRemeshes.
+    void markRemesh(const glm::ivec3& min, const glm::ivec3& max, bool edited);
+    // Adds the sections to the Chunk's DirtyChunk. Caller must hold
+    // dirtyChunksMutex.
+    void markDirty(int64_t key, uint16_t sections, int64_t editNs, bool edited);
+    // Enqueues a RemeshJob for every dirty Chunk that is uploaded and not
+    // already being remeshed
+    void startRemeshes();
+    // Swaps in the finished remeshes, first waiting up to waitNs for the
+    // ones of block edits in flight
+    void finishRemeshes(int64_t waitNs);
+    void freeRetiredBuffers(bool all);
+
+    // bumped every time cullSections runs so Chunk::visibleSections can be
+    // compared against it instead of being cleared
+    uint32_t cullFrame;
+    // false when the camera's chunk isn't drawable yet, so nothing is culled
+    bool cullResultValid;
+
+    // Returns the Chunk at these chunk-origin coordinates if it exists,
+    // without inserting an empty entry. Caller must hold m_chunks_mutex.
+    GpuChunk* findChunk(int x, int z) const;
+    // findChunk, but nullptr until the Chunk's blocks are generated, so
+    // readers never see blocks a worker is still writing. Caller must hold
+    // m_chunks_mutex.
+    GpuChunk* findGeneratedChunk(int x, int z) const;
+    // The generated Chunks around the one at origin, in the order
+    // Chunk::copyBorders takes them. Caller must hold m_chunks_mutex.
+    std::array<const Chunk*, 8> generatedNeighbours(glm::ivec2 origin) const;
+    // Marks a freshly lit Chunk generated, and queues a remesh of the
+    // neighbours whose first mesh was built without it
+    void publishGenerated(GpuChunk* chunk);
+    // findGeneratedChunk as a ChunkLookup that takes m_chunks_mutex for each
+    // lookup. Chunks are never removed, so what it returns stays valid.
+    ChunkLookup generatedChunks();
+
+    // how many zones around the player's zone are drawn, <= the create radius
+    int drawMultiplier;
+
+    // Every Chunk in the draw radius, so the per-frame paths (culling, cache
+    // keys, recording) index a flat array instead of locking and hashing into
+    // m_chunks. Each zone owns 16 consecutive slots, z-major like the chunks
+    // within it, and a slot is nullptr until its Chunk exists. Only touched
+    // on the main thread, or by workers while the main thread waits on them.
+    std::vector<GpuChunk*> drawList;
+    std::vector<glm::ivec2> drawZones;          // lower-left corner of each zone, in slot order
+    std::vector<uint32_t> drawZoneVersions;     // zoneVersions of each zone, in slot order
+    glm::ivec2 drawListOrigin;                  // lower-left corner of the first zone
+    int drawListSide;                           // zones along each side, 0 until first built
+    int drawListMultiplier;                     // drawMultiplier the list was built for
+    // zone indices bucketed by ring around the player's zone, nearest ring
+    // first, and the same indices in slot order
+    std::vector<size_t> drawOrderNear;
+    std::vector<size_t> drawOrderRaster;
+    // chunk-origin coordinates of the Chunk the camera was in at the last prepareDraw
+    glm::ivec2 cameraChunk;
+
+    // Refills drawList around the zone at (x, z), called when the player
+    // changes zone or the draw radius changes
+    void rebuildDrawList(int x, int z);
+    // Puts the Chunk in its slot if it lies in the draw radius
+    void addToDrawList(GpuChunk* chunk);
+    // Slot index of the Chunk at these chunk-origin coordinates, -1 outside the draw radius
+    int drawListSlot(int x, int z) const;
+    // The Chunk at these chunk-origin coordinates, nullptr if it is outside
+    // the draw radius or doesn't exist yet
+    GpuChunk* drawListAt(int x, int z) const;
+
+    // Updates the draw list, runs the culler and returns the lower-left
+    // corner of every zone in the draw radius
+    const std::vector<glm::ivec2>& prepareDraw(const glm::vec3& position, const glm::vec3& forward);
+    // The order zones are drawn in, front to back when frontToBack is set
+    const std::vector<size_t>& zoneOrder() const { return frontToBack ? drawOrderNear : drawOrderRaster; }
+    // Which of chunkOrders() the zone's Chunks are drawn in: front to back
+    // from the zone's Chunk nearest the camera, or slot order
+    uint8_t zoneChunkOrder(size_t zoneIndex) const;
+    // The pipeline for the colour pass of the opaque chunks
+    VkPipeline opaquePipeline() const { return depthPrepass ? pipelineChunksEqual : *currentPipeline; }
+    // Bumped whenever anything a zone's draw commands depend on changes (a
+    // chunk in it was uploaded or remeshed), keyed by the zone's lower-left corner.
+    // Only touched on the main thread.
+    std::unordered_map<int64_t, uint32_t> zoneVersions;
+    ZoneCommandCache zoneCommandCache;
+    // the zones' depth pre-pass buffers, same keys as zoneCommandCache
+    ZoneCommandCache prepassCommandCache;
+    // counts drawParallel calls with caching on, used to age out cache entries
+    uint64_t cacheFrameNumber;
+    // running average of one zone's recording time, for CommandCacheStats::savedMs
+    float avgZoneRecordMs;
+
+    // Which of the chunk's sections drawZone will draw
+    uint16_t visibleSectionMask(const Chunk& chunk) const;
+    // Everything the zone's cached command buffer depends on. Not the culled
+    // sections, which change whenever the camera does.
+    ZoneCommandCache::Key zoneCacheKey(size_t zoneIndex, VkPipeline pipeline, VkDescriptorSet descriptorSet, VkExtent2D extent);
+    // Whether the culler reached any section of the zone's Chunks
+    bool zoneVisible(size_t zoneIndex) const;
+    // The non-empty sections of the zone's uploaded Chunks
+    int zoneSectionCount(size_t zoneIndex) const;
+
+    // Worker body for drawParallel: records zones into secondary command
+    // buffers from the given pool slot until there are none left
+    void recordZones(std::shared_ptr<ParallelRecordJob> job, size_t slot);
 public:
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
     VkPipeline* currentPipeline;
 
+    bool sectionCullingEnabled;
+    SectionCullStats cullStats;
+    // record zones into secondary command buffers on the thread pool
+    // instead of inline into the primary command buffer
+    bool parallelRecording;
+    // reuse each zone's secondary command buffer until the zone changes,
+    // only used with parallelRecording
+    bool commandCaching;
+    CommandCacheStats cacheStats;
+    // CPU time of the last draw or drawParallel call, culling included
+    float drawTimeMs;
+    // heightmap tiles drawn past the draw radius
+    TerrainLod lod;
+    // draw zones, and the Chunks within each zone, nearest first so the
+    // depth test rejects more of what is behind them
+    bool frontToBack;
+    // lay down the opaque depth in a depth-only pass first, then shade with
+    // an EQUAL depth test so no sample is shaded twice
+    bool depthPrepass;
+    // draw water in the translucent subpass, off leaves the subpass empty
+    bool translucentPass;
+    TranslucentStats translucentStats;
+    // latency of each step from a zone entering the create radius to its
+    // Chunks being drawable
+    ChunkPipelineStats pipelineStats;
+    ChunkQueueDepths queueDepths();
+
     Terrain(Renderer* vulkanContext);
     ~Terrain();
 
@@ -70,14 +306,22 @@ public:
     // Instantiates a new Chunk and stores it in
     // our chunk map at the given coordinates.
     // Returns a pointer to the created Chunk.
-    Chunk* instantiateChunkAt(int x, int z);
-    void drawZone(glm::ivec2 zone, VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet);
+    GpuChunk* instantiateChunkAt(int x, int z);
+    // Records the draws of the zone at this index of the draw list, with
+    // whichever pipeline is bound. allSections ignores the culler, for
+    // buffers that are reused while the camera moves.
+    void drawZone(size_t zoneIndex, VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet, SectionCullStats& stats, bool allSections = false);
+    // Breadth-first walk over sections starting at the camera's section.
+    // A section is only entered through a face its neighbour can see out of,
+    // and the walk never turns back towards the camera, so sections hidden
+    // behind solid ground are never reached and are skipped in drawZone.
+    void cullSections(const glm::vec3& position, const glm::vec3& forward);
     // Do these world-space coordinates lie within
     // a Chunk that exists?
     bool hasChunkAt(int x, int z);
     // Assuming a Chunk exists at these coords,
     // return a mutable reference to it
-    uPtr<Chunk>& getChunkAt(int x, int z);
+    uPtr<GpuChunk>& getChunkAt(int x, int z);
     // Given a world-space coordinate (which may have negative
     // values) return the block stored at that point in space.
     BlockType getBlockAt(int x, int y, int z);
@@ -85,14 +329,86 @@ public:
     // values) set the block at that point in space to the
     // given type.
     void setBlockAt(int x, int y, int z, BlockType t);
+    // A cursor over the generated Chunks, for walking over many nearby
+    // blocks with one Chunk lookup per Chunk instead of one per block
+    BlockCursor cursorAt(const glm::ivec3& position);
+    // Copy every block in the box from min to max (both included) out of or
+    // into the generated Chunks, see readRegion/writeRegion in block_access.h
+    size_t readRegion(const glm::ivec3& min, const glm::ivec3& max, BlockType* out);
+    size_t writeRegion(const glm::ivec3& min, const glm::ivec3& max, const BlockType* in);
+    // Queues a remesh of every section the blocks in the box (both included)
+    // show up in: their own, the ones above and below when they are on a
+    // section's edge, and the neighbouring Chunk's when they are on a
+    // Chunk's edge, and relights them and wakes the water around them.
+    // setBlockAt and writeRegion call this; call it yourself after writing
+    // blocks through a BlockCursor.
+    void markEdited(const glm::ivec3& min, const glm::ivec3& max);
+    // Writes the batch into the generated Chunks, looking each one up once,
+    // and marks every section it touched for one remesh. Returns the blocks
+    // written; edits to Chunks that aren't generated are dropped.
+    size_t applyEdits(const EditBatch& batch);
+    // How long tryExpansion waits for the remeshes of this frame's edits, so
+    // they show in the frame they were made in. 0 shows them a frame or so
+    // later. Light and water remeshes are never waited for.
+    float remeshWaitMs;
+    // The first opaque block (or water, with stopAtWater) along the ray,
+    // for block picking. Only sees generated Chunks.
+    RayHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, bool stopAtWater = false);
+    // The same for many rays at once, e.g. line of sight checks, taking the
+    // lock and looking up each Chunk once for the whole batch
+    void raycastBatch(const std::vector<Ray>& rays, std::vector<RayHit>& hits, bool stopAtWater = false);
+    // Moves the body by dt seconds against the generated Chunks, see
+    // stepBody in voxel_collision.h. Chunks that aren't generated yet are
+    // solid, so the body waits at their edge.
+    void stepBody(PhysicsBody& body, const BodyControl& control, float dt);
+    // The same for many bodies (mobs), taking the lock once for all of them.
+    // controls[i] steers bodies[i].
+    void stepBodies(std::vector<PhysicsBody>& bodies, const std::vector<BodyControl>& controls, float dt);
+
+    LightEngine::Stats lightStats() const { return lightEngine.stats(); }
+    // One step of the water simulation, writing the blocks that flowed and
+    // remeshing them. Called from the simulation thread.
+    void tickWater();
+    WaterSimulation::Stats waterStats() const { return water.stats(); }
+    void setWaterBudget(size_t cells) { water.setBudget(cells); }
+    size_t getWaterBudget() const { return water.getBudget(); }
 
+    // Enqueues generation of the zones in the create radius around pos that
+    // don't have block data yet. Called from the simulation thread.
     void tryExpansion(const glm::vec3& pos); 
+    // Render thread, once a frame: hands generated Chunks to meshing,
+    // uploads meshed ones and remeshes, and updates the LOD tiles
+    void updateChunks();
+    // Marks the zone containing these world-space coordinates as changed,
+    // so its cached draw commands are recorded again
+    void invalidateZoneAt(int x, int z);
 
-    void threadCreateBlockData(glm::vec2 terrainCoord); 
-    void threadCreateBufferData(Chunk* chunk); 
+    void threadCreateBlockData(glm::vec2 terrainCoord, int64_t enqueuedNs); 
+    void threadCreateBufferData(GpuChunk* chunk); 
+    void threadRemeshChunk(std::shared_ptr<RemeshJob> job);
 
     // Draws every Chunk that falls within the bounding box
     // described by the min and max coords, using the provided
     // ShaderProgram
-    void draw(const glm::vec3& position, VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet);
+    void draw(const glm::vec3& position, const glm::vec3& forward, VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet);
+    // Same as draw, but each zone is recorded into its own secondary command
+    // buffer on the thread pool, or reused from the cache if the zone hasn't changed. Returns them in draw order, the
+    // depth pre-pass buffers first, ready for vkCmdExecuteCommands inside a
+    // render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+    std::vector<VkCommandBuffer> drawParallel(const glm::vec3& position, const glm::vec3& forward,
+        const VkCommandBufferInheritanceInfo& inheritance, const VkViewport& viewport, const VkRect2D& scissor,
+        uint32_t frame, VkDescriptorSet descriptorSet);
+
+    // Records the water faces of every drawable Chunk in the draw radius that
+    // the culler reached. Must be recorded inside SUBPASS_TRANSLUCENT, after
+    // draw or drawParallel has updated the draw list for this frame. The
+    // faces are composited with weighted blended OIT, so they aren't sorted.
+    void drawTranslucent(VkCommandBuffer cmdBuffer, VkDescriptorSet descriptorSet);
+
+    // The same numbers as a LodLevelStats for the full detail chunks in the draw radius
+    LodLevelStats getDetailStats() const;
+
+    void setDrawMultiplier(int multiplier);
+    int getDrawMultiplier() const { return drawMultiplier; }
+    int getMaxDrawMultiplier() const;
 };
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "terrain_lod.h"
+#include "terrain.h"
+#include "terrain_util.h"
+#include "renderer.h"
+#include "vulkan_resources.h"
+#include "trace_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+LodTile::LodTile(const LodTileRect& rect)
+    : origin(rect.origin), size(rect.size), scale(rect.scale), vertexData(), idxData(),
+    buffer(VK_NULL_HANDLE), bufferMemory(VK_NULL_HANDLE), bufferSize(0), indexOffset(0), indexCount(0),
+    buildMs(0.f), wanted(true)
+{}
+
+int LodTile::level() const {
+    return lodLevel(scale);
+}
+
+void LodTile::createMesh() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    buildLodMesh({ origin, size, scale }, vertexData, idxData);
+    indexCount = static_cast<uint32_t>(idxData.size());
+    buildMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void LodTile::createVkBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
+    VkSurfaceKHR surface, VkCommandPool commandPool, VkQueue queue)
+{
+    indexOffset = sizeof(Vertex) * vertexData.size();
+    bufferSize = indexOffset + sizeof(uint16_t) * idxData.size();
+
+    // create a staging buffer
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(device, physicalDevice, surface, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory,
+        MemoryTracker::DEVICE_STAGING);
+
+    // copy to staging
+    void* data;
+    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, vertexData.data(), indexOffset);
+    memcpy(static_cast<char*>(data) + indexOffset, idxData.data(), idxData.size() * sizeof(uint16_t));
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    // create device buffer and copy to buffer
+    createBuffer(device, physicalDevice, surface, bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory, MemoryTracker::DEVICE_LOD_BUFFERS);
+    copyBuffer(device, commandPool, queue, stagingBuffer, buffer, bufferSize);
+
+    // destroy staging buffer
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    freeDeviceMemory(device, stagingBufferMemory);
+
+    // release the cpu copy, a tile is never remeshed
+    std::vector<Vertex>().swap(vertexData);
+    std::vector<uint16_t>().swap(idxData);
+}
+
+void LodTile::destroyVkBuffer(VkDevice device) {
+    vkDestroyBuffer(device, buffer, nullptr);
+    freeDeviceMemory(device, bufferMemory);
+    buffer = VK_NULL_HANDLE;
+    bufferMemory = VK_NULL_HANDLE;
+}
+
+TerrainLod::TerrainLod(Renderer* vulkanContext)
+    : enabled(true), stats(), context(vulkanContext), tiles(), selected(), finished(), finishedMutex(),
+    retired(), frameNumber(0), selectedMin(0), selectedMax(0), viewDistance(0)
+{}
+
+void TerrainLod::select(glm::ivec2 detailMin, glm::ivec2 detailMax, ThreadPool& threadPool) {
+    if (!enabled) {
+        detailMin = detailMax = glm::ivec2(0);
+    }
+    if (detailMin == selectedMin && detailMax == selectedMax) {
+        return;
+    }
+    selectedMin = detailMin;
+    selectedMax = detailMax;
+
+    std::vector<LodTile*> previous;
+    previous.swap(selected);
+    for (LodTile* tile : previous) {
+        tile->wanted = false;
+    }
+
+    viewDistance = 0;
+    if (detailMin != detailMax) {
+        std::vector<LodTileRect> rects;
+        viewDistance = selectLodTiles(detailMin, detailMax, rects);
+
+        for (const LodTileRect& rect : rects) {
+            int sizeIndex = 0;
+            while ((64 << sizeIndex) < rect.size) {
+                sizeIndex++;
+            }
+            uPtr<LodTile>& tile = tiles[sizeIndex][toKey(rect.origin.x, rect.origin.y)];
+            if (!tile) {
+                tile = mkU<LodTile>(rect);
+                threadPool.enqueue(&TerrainLod::buildTile, this, tile.get());
+            }
+            tile->wanted = true;
+            selected.push_back(tile.get());
+        }
+    }
+
+    // tiles still being built are retired by update() once they finish
+    for (LodTile* tile : previous) {
+        if (!tile->wanted && tile->buffer != VK_NULL_HANDLE) {
+            retire(tile);
+        }
+    }
+    updateStats();
+}
+
+void TerrainLod::buildTile(LodTile* tile) {
+    {
+        TRACE_SCOPE("build lod tile", "lod", tile->origin.x, tile->origin.y);
+        tile->createMesh();
+    }
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    finished.push_back(tile);
+}
+
+void TerrainLod::retire(LodTile* tile) {
+    int sizeIndex = 0;
+    while ((64 << sizeIndex) < tile->size) {
+        sizeIndex++;
+    }
+    auto it = tiles[sizeIndex].find(toKey(tile->origin.x, tile->origin.y));
+    retired.push_back(std::make_pair(frameNumber, std::move(it->second)));
+    tiles[sizeIndex].erase(it);
+}
+
+void TerrainLod::update() {
+    frameNumber++;
+
+    std::vector<LodTile*> ready;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        ready.swap(finished);
+    }
+
+    for (LodTile* tile : ready) {
+        if (tile->wanted) {
+            tile->createVkBuffer(context->device, context->physicalDevice,
+                context->surface, context->commandPoolTransfer, context->queueTransfer);
+        }
+        else {
+            retire(tile);
+        }
+    }
+    if (!ready.empty()) {
+        updateStats();
+    }
+
+    // a retired tile may still be referenced by a frame in flight
+    auto expired = std::remove_if(retired.begin(), retired.end(), [this](std::pair<uint64_t, uPtr<LodTile>>& entry) {
+        if (frameNumber - entry.first <= static_cast<uint64_t>(MAX_FRAMES_IN_FLIGHT)) {
+            return false;
+        }
+        entry.second->destroyVkBuffer(context->device);
+        return true;
+    });
+    retired.erase(expired, retired.end());
+}
+
+void TerrainLod::draw(const glm::vec3& position, const glm::vec3& forward, VkCommandBuffer cmdBuffer,
+    VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet)
+{
+    for (LodLevelStats& level : stats) {
+        level.drawn = 0;
+    }
+    if (!enabled || selected.empty()) {
+        return;
+    }
+
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    for (const LodTile* tile : selected) {
+        if (tile->buffer == VK_NULL_HANDLE) {
+            continue;
+        }
+        // skip tiles entirely behind the camera, the terrain is 100 - 120 blocks high
+        glm::vec3 center(tile->origin.x + tile->size * 0.5f, 110.f, tile->origin.y + tile->size * 0.5f);
+        if (glm::dot(center - position, forward) < -(tile->size * 0.7072f + LOD_SKIRT_DEPTH)) {
+            continue;
+        }
+
+        VkBuffer vertexBuffers[] = { tile->buffer };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(cmdBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(cmdBuffer, tile->buffer, tile->indexOffset, VK_INDEX_TYPE_UINT16);
+        vkCmdDrawIndexed(cmdBuffer, tile->indexCount, 1, 0, 0, 0);
+        stats[tile->level()].drawn++;
+    }
+}
+
+void TerrainLod::updateStats() {
+    std::array<float, LOD_LEVELS> buildMs = {};
+    for (LodLevelStats& level : stats) {
+        level = LodLevelStats();
+    }
+    for (const LodTile* tile : selected) {
+        LodLevelStats& level = stats[tile->level()];
+        if (tile->buffer == VK_NULL_HANDLE) {
+            level.pending++;
+            continue;
+        }
+        level.tiles++;
+        level.triangles += tile->indexCount / 3;
+        level.bytes += tile->bufferSize;
+        buildMs[tile->level()] += tile->buildMs;
+    }
+    for (int i = 0; i < LOD_LEVELS; i++) {
+        stats[i].buildMs = stats[i].tiles > 0 ? buildMs[i] / stats[i].tiles : 0.f;
+    }
+}
+
+void TerrainLod::destroyResources() {
+    // the thread pool has been stopped, so no tile is still being built
+    for (auto& map : tiles) {
+        for (auto& pair : map) {
+            pair.second->destroyVkBuffer(context->device);
+        }
+        map.clear();
+    }
+    for (auto& entry : retired) {
+        entry.second->destroyVkBuffer(context->device);
+    }
+    retired.clear();
+    selected.clear();
+}
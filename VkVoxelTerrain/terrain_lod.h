@@ -0,0 +1,104 @@
+#pragma once
+#include "globals.h"
+#include "smartpointerhelp.h"
+#include "glm_includes.h"
+#include "types.h"
+#include "threadpool.h"
+#include "lod_mesh.h"
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class Renderer;
+
+// Numbers for one level of detail, shown in the overlay
+struct LodLevelStats {
+    int tiles = 0;              // selected tiles that are uploaded
+    int pending = 0;            // selected tiles still being built
+    int drawn = 0;              // tiles drawn last frame
+    size_t triangles = 0;       // of the uploaded tiles
+    VkDeviceSize bytes = 0;     // GPU memory of the uploaded tiles
+    float buildMs = 0.f;        // average CPU time to sample and mesh one tile
+};
+
+// A square of terrain outside the voxel draw radius, meshed as a heightmap
+// sampled every `scale` blocks by buildLodMesh.
+struct LodTile {
+    glm::ivec2 origin;          // lower-left corner in world space
+    int size;                   // side length in blocks, 64 to 512
+    int scale;                  // blocks between height samples
+
+    std::vector<Vertex> vertexData;
+    std::vector<uint16_t> idxData;
+
+    // vertices followed by 16-bit indices, like Chunk::VertexBuffer
+    VkBuffer buffer;
+    VkDeviceMemory bufferMemory;
+    VkDeviceSize bufferSize;
+    VkDeviceSize indexOffset;
+    uint32_t indexCount;
+
+    float buildMs;
+    bool wanted;                // false once the tile left the selection
+
+    LodTile(const LodTileRect& rect);
+
+    int level() const;
+    // Samples the heightmap and builds the mesh, runs on a worker thread
+    void createMesh();
+    void createVkBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
+        VkSurfaceKHR surface, VkCommandPool commandPool, VkQueue queue);
+    void destroyVkBuffer(VkDevice device);
+};
+
+// Covers the view distance around the voxel draw radius with the LodTiles
+// selectLodTiles picks.
+class TerrainLod {
+public:
+    bool enabled;
+    std::array<LodLevelStats, LOD_LEVELS> stats;
+
+    TerrainLod(Renderer* vulkanContext);
+
+    // Selects the tiles around the voxel area [detailMin, detailMax), queueing
+    // the ones that aren't built yet. Only does work when the area or
+    // `enabled` changed since the last call.
+    void select(glm::ivec2 detailMin, glm::ivec2 detailMax, ThreadPool& threadPool);
+    // Uploads tiles the workers have finished and frees retired ones.
+    // Main thread, once per frame.
+    void update();
+    // Records the selected tiles that are at least partly in front of the camera.
+    // The chunk pipeline must already be bound.
+    void draw(const glm::vec3& position, const glm::vec3& forward, VkCommandBuffer cmdBuffer,
+        VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet);
+    void destroyResources();
+
+    // Distance from the centre of the voxel area to the edge of the LOD area, in blocks
+    int getViewDistance() const { return viewDistance; }
+
+private:
+    Renderer* context;
+
+    // one map per tile size (64, 128, 256, 512), keyed by toKey(origin)
+    std::array<std::unordered_map<int64_t, uPtr<LodTile>>, 4> tiles;
+    std::vector<LodTile*> selected;
+
+    // filled by the workers, drained by update()
+    std::vector<LodTile*> finished;
+    std::mutex finishedMutex;
+
+    // tiles that left the selection, destroyed once no frame in flight can use them
+    std::vector<std::pair<uint64_t, uPtr<LodTile>>> retired;
+    uint64_t frameNumber;
+
+    // the voxel area the selection was made for, empty when nothing is selected
+    glm::ivec2 selectedMin, selectedMax;
+    int viewDistance;
+
+    void buildTile(LodTile* tile);
+    // Moves a tile that is no longer selected out of the map
+    void retire(LodTile* tile);
+    void updateStats();
+};
@@ -31,14 +31,68 @@
 
 
 BlockType createBlock(int x, int y, int z) {
+    return columnBlock(terrainHeight(x, z), y);
+}
+
+BlockType columnBlock(int surfaceHeight, int y) {
+    if (y < surfaceHeight) return GRASS;
+    if (y < WATER_LEVEL) return WATER;
+
+    return EMPTY;
+}
+
+void generateChunkBlocks(Chunk& chunk) {
+    glm::ivec2 origin = chunk.getOrigin();
+    for (int chunkX = 0; chunkX < 16; chunkX++) {
+        for (int chunkZ = 0; chunkZ < 16; chunkZ++) {
+            for (int height = 0; height < 256; height++) {
+                BlockType blockType = createBlock(origin.x + chunkX, height, origin.y + chunkZ);
+
+                if (blockType != EMPTY) {
+                    chunk.setBlockAt(chunkX, height, chunkZ, blockType);
+                }
+            }
+        }
+    }
+}
+
+int terrainHeight(int x, int z) {
     SimplexNoise fbm(0.01);
     float noiseVal = fbm.fractal(3, x, z); // [-1, 1]
     float mapped = ((noiseVal + 1.0f) / 2.0f) * (120 - 100) + 100; // [100, 120]
-    int height = static_cast<int>(mapped);
+    return static_cast<int>(mapped);
+}
 
-    if (y < height) return GRASS;
+// Combine two 32-bit ints into one 64-bit int
+// where the upper 32 bits are X and the lower 32 bits are Z
+int64_t toKey(int x, int z) {
+    int64_t xz = 0xffffffffffffffff;
+    int64_t x64 = x;
+    int64_t z64 = z;
 
-    return EMPTY;
+    // Set all lower 32 bits to 1 so we can & with Z later
+    xz = (xz & (x64 << 32)) | 0x00000000ffffffff;
+
+    // Set all upper 32 bits to 1 so we can & with XZ
+    z64 = z64 | 0xffffffff00000000;
+
+    // Combine
+    xz = xz & z64;
+    return xz;
+}
+
+glm::ivec2 toCoords(int64_t k) {
+    // Z is lower 32 bits
+    int64_t z = k & 0x00000000ffffffff;
+    // If the most significant bit of Z is 1, then it's a negative number
+    // so we have to set all the upper 32 bits to 1.
+    // Note the 8    V
+    if(z & 0x0000000080000000) {
+        z = z | 0xffffffff00000000;
+    }
+    int64_t x = (k >> 32);
+
+    return glm::ivec2(x, z);
 }
 
  /**
@@ -1,10 +1,24 @@
 #pragma once
 
 #include <cstddef>  // size_t
+#include <cstdint>
 #include "chunk.h"
 
 
+// Columns whose surface is below this are filled with water up to it
+constexpr int WATER_LEVEL = 108;
+
 BlockType createBlock(int x, int y, int z); 
+// What createBlock makes at height y of a column whose surface is at surfaceHeight
+BlockType columnBlock(int surfaceHeight, int y);
+// The height of the terrain's surface column at (x, z), everything below it is solid
+int terrainHeight(int x, int z);
+// Fills every block of the Chunk with createBlock
+void generateChunkBlocks(Chunk& chunk);
+
+// Helper functions to convert (x, z) to and from hash map key
+int64_t toKey(int x, int z);
+glm::ivec2 toCoords(int64_t k);
 
 /**
  * @file    SimplexNoise.h
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+// Layout of a cooked texture (.vtex), written offline by tools/texture_cooker
+// and memory-mapped at load time:
+//
+//   TextureFileHeader
+//   TextureFileLevel[mipLevels]     largest level first
+//   level data                      contiguous, each level 16-byte aligned
+//
+// Level offsets are from the start of the file. Because the levels are
+// contiguous, the whole chain goes into a staging buffer with one copy and
+// into the image with one vkCmdCopyBufferToImage. Block-compressed levels
+// smaller than 4x4 still take one whole block.
+
+enum class TextureFormat : uint32_t {
+    RGBA8 = 0,
+    BC1 = 1,    // RGB with 1-bit alpha, 8 bytes per 4x4 block
+    BC7 = 2,    // RGBA, 16 bytes per 4x4 block (mode 6 only)
+};
+
+constexpr uint32_t TEXTURE_FILE_MAGIC = 0x58455456; // "VTEX"
+constexpr uint32_t TEXTURE_FILE_VERSION = 1;
+constexpr uint64_t TEXTURE_LEVEL_ALIGNMENT = 16;
+
+struct TextureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    TextureFormat format;
+    uint32_t srgb;          // 1 if the texels are sRGB encoded
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    uint32_t reserved;
+    uint64_t dataSize;      // sum of the level sizes, padding included
+};
+
+struct TextureFileLevel {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+inline uint32_t textureBlockDim(TextureFormat format) {
+    return format == TextureFormat::RGBA8 ? 1 : 4;
+}
+
+inline uint32_t textureBlockBytes(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::BC1: return 8;
+    case TextureFormat::BC7: return 16;
+    default: return 4;
+    }
+}
+
+inline uint64_t textureLevelBytes(TextureFormat format, uint32_t width, uint32_t height) {
+    uint32_t dim = textureBlockDim(format);
+    uint64_t blocksX = (width + dim - 1) / dim;
+    uint64_t blocksY = (height + dim - 1) / dim;
+    return blocksX * blocksY * textureBlockBytes(format);
+}
@@ -0,0 +1,7 @@
+REM Cooks the PNG atlases into .vtex containers with every mip level built in.
+REM Build tools\texture_cooker.cpp first (see the comment at its top).
+REM The colour atlas stays RGBA8: it is pixel art, and single-mode BC7 blurs
+REM tiles that mix two unrelated colours in one 4x4 block.
+..\tools\texture_cooker.exe --format rgba8 minecraft_textures_all.png minecraft_textures_all.vtex
+..\tools\texture_cooker.exe --format bc7 --linear minecraft_normals_all.png minecraft_normals_all.vtex
+echo Cooked textures
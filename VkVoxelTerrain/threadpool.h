@@ -2,7 +2,7 @@
 #define THREAD_POOL_H
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
@@ -10,6 +10,10 @@
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <string>
+
+#include "trace_recorder.h"
+#include "memory_tracker.h"
 
 class ThreadPool {
 public:
@@ -17,13 +21,24 @@ public:
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args)
         -> std::future<typename std::invoke_result<F, Args...>::type>;
+    // same as enqueue, but the task jumps ahead of everything already queued
+    template<class F, class... Args>
+    auto enqueuePriority(F&& f, Args&&... args)
+        -> std::future<typename std::invoke_result<F, Args...>::type>;
+    size_t size() const { return workers.size(); }
+    // tasks waiting for a worker
+    size_t queued();
     ~ThreadPool();
     void destroy(); 
 private:
     // need to keep track of threads so we can join them
     std::vector< std::thread > workers;
     // the task queue
-    std::queue< std::function<void()> > tasks;
+    std::deque< std::function<void()> > tasks;
+
+    template<class F, class... Args>
+    auto push(bool front, F&& f, Args&&... args)
+        -> std::future<typename std::invoke_result<F, Args...>::type>;
 
     // synchronization
     std::mutex queue_mutex;
@@ -37,8 +52,9 @@ inline ThreadPool::ThreadPool(size_t threads)
 {
     for (size_t i = 0; i < threads; ++i)
         workers.emplace_back(
-            [this]
+            [this, i]
             {
+                TraceRecorder::instance().setThreadName("pool worker " + std::to_string(i));
                 for (;;)
                 {
                     std::function<void()> task;
@@ -50,9 +66,10 @@ inline ThreadPool::ThreadPool(size_t threads)
                         if (this->stop && this->tasks.empty())
                             return;
                         task = std::move(this->tasks.front());
-                        this->tasks.pop();
+                        this->tasks.pop_front();
                     }
 
+                    TRACE_SCOPE("pool task", "pool");
                     task();
                 }
             }
@@ -63,12 +80,29 @@ inline ThreadPool::ThreadPool(size_t threads)
 template<class F, class... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args)
 -> std::future<typename std::invoke_result<F, Args...>::type>
+{
+    return push(false, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+// add new work item to the front of the queue
+template<class F, class... Args>
+auto ThreadPool::enqueuePriority(F&& f, Args&&... args)
+-> std::future<typename std::invoke_result<F, Args...>::type>
+{
+    return push(true, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+auto ThreadPool::push(bool front, F&& f, Args&&... args)
+-> std::future<typename std::invoke_result<F, Args...>::type>
 {
     using return_type = typename std::invoke_result<F, Args...>::type;
 
-    auto task = std::make_shared< std::packaged_task<return_type()> >(
-        std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-    );
+    auto bound = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+    // roughly what the task holds until it runs: the bound call, its shared
+    // state and the queue entry
+    const uint64_t taskBytes = sizeof(bound) + sizeof(std::packaged_task<return_type()>) + sizeof(std::function<void()>);
+    auto task = std::make_shared< std::packaged_task<return_type()> >(std::move(bound));
 
     std::future<return_type> res = task->get_future();
     {
@@ -78,12 +112,26 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
         if (stop)
             throw std::runtime_error("enqueue on stopped ThreadPool");
 
-        tasks.emplace([task]() { (*task)(); });
+        auto run = [task, taskBytes]() {
+            (*task)();
+            MemoryTracker::instance().hostFreed(MemoryTracker::HOST_POOL_TASKS, taskBytes);
+        };
+        if (front)
+            tasks.emplace_front(std::move(run));
+        else
+            tasks.emplace_back(std::move(run));
+        // under the lock, so no worker can free it first
+        MemoryTracker::instance().hostAllocated(MemoryTracker::HOST_POOL_TASKS, taskBytes);
     }
     condition.notify_one();
     return res;
 }
 
+inline size_t ThreadPool::queued() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    return tasks.size();
+}
+
 inline void ThreadPool::destroy() {
     {
         std::unique_lock<std::mutex> lock(queue_mutex);
@@ -0,0 +1,968 @@
+// Micro-benchmarks of the world's hot kernels: noise, createBlock, Chunk
+// block access and meshing, the Chunk map keys, the draw radius walk,
+// ThreadPool::enqueue, voxel raycasts, BlockCursor and region copies, edit
+// batches, body physics, light propagation, flowing water and LOD tiles.
+// Every input comes from a fixed seed or a fixed pattern, so two runs on the
+// same machine measure exactly the same work.
+//
+//   micro_benchmark [--filter text] [--samples N] [--out results.json]
+//                   [--baseline baseline.json] [--threshold percent]
+//
+// Each kernel is timed over --samples samples (default 9) of at least 20 ms
+// and the median is reported in nanoseconds per operation. Save a baseline
+// with --out on a quiet machine, then run with --baseline on the same
+// machine: kernels more than --threshold percent (default 10) slower than
+// the baseline are flagged and the exit code is 1.
+//
+// Built with CMakeLists.txt, next to world_benchmark.
+
+#include "../chunk.h"
+#include "../terrain_util.h"
+#include "../threadpool.h"
+#include "../voxel_raycast.h"
+#include "../block_access.h"
+#include "../edit_batch.h"
+#include "../voxel_collision.h"
+#include "../light_engine.h"
+#include "../water_simulation.h"
+#include "../lod_mesh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// how many random inputs each kernel cycles through
+static constexpr size_t INPUT_COUNT = 4096;
+static constexpr uint32_t SEED = 12345;
+static constexpr double MIN_SAMPLE_SECONDS = 0.02;
+
+// Keeps results alive so the compiler can't drop the work that made them
+static volatile uint64_t sink;
+
+static void consume(uint64_t value) {
+    sink = sink + value;
+}
+
+static void consume(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    consume(static_cast<uint64_t>(bits));
+}
+
+// mt19937's output is fixed by the standard, its distributions aren't, so
+// the inputs are scaled by hand to stay the same on every compiler
+class Inputs {
+public:
+    explicit Inputs(uint32_t seed) : rng(seed) {}
+
+    float real(float min, float max) {
+        return min + (max - min) * static_cast<float>(rng() >> 8) / 16777216.f;
+    }
+    int integer(int min, int max) {
+        return min + static_cast<int>(rng() % static_cast<uint32_t>(max - min + 1));
+    }
+
+private:
+    std::mt19937 rng;
+};
+
+struct Kernel {
+    std::string name;
+    // operations done by one call of run
+    uint64_t operations;
+    std::function<void()> run;
+};
+
+// Median nanoseconds per operation over the samples. Each sample repeats
+// the kernel until it has run for MIN_SAMPLE_SECONDS.
+static double measure(const Kernel& kernel, int samples) {
+    using clock = std::chrono::steady_clock;
+
+    // warm up and find how many calls fill a sample
+    uint64_t calls = 1;
+    for (;;) {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < calls; i++) {
+            kernel.run();
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        if (seconds >= MIN_SAMPLE_SECONDS) {
+            break;
+        }
+        calls = seconds > 0 ? std::max(calls + 1, static_cast<uint64_t>(calls * 1.2 * MIN_SAMPLE_SECONDS / seconds)) : calls * 10;
+    }
+
+    std::vector<double> nsPerOperation;
+    for (int sample = 0; sample < samples; sample++) {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < calls; i++) {
+            kernel.run();
+        }
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        nsPerOperation.push_back(ns / (calls * kernel.operations));
+    }
+    std::sort(nsPerOperation.begin(), nsPerOperation.end());
+    return nsPerOperation[nsPerOperation.size() / 2];
+}
+
+// Fills the columns of a Chunk up to height(x, z): stone, then dirt, then grass
+template <class F>
+static std::unique_ptr<Chunk> columnsChunk(F height) {
+    auto chunk = std::make_unique<Chunk>(0, 0);
+    for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+            int top = height(x, z);
+            for (int y = 0; y < top; y++) {
+                chunk->setBlockAt(x, y, z, y == top - 1 ? GRASS : y >= top - 4 ? DIRT : STONE);
+            }
+        }
+    }
+    return chunk;
+}
+
+// The canonical Chunks meshed by the benchmarks. They sit at the origin, so
+// only the faces on their outer walls see the generated terrain.
+static std::unique_ptr<Chunk> flatChunk() {
+    return columnsChunk([](int, int) { return 112; });
+}
+
+// steep peaks and valleys from 60 to 200 blocks high, many exposed sides
+static std::unique_ptr<Chunk> mountainChunk() {
+    return columnsChunk([](int x, int z) {
+        return 130 + static_cast<int>(70.f * std::sin(x * 0.7f) * std::cos(z * 0.55f));
+    });
+}
+
+// every other block in 3D is stone: the most faces a Chunk can have
+static std::unique_ptr<Chunk> checkerboardChunk() {
+    auto chunk = std::make_unique<Chunk>(0, 0);
+    for (int x = 0; x < 16; x++) {
+        for (int y = 0; y < 256; y++) {
+            for (int z = 0; z < 16; z++) {
+                if ((x + y + z) % 2 == 0) {
+                    chunk->setBlockAt(x, y, z, STONE);
+                }
+            }
+        }
+    }
+    return chunk;
+}
+
+// side x side generated Chunks from the origin, with block(x, y, z) in
+// world space, x-major like the light world
+template <class F>
+static std::vector<Chunk*> builtWorld(std::vector<std::unique_ptr<Chunk>>& chunks, int side, F block) {
+    std::vector<Chunk*> world;
+    for (int x = 0; x < side * 16; x += 16) {
+        for (int z = 0; z < side * 16; z += 16) {
+            chunks.push_back(std::make_unique<Chunk>(x, z));
+            BlockType* blocks = chunks.back()->blockData();
+            for (int lz = 0; lz < 16; lz++) {
+                for (int y = 0; y < 256; y++) {
+                    for (int lx = 0; lx < 16; lx++) {
+                        blocks[Chunk::blockIndex(lx, y, lz)] = block(x + lx, y, z + lz);
+                    }
+                }
+            }
+            chunks.back()->updateOccupancy(0xFFFF);
+            chunks.back()->markGenerated();
+            world.push_back(chunks.back().get());
+        }
+    }
+    return world;
+}
+
+// Ticks the water until nothing is active, writing each tick's edits like
+// Terrain::tickWater, less the remeshing. Returns the cells updated.
+static uint64_t settleWater(WaterSimulation& water, const ChunkLookup& lookup) {
+    uint64_t updated = 0;
+    EditBatch edits;
+    do {
+        edits.clear();
+        updated += water.tick(lookup, edits);
+        edits.apply(lookup, [](const glm::ivec3&, const glm::ivec3&) {});
+    } while (water.stats().activeCells > 0);
+    return updated;
+}
+
+// The vkCmdDrawIndexed calls Terrain::drawZone issues for a Chunk with every
+// section visible: one per run of neighbouring non-empty sections
+static uint64_t sectionDraws(const Chunk& chunk) {
+    uint64_t draws = 0;
+    uint32_t runFirst = 0, runCount = 0;
+    for (const ChunkSection& section : chunk.sections) {
+        if (section.indexCount == 0) {
+            continue;
+        }
+        if (runCount > 0 && runFirst + runCount != section.firstIndex) {
+            draws++;
+            runCount = 0;
+        }
+        if (runCount == 0) {
+            runFirst = section.firstIndex;
+        }
+        runCount += section.indexCount;
+    }
+    return draws + (runCount > 0);
+}
+
+// Fills the box like Terrain::applyEdits, waking the water around it
+static void editWater(WaterSimulation& water, const ChunkLookup& lookup, const glm::ivec3& min, const glm::ivec3& max, BlockType type) {
+    EditBatch edit;
+    edit.fill(min, max, type);
+    edit.apply(lookup, [&water](const glm::ivec3& lo, const glm::ivec3& hi) { water.blocksChanged(lo, hi); });
+}
+
+static std::vector<Kernel> makeKernels(std::vector<std::unique_ptr<Chunk>>& chunks, ThreadPool& pool) {
+    Inputs inputs(SEED);
+    std::vector<glm::vec3> points(INPUT_COUNT);
+    for (glm::vec3& p : points) {
+        p = glm::vec3(inputs.real(-1000.f, 1000.f), inputs.real(0.f, 256.f), inputs.real(-1000.f, 1000.f));
+    }
+    std::vector<glm::ivec3> blocks(INPUT_COUNT);
+    for (glm::ivec3& b : blocks) {
+        b = glm::ivec3(inputs.integer(-4096, 4096), inputs.integer(0, 255), inputs.integer(-4096, 4096));
+    }
+    std::vector<glm::ivec3> local(INPUT_COUNT);
+    for (glm::ivec3& l : local) {
+        l = glm::ivec3(inputs.integer(0, 15), inputs.integer(0, 255), inputs.integer(0, 15));
+    }
+
+    // the generated Chunk block access runs on
+    chunks.push_back(std::make_unique<Chunk>(0, 0));
+    generateChunkBlocks(*chunks.back());
+    Chunk* terrainChunk = chunks.back().get();
+
+    std::vector<Kernel> kernels;
+    // the same settings as terrainHeight
+    static const SimplexNoise fbm(0.01f);
+
+    kernels.push_back({ "noise_1d", INPUT_COUNT, [points]() {
+        float sum = 0.f;
+        for (const glm::vec3& p : points) sum += SimplexNoise::noise(p.x);
+        consume(sum);
+    } });
+    kernels.push_back({ "noise_2d", INPUT_COUNT, [points]() {
+        float sum = 0.f;
+        for (const glm::vec3& p : points) sum += SimplexNoise::noise(p.x, p.z);
+        consume(sum);
+    } });
+    kernels.push_back({ "noise_3d", INPUT_COUNT, [points]() {
+        float sum = 0.f;
+        for (const glm::vec3& p : points) sum += SimplexNoise::noise(p.x, p.y, p.z);
+        consume(sum);
+    } });
+    kernels.push_back({ "fractal_1d_3oct", INPUT_COUNT, [points]() {
+        float sum = 0.f;
+        for (const glm::vec3& p : points) sum += fbm.fractal(3, p.x);
+        consume(sum);
+    } });
+    kernels.push_back({ "fractal_2d_3oct", INPUT_COUNT, [points]() {
+        float sum = 0.f;
+        for (const glm::vec3& p : points) sum += fbm.fractal(3, p.x, p.z);
+        consume(sum);
+    } });
+    kernels.push_back({ "fractal_3d_3oct", INPUT_COUNT, [points]() {
+        float sum = 0.f;
+        for (const glm::vec3& p : points) sum += fbm.fractal(3, p.x, p.y, p.z);
+        consume(sum);
+    } });
+    kernels.push_back({ "create_block", INPUT_COUNT, [blocks]() {
+        uint64_t sum = 0;
+        for (const glm::ivec3& b : blocks) sum += createBlock(b.x, b.y, b.z);
+        consume(sum);
+    } });
+    kernels.push_back({ "chunk_get_block", INPUT_COUNT, [local, terrainChunk]() {
+        uint64_t sum = 0;
+        for (const glm::ivec3& l : local) sum += terrainChunk->getBlockAt(l.x, l.y, l.z);
+        consume(sum);
+    } });
+    kernels.push_back({ "chunk_set_block", INPUT_COUNT, [local, terrainChunk]() {
+        for (const glm::ivec3& l : local) {
+            // writes back what is there, so the Chunk stays the same between calls
+            terrainChunk->setBlockAt(l.x, l.y, l.z, terrainChunk->getBlockAt(l.x, l.y, l.z));
+        }
+    } });
+    kernels.push_back({ "to_key_to_coords", INPUT_COUNT, [blocks]() {
+        uint64_t sum = 0;
+        for (const glm::ivec3& b : blocks) {
+            glm::ivec2 coords = toCoords(toKey(b.x, b.z));
+            sum += static_cast<uint64_t>(coords.x ^ coords.y);
+        }
+        consume(sum);
+    } });
+
+    auto meshKernel = [&chunks, &kernels](const std::string& name, std::unique_ptr<Chunk> chunk) {
+        Chunk* c = chunk.get();
+        chunks.push_back(std::move(chunk));
+        kernels.push_back({ name, 1, [c]() {
+            c->createVertexData();
+            consume(static_cast<uint64_t>(c->vertices().size()));
+            c->releaseMeshData();
+        } });
+    };
+    meshKernel("mesh_flat_chunk", flatChunk());
+    meshKernel("mesh_mountain_chunk", mountainChunk());
+    meshKernel("mesh_checkerboard_chunk", checkerboardChunk());
+
+    // what a block edit costs on the worker: the section at the surface
+    // meshed again, then every section stitched back into one mesh
+    {
+        chunks.push_back(mountainChunk());
+        const Chunk* c = chunks.back().get();
+        auto meshes = std::make_shared<SectionMeshes>();
+        for (int section = 0; section < SECTION_COUNT; section++) {
+            Chunk::meshSection(c->blockData(), c->light, c->getOrigin(), section, nullptr, (*meshes)[section]);
+        }
+        kernels.push_back({ "remesh_one_section", 1, [c, meshes]() {
+            Chunk::meshSection(c->blockData(), c->light, c->getOrigin(), 6, nullptr, (*meshes)[6]);
+            consume(static_cast<uint64_t>(ChunkMesh::assemble(*meshes).indices.size()));
+        } });
+    }
+
+    // One frame's walk over the Chunks in the draw radius, counting the draws
+    // drawZone issues. Before the flat draw list, every Chunk slot of every
+    // zone was a getChunkAt: a lock, a floor and a lookup in the map of the
+    // whole create radius. Now it is a walk over Terrain::drawList. Every
+    // Chunk of the create radius (7 x 7 zones) is meshed, and nothing else
+    // takes the lock, so the map walk's times are a lower bound.
+    {
+        static constexpr int DRAW_ZONE = 64, CREATE_MULTIPLIER = 3;
+        static std::unordered_map<int64_t, Chunk*> resident;
+        static std::mutex residentMutex;
+        for (int z = -DRAW_ZONE * CREATE_MULTIPLIER; z < DRAW_ZONE * (CREATE_MULTIPLIER + 1); z += 16) {
+            for (int x = -DRAW_ZONE * CREATE_MULTIPLIER; x < DRAW_ZONE * (CREATE_MULTIPLIER + 1); x += 16) {
+                chunks.push_back(std::make_unique<Chunk>(x, z));
+                generateChunkBlocks(*chunks.back());
+                chunks.back()->createVertexData();
+                chunks.back()->releaseMeshData();
+                resident[toKey(x, z)] = chunks.back().get();
+            }
+        }
+        auto getChunkAt = [](int x, int z) -> Chunk* {
+            int xFloor = static_cast<int>(std::floor(x / 16.f));
+            int zFloor = static_cast<int>(std::floor(z / 16.f));
+            std::lock_guard<std::mutex> lock{ residentMutex };
+            return resident[toKey(16 * xFloor, 16 * zFloor)];
+        };
+        for (int multiplier = 1; multiplier <= CREATE_MULTIPLIER; multiplier++) {
+            int radius = DRAW_ZONE * multiplier;
+            // zones row by row, each zone's Chunks z-major, like the draw list
+            std::vector<const Chunk*> drawList;
+            for (int zz = -radius; zz <= radius; zz += DRAW_ZONE) {
+                for (int xx = -radius; xx <= radius; xx += DRAW_ZONE) {
+                    for (int i = 0; i < 16; i++) {
+                        drawList.push_back(resident[toKey(xx + (i % 4) * 16, zz + (i / 4) * 16)]);
+                    }
+                }
+            }
+            std::string suffix = "_radius_" + std::to_string(multiplier);
+            kernels.push_back({ "draw_walk_chunk_map" + suffix, drawList.size(), [radius, getChunkAt]() {
+                // the zone list was built again every frame too
+                std::vector<glm::ivec2> zones;
+                for (int zz = -radius; zz <= radius; zz += DRAW_ZONE) {
+                    for (int xx = -radius; xx <= radius; xx += DRAW_ZONE) {
+                        zones.push_back(glm::ivec2(xx, zz));
+                    }
+                }
+                uint64_t draws = 0;
+                for (const glm::ivec2& zone : zones) {
+                    for (int z = zone.y; z < zone.y + DRAW_ZONE; z += 16) {
+                        for (int x = zone.x; x < zone.x + DRAW_ZONE; x += 16) {
+                            const Chunk* chunk = getChunkAt(x, z);
+                            if (chunk) {
+                                draws += sectionDraws(*chunk);
+                            }
+                        }
+                    }
+                }
+                consume(draws);
+            } });
+            kernels.push_back({ "draw_walk_draw_list" + suffix, drawList.size(), [drawList]() {
+                uint64_t draws = 0;
+                for (const Chunk* chunk : drawList) {
+                    if (chunk) {
+                        draws += sectionDraws(*chunk);
+                    }
+                }
+                consume(draws);
+            } });
+        }
+    }
+
+    // empty tasks, so this is the cost of the queue, its lock and the future
+    static constexpr int POOL_TASKS = 1024;
+    kernels.push_back({ "threadpool_enqueue", POOL_TASKS, [&pool]() {
+        std::vector<std::future<void>> futures;
+        futures.reserve(POOL_TASKS);
+        for (int i = 0; i < POOL_TASKS; i++) {
+            futures.push_back(pool.enqueue([]() {}));
+        }
+        for (std::future<void>& future : futures) {
+            future.get();
+        }
+    } });
+
+    // Raycasts through a generated world of 16 x 16 Chunks, looked up in a
+    // map keyed by toKey like Terrain's. Rays start near its middle.
+    static constexpr int WORLD_CHUNKS = 16;
+    static std::unordered_map<int64_t, Chunk*> world;
+    for (int x = 0; x < WORLD_CHUNKS * 16; x += 16) {
+        for (int z = 0; z < WORLD_CHUNKS * 16; z += 16) {
+            chunks.push_back(std::make_unique<Chunk>(x, z));
+            generateChunkBlocks(*chunks.back());
+            world[toKey(x, z)] = chunks.back().get();
+        }
+    }
+    auto lookup = [](int x, int z) -> Chunk* {
+        auto it = world.find(toKey(x, z));
+        return it != world.end() ? it->second : nullptr;
+    };
+    const float middle = WORLD_CHUNKS * 8.f;
+
+    // level rays above the hills, which never hit, so every one walks its
+    // whole length: the cost per block stepped through
+    auto openRays = [&inputs, middle](float length) {
+        std::vector<Ray> rays(INPUT_COUNT);
+        for (Ray& ray : rays) {
+            ray.origin = glm::vec3(middle + inputs.real(-8.f, 8.f), inputs.real(130.f, 200.f), middle + inputs.real(-8.f, 8.f));
+            ray.direction = glm::vec3(inputs.real(-1.f, 1.f), inputs.real(-0.05f, 0.05f), inputs.real(-1.f, 1.f));
+            ray.maxDistance = length;
+        }
+        return rays;
+    };
+    for (float length : { 8.f, 32.f, 96.f }) {
+        std::string name = "raycast_open_" + std::to_string(static_cast<int>(length));
+        // one raycaster per ray, like Terrain::raycast
+        kernels.push_back({ name, INPUT_COUNT, [rays = openRays(length), lookup]() {
+            uint64_t steps = 0;
+            for (const Ray& ray : rays) {
+                VoxelRaycaster raycaster(lookup);
+                steps += static_cast<uint64_t>(raycaster.cast(ray).distance);
+            }
+            consume(steps);
+        } });
+        // the whole set through one raycaster, like Terrain::raycastBatch
+        kernels.push_back({ name + "_batch", INPUT_COUNT, [rays = openRays(length), lookup]() {
+            static std::vector<RayHit> hits;
+            VoxelRaycaster raycaster(lookup);
+            raycaster.castBatch(rays, hits);
+            consume(static_cast<uint64_t>(hits.back().distance));
+        } });
+    }
+
+    // block picking: short rays from head height pointing at the ground
+    std::vector<Ray> pickRays(INPUT_COUNT);
+    for (Ray& ray : pickRays) {
+        float x = middle + inputs.real(-64.f, 64.f), z = middle + inputs.real(-64.f, 64.f);
+        ray.origin = glm::vec3(x, terrainHeight(static_cast<int>(x), static_cast<int>(z)) + 1.6f, z);
+        ray.direction = glm::vec3(inputs.real(-1.f, 1.f), inputs.real(-1.f, -0.2f), inputs.real(-1.f, 1.f));
+        ray.maxDistance = 8.f;
+    }
+    kernels.push_back({ "raycast_pick", INPUT_COUNT, [pickRays, lookup]() {
+        uint64_t hits = 0;
+        for (const Ray& ray : pickRays) {
+            VoxelRaycaster raycaster(lookup);
+            hits += raycaster.cast(ray).hit;
+        }
+        consume(hits);
+    } });
+
+    // a random walk, one block per step, as a flood fill or light
+    // propagation would take
+    std::vector<Direction> walk(INPUT_COUNT);
+    for (Direction& direction : walk) {
+        direction = static_cast<Direction>(inputs.integer(0, 5));
+    }
+    kernels.push_back({ "cursor_step", INPUT_COUNT, [walk, lookup, middle]() {
+        BlockCursor cursor(lookup, glm::ivec3(middle, 110, middle));
+        uint64_t solid = 0;
+        for (Direction direction : walk) {
+            cursor.step(direction);
+            solid += isOpaque(cursor.get());
+        }
+        consume(solid);
+    } });
+    // a 32 x 32 x 32 box straddling four Chunks, per block copied
+    static constexpr int REGION = 32;
+    kernels.push_back({ "read_region_32", REGION * REGION * REGION, [lookup, middle]() {
+        static std::vector<BlockType> blocks(REGION * REGION * REGION);
+        glm::ivec3 min(middle - REGION / 2, 96, middle - REGION / 2);
+        consume(static_cast<uint64_t>(readRegion(lookup, min, min + REGION - 1, blocks.data())));
+    } });
+
+    // Player-sized bodies stepping one 60 Hz tick through the raycast world,
+    // all through one CollisionWorld like Terrain::stepBodies, per body.
+    // Each run starts them from the same place.
+    static constexpr size_t BODY_COUNT = 1024;
+    static constexpr float BODY_DT = 1.f / 60.f;
+    // walking on the ground in all directions, the common case for mobs
+    std::vector<PhysicsBody> walkers(BODY_COUNT);
+    std::vector<BodyControl> walkControls(BODY_COUNT);
+    for (size_t i = 0; i < BODY_COUNT; i++) {
+        float x = middle + inputs.real(-96.f, 96.f), z = middle + inputs.real(-96.f, 96.f);
+        walkers[i].position = glm::vec3(x, terrainHeight(static_cast<int>(x), static_cast<int>(z)) + 1.f, z);
+        walkers[i].flying = false;
+        walkControls[i].moveVelocity = glm::vec3(inputs.real(-4.3f, 4.3f), 0.f, inputs.real(-4.3f, 4.3f));
+        walkControls[i].jump = inputs.integer(0, 7) == 0;
+    }
+    kernels.push_back({ "body_step_walk", BODY_COUNT, [walkers, walkControls, lookup]() {
+        static std::vector<PhysicsBody> bodies;
+        bodies = walkers;
+        CollisionWorld collision(lookup);
+        for (size_t i = 0; i < bodies.size(); i++) {
+            stepBody(collision, bodies[i], walkControls[i], BODY_DT);
+        }
+        consume(bodies.back().position.y);
+    } });
+    // flying at 300 blocks per second, 5 blocks a tick, into the hills and
+    // through the air above them: the most layers swept per step
+    std::vector<PhysicsBody> flyers(BODY_COUNT);
+    std::vector<BodyControl> flyControls(BODY_COUNT);
+    for (size_t i = 0; i < BODY_COUNT; i++) {
+        flyers[i].position = glm::vec3(middle + inputs.real(-96.f, 96.f), inputs.real(120.f, 180.f), middle + inputs.real(-96.f, 96.f));
+        glm::vec3 direction(inputs.real(-1.f, 1.f), inputs.real(-1.f, 1.f), inputs.real(-1.f, 1.f));
+        flyControls[i].moveVelocity = glm::normalize(direction) * 300.f;
+    }
+    kernels.push_back({ "body_step_fast_fly", BODY_COUNT, [flyers, flyControls, lookup]() {
+        static std::vector<PhysicsBody> bodies;
+        bodies = flyers;
+        CollisionWorld collision(lookup);
+        for (size_t i = 0; i < bodies.size(); i++) {
+            stepBody(collision, bodies[i], flyControls[i], BODY_DT);
+        }
+        consume(bodies.back().position.y);
+    } });
+    // the query under both: is anything solid in a player-sized box
+    std::vector<glm::ivec3> boxCorners(INPUT_COUNT);
+    for (glm::ivec3& corner : boxCorners) {
+        float x = middle + inputs.real(-96.f, 96.f), z = middle + inputs.real(-96.f, 96.f);
+        corner = glm::ivec3(x, terrainHeight(static_cast<int>(x), static_cast<int>(z)) + inputs.integer(-2, 2), z);
+    }
+    kernels.push_back({ "collision_any_solid", INPUT_COUNT, [boxCorners, lookup]() {
+        CollisionWorld collision(lookup);
+        uint64_t solid = 0;
+        for (const glm::ivec3& corner : boxCorners) {
+            solid += collision.anySolid(corner, corner + glm::ivec3(1, 2, 1));
+        }
+        consume(solid);
+    } });
+
+    // A 64 x 64 x 64 sphere carved out of a generated world of 6 x 6 Chunks,
+    // per block carved. Each way pays what Terrain would: the Chunk map lock
+    // and lookup, and marking sections dirty the way Terrain::markEdited does.
+    static constexpr int CARVE_CHUNKS = 6;
+    static constexpr int CARVE_RADIUS = 32;
+    static std::unordered_map<int64_t, Chunk*> carveWorld;
+    for (int x = 0; x < CARVE_CHUNKS * 16; x += 16) {
+        for (int z = 0; z < CARVE_CHUNKS * 16; z += 16) {
+            chunks.push_back(std::make_unique<Chunk>(x, z));
+            generateChunkBlocks(*chunks.back());
+            carveWorld[toKey(x, z)] = chunks.back().get();
+        }
+    }
+    static std::mutex carveMutex;
+    auto carveLookup = [](int x, int z) -> Chunk* {
+        std::lock_guard<std::mutex> lock(carveMutex);
+        auto it = carveWorld.find(toKey(x, z));
+        return it != carveWorld.end() ? it->second : nullptr;
+    };
+    static std::unordered_map<int64_t, uint16_t> carveDirty;
+    auto markDirty = [](const glm::ivec3& min, const glm::ivec3& max) {
+        glm::ivec3 lo = min - 1, hi = max + 1;
+        int first = std::max(lo.y, 0) / SECTION_SIZE, last = std::min(hi.y, 255) / SECTION_SIZE;
+        uint16_t sections = static_cast<uint16_t>(((1u << (last + 1)) - 1) & ~((1u << first) - 1));
+        std::lock_guard<std::mutex> lock(carveMutex);
+        for (int z = lo.z & ~15; z <= hi.z; z += 16) {
+            for (int x = lo.x & ~15; x <= hi.x; x += 16) {
+                carveDirty[toKey(x, z)] |= sections;
+            }
+        }
+    };
+    // x fastest, like the blocks in a Chunk
+    const glm::ivec3 centre(CARVE_CHUNKS * 8, 100, CARVE_CHUNKS * 8);
+    std::vector<glm::ivec3> sphere;
+    // the sphere's rows along x, as (first block, length)
+    std::vector<std::pair<glm::ivec3, int>> sphereRows;
+    for (int z = -CARVE_RADIUS; z < CARVE_RADIUS; z++) {
+        for (int y = -CARVE_RADIUS; y < CARVE_RADIUS; y++) {
+            int rowStart = static_cast<int>(sphere.size());
+            for (int x = -CARVE_RADIUS; x < CARVE_RADIUS; x++) {
+                // block centres inside the sphere
+                glm::vec3 offset = glm::vec3(x, y, z) + 0.5f;
+                if (glm::dot(offset, offset) <= CARVE_RADIUS * CARVE_RADIUS) {
+                    sphere.push_back(centre + glm::ivec3(x, y, z));
+                }
+            }
+            int length = static_cast<int>(sphere.size()) - rowStart;
+            if (length > 0) {
+                sphereRows.push_back({ sphere[rowStart], length });
+            }
+        }
+    }
+    const size_t carved = sphere.size();
+    kernels.push_back({ "sphere_carve_64_set_block", carved, [sphere, carveLookup, markDirty]() {
+        carveDirty.clear();
+        for (const glm::ivec3& p : sphere) {
+            Chunk* chunk = carveLookup(p.x & ~15, p.z & ~15);
+            chunk->setBlockAt(p.x & 15, p.y, p.z & 15, EMPTY);
+            markDirty(p, p);
+        }
+        consume(static_cast<uint64_t>(carveDirty.size()));
+    } });
+    kernels.push_back({ "sphere_carve_64_batch", carved, [sphere, carveLookup, markDirty]() {
+        carveDirty.clear();
+        EditBatch batch;
+        for (const glm::ivec3& p : sphere) {
+            batch.set(p, EMPTY);
+        }
+        consume(static_cast<uint64_t>(batch.apply(carveLookup, markDirty)));
+    } });
+    kernels.push_back({ "sphere_carve_64_batch_rows", carved, [sphereRows, carveLookup, markDirty]() {
+        carveDirty.clear();
+        EditBatch batch;
+        for (const auto& [first, length] : sphereRows) {
+            batch.fill(first, first + glm::ivec3(length - 1, 0, 0), EMPTY);
+        }
+        consume(static_cast<uint64_t>(batch.apply(carveLookup, markDirty)));
+    } });
+
+    // Light for a generated world of 8 x 8 Chunks, from scratch, per Chunk:
+    // each one's initial pass on the pool, like Terrain's generation
+    // workers, and the messages between them until they settle
+    static constexpr int LIGHT_CHUNKS = 8;
+    std::vector<Chunk*> lightChunks;
+    for (int x = 0; x < LIGHT_CHUNKS * 16; x += 16) {
+        for (int z = 0; z < LIGHT_CHUNKS * 16; z += 16) {
+            chunks.push_back(std::make_unique<Chunk>(x, z));
+            generateChunkBlocks(*chunks.back());
+            lightChunks.push_back(chunks.back().get());
+        }
+    }
+    kernels.push_back({ "light_world_per_chunk", lightChunks.size(), [lightChunks, &pool]() {
+        LightEngine engine(pool);
+        std::vector<std::future<void>> futures;
+        for (Chunk* chunk : lightChunks) {
+            for (int section = 0; section < SECTION_COUNT; section++) {
+                chunk->light.fillSection(section, 0);
+            }
+            futures.push_back(pool.enqueue([&engine, chunk]() { engine.addChunk(*chunk); }));
+        }
+        for (std::future<void>& future : futures) {
+            future.get();
+        }
+        engine.waitIdle();
+        consume(engine.stats().messages);
+    } });
+
+    // The latency of one edit's light, from blocksChanged until every Chunk
+    // it reaches has settled: a glowstone placed in the air on a Chunk
+    // corner and taken away again, and a surface block broken and put back
+    // so the sky falls into the hole and is taken away again
+    auto editEngine = std::make_shared<LightEngine>(pool);
+    for (Chunk* chunk : lightChunks) {
+        editEngine->addChunk(*chunk);
+    }
+    editEngine->waitIdle();
+    auto lightLookup = [lightChunks](int x, int z) -> Chunk* {
+        return lightChunks[(x / 16) * LIGHT_CHUNKS + z / 16];
+    };
+    const int corner = LIGHT_CHUNKS * 8;
+    const glm::ivec3 glow(corner, terrainHeight(corner, corner) + 3, corner);
+    const glm::ivec3 surface(corner + 5, terrainHeight(corner + 5, corner + 5) - 1, corner + 5);
+    auto edit = [editEngine, lightLookup](const glm::ivec3& p, BlockType type) {
+        lightLookup(p.x, p.z)->setBlockAt(p.x & 15, p.y, p.z & 15, type);
+        editEngine->blocksChanged(p, p);
+        editEngine->waitIdle();
+    };
+    kernels.push_back({ "light_edit_glowstone", 2, [edit, glow]() {
+        edit(glow, GLOWSTONE);
+        edit(glow, EMPTY);
+    } });
+    kernels.push_back({ "light_edit_surface_block", 2, [edit, surface, lightLookup]() {
+        BlockType before = lightLookup(surface.x, surface.z)->getBlockAt(surface.x & 15, surface.y, surface.z & 15);
+        edit(surface, EMPTY);
+        edit(surface, before);
+    } });
+
+    // Flowing water. A lake of sources 8 deep on a stone floor, walled in
+    // at the world's edges, over 4 x 4 and 16 x 16 Chunks: a 4 x 4 hole dug
+    // in the floor under the middle of the lake fills and is filled in
+    // again. Only the cells around the hole are ever active, so both lakes
+    // should cost the same, and a tick with nothing active costs nothing.
+    static constexpr int LAKE_FLOOR = 100;
+    for (int side : { 4, 16 }) {
+        std::vector<Chunk*> lake = builtWorld(chunks, side, [side](int x, int y, int z) {
+            bool wall = x == 0 || z == 0 || x == side * 16 - 1 || z == side * 16 - 1;
+            return y < LAKE_FLOOR ? STONE : y < LAKE_FLOOR + 8 ? (wall ? STONE : WATER) : EMPTY;
+        });
+        ChunkLookup lookup = [lake, side](int x, int z) -> Chunk* {
+            bool inside = x >= 0 && z >= 0 && x < side * 16 && z < side * 16;
+            return inside ? lake[(x / 16) * side + z / 16] : nullptr;
+        };
+        auto water = std::make_shared<WaterSimulation>(pool);
+        const glm::ivec3 hole(side * 8 - 2, LAKE_FLOOR - 3, side * 8 - 2);
+        std::string name = "water_lake_hole_" + std::to_string(side) + "x" + std::to_string(side);
+        kernels.push_back({ name, 1, [water, lookup, hole]() {
+            editWater(*water, lookup, hole, hole + glm::ivec3(3, 2, 3), EMPTY);
+            consume(settleWater(*water, lookup));
+            editWater(*water, lookup, hole, hole + glm::ivec3(3, 2, 3), STONE);
+            consume(settleWater(*water, lookup));
+        } });
+        if (side == 16) {
+            kernels.push_back({ "water_tick_idle_16x16", 1, [water, lookup]() {
+                EditBatch edits;
+                consume(static_cast<uint64_t>(water->tick(lookup, edits)));
+            } });
+        }
+    }
+
+    // A flowing block dug out has to fill again: a source on a floor
+    // spreads, one of its flowing blocks is carved out and the flow settles.
+    // Checked once up front, so a run fails instead of timing a dry hole.
+    std::vector<Chunk*> pond = builtWorld(chunks, 2, [](int x, int y, int z) {
+        return y < LAKE_FLOOR ? STONE : y == LAKE_FLOOR && x == 8 && z == 8 ? WATER : EMPTY;
+    });
+    ChunkLookup pondLookup = [pond](int x, int z) -> Chunk* {
+        return x >= 0 && z >= 0 && x < 32 && z < 32 ? pond[(x / 16) * 2 + z / 16] : nullptr;
+    };
+    auto pondWater = std::make_shared<WaterSimulation>(pool);
+    pondWater->blocksChanged(glm::ivec3(8, LAKE_FLOOR, 8), glm::ivec3(8, LAKE_FLOOR, 8));
+    settleWater(*pondWater, pondLookup);
+    const glm::ivec3 dug(10, LAKE_FLOOR, 8);
+    auto refill = [pondWater, pondLookup, dug]() {
+        editWater(*pondWater, pondLookup, dug, dug, EMPTY);
+        uint64_t updated = settleWater(*pondWater, pondLookup);
+        if (pondLookup(0, 0)->getBlockAt(dug.x, dug.y, dug.z) != WATER) {
+            throw std::runtime_error("water_refill_flowing_cell: the carved block stayed dry!");
+        }
+        return updated;
+    };
+    refill();
+    kernels.push_back({ "water_refill_flowing_cell", 1, [refill]() {
+        consume(refill());
+    } });
+
+    // A dam break, per cell updated: a reservoir 12 deep on a plateau over
+    // 8 x 8 Chunks loses its walls, pours over the edges onto the plain 10
+    // blocks below and spreads, then the walls are put back and the spill
+    // dries up. More cells wake than the default budget takes in a tick.
+    static constexpr int DAM_CHUNKS = 8;
+    std::vector<Chunk*> dam = builtWorld(chunks, DAM_CHUNKS, [](int x, int y, int z) {
+        bool reservoir = x >= 16 && x < 48 && z >= 16 && z < 48;
+        bool wall = x >= 15 && x <= 48 && z >= 15 && z <= 48 && !reservoir;
+        if (y < 90) {
+            return STONE;
+        }
+        if (reservoir) {
+            return y < LAKE_FLOOR ? STONE : y < LAKE_FLOOR + 12 ? WATER : EMPTY;
+        }
+        return wall && y < LAKE_FLOOR + 14 ? STONE : EMPTY;
+    });
+    ChunkLookup damLookup = [dam](int x, int z) -> Chunk* {
+        bool inside = x >= 0 && z >= 0 && x < DAM_CHUNKS * 16 && z < DAM_CHUNKS * 16;
+        return inside ? dam[(x / 16) * DAM_CHUNKS + z / 16] : nullptr;
+    };
+    // the walls above the plateau, one side each
+    const std::vector<std::pair<glm::ivec3, glm::ivec3>> walls = {
+        { { 15, LAKE_FLOOR, 15 }, { 15, LAKE_FLOOR + 13, 48 } }, { { 48, LAKE_FLOOR, 15 }, { 48, LAKE_FLOOR + 13, 48 } },
+        { { 16, LAKE_FLOOR, 15 }, { 47, LAKE_FLOOR + 13, 15 } }, { { 16, LAKE_FLOOR, 48 }, { 47, LAKE_FLOOR + 13, 48 } },
+    };
+    auto damBreak = [damLookup, &pool, walls]() {
+        WaterSimulation water(pool);
+        for (const auto& [min, max] : walls) {
+            editWater(water, damLookup, min, max, EMPTY);
+        }
+        uint64_t updated = settleWater(water, damLookup);
+        for (const auto& [min, max] : walls) {
+            editWater(water, damLookup, min, max, STONE);
+        }
+        return updated + settleWater(water, damLookup);
+    };
+    // the same cells every time, so count them once
+    const uint64_t damCells = damBreak();
+    kernels.push_back({ "water_dam_break_per_cell", damCells, [damBreak]() {
+        consume(damBreak());
+    } });
+
+    // LOD tiles at the default draw radius of 2: picking them around the
+    // 5 x 5 zone voxel area, and meshing one tile of each size
+    {
+        const glm::ivec2 detailMin(-128), detailMax(192);
+        std::vector<LodTileRect> selected;
+        selectLodTiles(detailMin, detailMax, selected);
+        kernels.push_back({ "lod_select_radius_2", 1, [detailMin, detailMax]() {
+            static std::vector<LodTileRect> rects;
+            selectLodTiles(detailMin, detailMax, rects);
+            consume(static_cast<uint64_t>(rects.size()));
+        } });
+        for (int size : { 64, 128, 256, 512 }) {
+            auto tile = std::find_if(selected.begin(), selected.end(), [size](const LodTileRect& rect) { return rect.size == size; });
+            if (tile == selected.end()) {
+                continue;
+            }
+            kernels.push_back({ "lod_mesh_tile_" + std::to_string(size), 1, [rect = *tile]() {
+                std::vector<Vertex> vertices;
+                std::vector<uint16_t> indices;
+                buildLodMesh(rect, vertices, indices);
+                consume(static_cast<uint64_t>(indices.size()));
+            } });
+        }
+    }
+
+    return kernels;
+}
+
+// Reads the "name": value pairs of a results file written by --out
+static std::map<std::string, double> readResults(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open baseline " + path + "!");
+    }
+    std::map<std::string, double> results;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t open = line.find('"');
+        size_t close = line.find('"', open + 1);
+        size_t colon = line.find(':', close);
+        if (open == std::string::npos || close == std::string::npos || colon == std::string::npos) {
+            continue;
+        }
+        const char* valueStart = line.c_str() + colon + 1;
+        char* valueEnd;
+        double value = std::strtod(valueStart, &valueEnd);
+        if (valueEnd != valueStart) {
+            results[line.substr(open + 1, close - open - 1)] = value;
+        }
+    }
+    return results;
+}
+
+static void usage() {
+    std::cerr << "usage: micro_benchmark [--filter text] [--samples N] [--out results.json]\n"
+        << "                       [--baseline baseline.json] [--threshold percent]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string filter, outPath, baselinePath;
+    int samples = 9;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--filter") {
+            filter = argv[++i];
+        }
+        else if (i + 1 < argc && arg == "--samples") {
+            samples = std::atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && arg == "--out") {
+            outPath = argv[++i];
+        }
+        else if (i + 1 < argc && arg == "--baseline") {
+            baselinePath = argv[++i];
+        }
+        else if (i + 1 < argc && arg == "--threshold") {
+            threshold = std::atof(argv[++i]);
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (samples <= 0 || threshold < 0) {
+        usage();
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselinePath.empty()) {
+        try {
+            baseline = readResults(baselinePath);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    ThreadPool pool(4);
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<Kernel> kernels;
+    try {
+        kernels = makeKernels(chunks, pool);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        pool.destroy();
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, double>> results;
+    int regressions = 0;
+    std::cout << std::left << std::setw(26) << "kernel" << std::right << std::setw(14) << "ns/op";
+    if (!baseline.empty()) {
+        std::cout << std::setw(14) << "baseline" << std::setw(10) << "change";
+    }
+    std::cout << "\n";
+
+    for (const Kernel& kernel : kernels) {
+        if (kernel.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        double ns = measure(kernel, samples);
+        results.emplace_back(kernel.name, ns);
+
+        std::cout << std::left << std::setw(26) << kernel.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(14) << ns;
+        auto base = baseline.find(kernel.name + "_ns");
+        if (base != baseline.end() && base->second > 0) {
+            double change = (ns - base->second) / base->second * 100.0;
+            std::cout << std::setw(14) << base->second << std::setw(9) << std::showpos << change << "%" << std::noshowpos;
+            if (change > threshold) {
+                std::cout << "  REGRESSED";
+                regressions++;
+            }
+        }
+        else if (!baseline.empty()) {
+            std::cout << std::setw(14) << "-" << std::setw(10) << "new";
+        }
+        std::cout << std::endl;
+    }
+    pool.destroy();
+
+    if (!outPath.empty()) {
+        std::ofstream out(outPath);
+        if (!out.is_open()) {
+            std::cerr << "failed to open " << outPath << std::endl;
+            return 1;
+        }
+        out << std::fixed << std::setprecision(3) << "{\n  \"benchmark\": \"micro\",\n  \"samples\": " << samples;
+        for (const auto& [name, ns] : results) {
+            out << ",\n  \"" << name << "_ns\": " << ns;
+        }
+        out << "\n}\n";
+    }
+
+    if (!baseline.empty()) {
+        std::cout << regressions << " of " << results.size() << " kernels more than " << std::defaultfloat
+            << threshold << "% slower than " << baselinePath << std::endl;
+    }
+    return regressions > 0 ? 1 : 0;
+}
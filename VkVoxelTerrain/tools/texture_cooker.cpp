@@ -0,0 +1,500 @@
+// Offline texture cooker: decodes a PNG, builds the whole mip chain on the
+// CPU, optionally block-compresses every level, and writes a .vtex container
+// (see texture_container.h) that the renderer memory-maps at startup.
+//
+//   texture_cooker [--format rgba8|bc1|bc7] [--linear] input.png output.vtex
+//
+// Colour textures are filtered in linear space and stored as sRGB, like the
+// blits the renderer uses when it generates mips from the PNG itself. Pass
+// --linear for data textures such as normal maps.
+//
+// It is a standalone program so it can run without a GPU, e.g.
+//   cl /O2 /EHsc /std:c++17 /I..\external\include texture_cooker.cpp
+//   g++ -O2 -std=c++17 -I../external/include texture_cooker.cpp -o texture_cooker
+// textures/cook.bat cooks the atlases the renderer ships with.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "../texture_container.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Image {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> rgba;
+};
+
+static float srgbToLinear(uint8_t value) {
+    float c = value / 255.f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t linearToSrgb(float c) {
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.f + 0.5f, 0.f, 255.f));
+}
+
+// 2x2 box filter. An odd edge repeats its last texel.
+static Image downsample(const Image& src, bool srgb) {
+    Image dst;
+    dst.width = std::max(1u, src.width / 2);
+    dst.height = std::max(1u, src.height / 2);
+    dst.rgba.resize(size_t(dst.width) * dst.height * 4);
+
+    for (uint32_t y = 0; y < dst.height; y++) {
+        for (uint32_t x = 0; x < dst.width; x++) {
+            uint32_t x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+            uint32_t y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+            const uint8_t* texels[4] = {
+                &src.rgba[(size_t(y0) * src.width + x0) * 4], &src.rgba[(size_t(y0) * src.width + x1) * 4],
+                &src.rgba[(size_t(y1) * src.width + x0) * 4], &src.rgba[(size_t(y1) * src.width + x1) * 4],
+            };
+            uint8_t* out = &dst.rgba[(size_t(y) * dst.width + x) * 4];
+            for (int c = 0; c < 4; c++) {
+                float sum = 0.f;
+                for (const uint8_t* texel : texels) {
+                    sum += (srgb && c < 3) ? srgbToLinear(texel[c]) : texel[c] / 255.f;
+                }
+                float average = sum / 4.f;
+                out[c] = (srgb && c < 3) ? linearToSrgb(average)
+                    : static_cast<uint8_t>(std::clamp(average * 255.f + 0.5f, 0.f, 255.f));
+            }
+        }
+    }
+    return dst;
+}
+
+// Copies the 4x4 block at (bx, by), repeating edge texels for levels smaller than a block
+static void fetchBlock(const Image& image, uint32_t bx, uint32_t by, uint8_t block[16][4]) {
+    for (uint32_t y = 0; y < 4; y++) {
+        for (uint32_t x = 0; x < 4; x++) {
+            uint32_t sx = std::min(bx * 4 + x, image.width - 1);
+            uint32_t sy = std::min(by * 4 + y, image.height - 1);
+            std::memcpy(block[y * 4 + x], &image.rgba[(size_t(sy) * image.width + sx) * 4], 4);
+        }
+    }
+}
+
+// Finds the two ends of the block's principal axis over the first `channels`
+// channels: the mean plus the smallest and largest projections along it
+static void principalEndpoints(const uint8_t block[16][4], int channels, float lo[4], float hi[4]) {
+    float mean[4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < channels; c++) {
+            mean[c] += block[i][c] / 16.f;
+        }
+    }
+
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                cov[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+            }
+        }
+    }
+
+    // power iteration, starting from the diagonal so a grey ramp converges at once
+    float axis[4] = { 1.f, 1.f, 1.f, channels > 3 ? 1.f : 0.f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                next[a] += cov[a][b] * axis[b];
+            }
+        }
+        float length = 0.f;
+        for (int c = 0; c < channels; c++) {
+            length = std::max(length, std::fabs(next[c]));
+        }
+        if (length < 1e-6f) {
+            break;
+        }
+        for (int c = 0; c < channels; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minT = 0.f, maxT = 0.f;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.f;
+        for (int c = 0; c < channels; c++) {
+            t += (block[i][c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    float lengthSq = 0.f;
+    for (int c = 0; c < channels; c++) {
+        lengthSq += axis[c] * axis[c];
+    }
+    lengthSq = std::max(lengthSq, 1e-6f);
+    for (int c = 0; c < channels; c++) {
+        lo[c] = std::clamp(mean[c] + axis[c] * minT / lengthSq, 0.f, 255.f);
+        hi[c] = std::clamp(mean[c] + axis[c] * maxT / lengthSq, 0.f, 255.f);
+    }
+}
+
+static int colorDistance(const uint8_t a[4], const int b[3]) {
+    int dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+    return dr * dr + dg * dg + db * db;
+}
+
+static uint16_t packRgb565(const float rgb[3]) {
+    int r = static_cast<int>(std::lround(rgb[0] * 31.f / 255.f));
+    int g = static_cast<int>(std::lround(rgb[1] * 63.f / 255.f));
+    int b = static_cast<int>(std::lround(rgb[2] * 31.f / 255.f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRgb565(uint16_t packed, int rgb[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// BC1. Blocks with any texel under half alpha use the three colour mode, where
+// index 3 is transparent black.
+static void encodeBC1(const uint8_t block[16][4], uint8_t out[8]) {
+    bool punchThrough = false;
+    for (int i = 0; i < 16; i++) {
+        punchThrough |= block[i][3] < 128;
+    }
+
+    float lo[4], hi[4];
+    principalEndpoints(block, 3, lo, hi);
+    uint16_t c0 = packRgb565(hi), c1 = packRgb565(lo);
+    // four colour mode needs c0 > c1, so equal endpoints fall back to three
+    // colours, which still decodes index 0 exactly
+    bool threeColor = punchThrough || c0 == c1;
+    if ((c0 < c1 && !threeColor) || (c0 > c1 && threeColor)) {
+        std::swap(c0, c1);
+    }
+
+    int palette[4][3];
+    unpackRgb565(c0, palette[0]);
+    unpackRgb565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (threeColor) {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+        else {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+    int colors = threeColor ? 3 : 4;
+
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 3;
+        if (!punchThrough || block[i][3] >= 128) {
+            int bestDistance = INT32_MAX;
+            for (int p = 0; p < colors; p++) {
+                int distance = colorDistance(block[i], palette[p]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+        }
+        indices |= uint32_t(best) << (i * 2);
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    std::memcpy(out + 4, &indices, 4);
+}
+
+// Writes `bits` bits of value into a little-endian 128-bit block
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* out) : out(out), position(0) { std::memset(out, 0, 16); }
+    void write(uint32_t value, int bits) {
+        for (int i = 0; i < bits; i++, position++) {
+            out[position / 8] |= ((value >> i) & 1) << (position % 8);
+        }
+    }
+private:
+    uint8_t* out;
+    int position;
+};
+
+// BC7 mode 6: a single subset of RGBA endpoints with 7 bits per channel and a
+// shared low bit per endpoint, and 16 interpolation steps. One mode keeps the
+// cooker small; the other modes would mostly help blocks with two distinct
+// colour groups.
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Endpoints {
+    int values[2][4];   // 7 bits per channel
+    int pbits[2];
+};
+
+// Picks the 7-bit value and p-bit closest to each target endpoint
+static Bc7Endpoints quantiseBC7(const float lo[4], const float hi[4]) {
+    Bc7Endpoints endpoints{};
+    const float* targets[2] = { lo, hi };
+    for (int e = 0; e < 2; e++) {
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; p++) {
+            int quantised[4];
+            float error = 0.f;
+            for (int c = 0; c < 4; c++) {
+                quantised[c] = std::clamp(static_cast<int>(std::lround((targets[e][c] - p) / 2.f)), 0, 127);
+                float value = float((quantised[c] << 1) | p);
+                error += (value - targets[e][c]) * (value - targets[e][c]);
+            }
+            if (error < bestError) {
+                bestError = error;
+                endpoints.pbits[e] = p;
+                std::memcpy(endpoints.values[e], quantised, sizeof(quantised));
+            }
+        }
+    }
+    return endpoints;
+}
+
+// Chooses the nearest palette entry for every texel and returns the squared error
+static int assignBC7(const uint8_t block[16][4], const Bc7Endpoints& endpoints, int indices[16]) {
+    int palette[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            int a = (endpoints.values[0][c] << 1) | endpoints.pbits[0];
+            int b = (endpoints.values[1][c] << 1) | endpoints.pbits[1];
+            palette[i][c] = (a * (64 - BC7_WEIGHTS[i]) + b * BC7_WEIGHTS[i] + 32) >> 6;
+        }
+    }
+
+    int total = 0;
+    for (int i = 0; i < 16; i++) {
+        int bestDistance = INT32_MAX;
+        for (int p = 0; p < 16; p++) {
+            int distance = 0;
+            for (int c = 0; c < 4; c++) {
+                int d = block[i][c] - palette[p][c];
+                distance += d * d;
+            }
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                indices[i] = p;
+            }
+        }
+        total += bestDistance;
+    }
+    return total;
+}
+
+static void encodeBC7(const uint8_t block[16][4], uint8_t out[16]) {
+    float lo[4], hi[4];
+    principalEndpoints(block, 4, lo, hi);
+
+    Bc7Endpoints endpoints = quantiseBC7(lo, hi);
+    int indices[16];
+    int error = assignBC7(block, endpoints, indices);
+
+    // refit the endpoints to the chosen weights by least squares, keeping
+    // the result only while it lowers the error
+    for (int iteration = 0; iteration < 2 && error > 0; iteration++) {
+        float aa = 0.f, ab = 0.f, bb = 0.f, ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; i++) {
+            float t = BC7_WEIGHTS[indices[i]] / 64.f;
+            aa += (1.f - t) * (1.f - t);
+            ab += (1.f - t) * t;
+            bb += t * t;
+            for (int c = 0; c < 4; c++) {
+                ax[c] += (1.f - t) * block[i][c];
+                bx[c] += t * block[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f) {
+            break;
+        }
+        float refitLo[4], refitHi[4];
+        for (int c = 0; c < 4; c++) {
+            refitLo[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.f, 255.f);
+            refitHi[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.f, 255.f);
+        }
+
+        Bc7Endpoints refit = quantiseBC7(refitLo, refitHi);
+        int refitIndices[16];
+        int refitError = assignBC7(block, refit, refitIndices);
+        if (refitError >= error) {
+            break;
+        }
+        endpoints = refit;
+        error = refitError;
+        std::memcpy(indices, refitIndices, sizeof(indices));
+    }
+
+    // the first index is stored with 3 bits, so its top bit must be clear
+    if (indices[0] >= 8) {
+        std::swap(endpoints.values[0], endpoints.values[1]);
+        std::swap(endpoints.pbits[0], endpoints.pbits[1]);
+        for (int& index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    BitWriter writer(out);
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(endpoints.values[0][c], 7);
+        writer.write(endpoints.values[1][c], 7);
+    }
+    writer.write(endpoints.pbits[0], 1);
+    writer.write(endpoints.pbits[1], 1);
+    for (int i = 0; i < 16; i++) {
+        writer.write(indices[i], i == 0 ? 3 : 4);
+    }
+}
+
+static std::vector<uint8_t> encodeLevel(const Image& image, TextureFormat format) {
+    if (format == TextureFormat::RGBA8) {
+        return image.rgba;
+    }
+
+    std::vector<uint8_t> data(textureLevelBytes(format, image.width, image.height));
+    uint32_t blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+    uint32_t blockBytes = textureBlockBytes(format);
+    uint8_t block[16][4];
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            fetchBlock(image, bx, by, block);
+            uint8_t* out = &data[(size_t(by) * blocksX + bx) * blockBytes];
+            if (format == TextureFormat::BC1) {
+                encodeBC1(block, out);
+            }
+            else {
+                encodeBC7(block, out);
+            }
+        }
+    }
+    return data;
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static void cook(const std::string& input, const std::string& output, TextureFormat format, bool srgb) {
+    using Clock = std::chrono::steady_clock;
+    auto decodeStart = Clock::now();
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        throw std::runtime_error("failed to load " + input);
+    }
+    float decodeMs = std::chrono::duration<float, std::milli>(Clock::now() - decodeStart).count();
+
+    std::vector<Image> levels(1);
+    levels[0].width = width;
+    levels[0].height = height;
+    levels[0].rgba.assign(pixels, pixels + size_t(width) * height * 4);
+    stbi_image_free(pixels);
+
+    // the same chain length the renderer generates for the PNG
+    uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+    while (levels.size() < mipLevels) {
+        levels.push_back(downsample(levels.back(), srgb));
+    }
+
+    TextureFileHeader header{};
+    header.magic = TEXTURE_FILE_MAGIC;
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = format;
+    header.srgb = srgb ? 1 : 0;
+    header.width = width;
+    header.height = height;
+    header.mipLevels = mipLevels;
+
+    std::vector<TextureFileLevel> table(mipLevels);
+    std::vector<std::vector<uint8_t>> encoded(mipLevels);
+    uint64_t offset = alignUp(sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * mipLevels, TEXTURE_LEVEL_ALIGNMENT);
+    uint64_t firstOffset = offset;
+    uint64_t rgbaBytes = 0;
+    for (uint32_t i = 0; i < mipLevels; i++) {
+        encoded[i] = encodeLevel(levels[i], format);
+        table[i] = { offset, encoded[i].size(), levels[i].width, levels[i].height };
+        offset = alignUp(offset + encoded[i].size(), TEXTURE_LEVEL_ALIGNMENT);
+        rgbaBytes += levels[i].rgba.size();
+    }
+    header.dataSize = offset - firstOffset;
+
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()), sizeof(TextureFileLevel) * table.size());
+    for (uint32_t i = 0; i < mipLevels; i++) {
+        file.seekp(table[i].offset);
+        file.write(reinterpret_cast<const char*>(encoded[i].data()), encoded[i].size());
+    }
+    // pad the last level out to the size the header promises
+    file.seekp(offset - 1);
+    file.put(0);
+    if (!file) {
+        throw std::runtime_error("failed to write " + output);
+    }
+
+    static const char* FORMAT_NAMES[] = { "rgba8", "bc1", "bc7" };
+    std::cout << input << " -> " << output << "\n"
+        << "  " << width << "x" << height << ", " << mipLevels << " levels, "
+        << FORMAT_NAMES[static_cast<uint32_t>(format)] << (srgb ? " srgb" : " linear") << "\n"
+        << "  png decode " << decodeMs << " ms, " << rgbaBytes / 1024 << " KB as RGBA8 with mips, "
+        << header.dataSize / 1024 << " KB cooked" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    TextureFormat format = TextureFormat::BC7;
+    bool srgb = true;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "rgba8") format = TextureFormat::RGBA8;
+            else if (name == "bc1") format = TextureFormat::BC1;
+            else if (name == "bc7") format = TextureFormat::BC7;
+            else {
+                std::cerr << "unknown format " << name << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--linear") {
+            srgb = false;
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.size() != 2) {
+        std::cerr << "usage: texture_cooker [--format rgba8|bc1|bc7] [--linear] input.png output.vtex" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        cook(paths[0], paths[1], format, srgb);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+// Headless benchmark of world generation and meshing: generates N zones of
+// 4 x 4 Chunks on K threads, meshes every Chunk, builds the LOD tiles the
+// game would draw past a draw radius of R zones, and prints the results as
+// one JSON object so they can be compared across commits.
+//
+//   world_benchmark [--zones N] [--threads K] [--lod-radius R] [--out results.json] [--host-budget-mb M]
+//
+// It links only the CPU world library, so it runs on machines without a GPU.
+// Build it with CMakeLists.txt:
+//   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build
+//
+// Host memory is read from the MemoryTracker. With --host-budget-mb the run
+// fails (exit code 2) if the world's tracked host bytes ever went over M MB.
+//
+// The two phases run one after the other, like the game, which meshes a
+// Chunk only once it has been generated. Meshing samples createBlock past
+// the Chunk's edges, so it doesn't depend on the neighbours being there.
+
+#include "../chunk.h"
+#include "../terrain_util.h"
+#include "../memory_tracker.h"
+#include "../lod_mesh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static constexpr int ZONE_SIZE = 64;
+static constexpr int CHUNKS_PER_ZONE = (ZONE_SIZE / 16) * (ZONE_SIZE / 16);
+
+static uint64_t peakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;   // kilobytes on Linux
+#endif
+#endif
+}
+
+// Runs work(i) for every i below count on the given number of threads and
+// returns the wall time in seconds
+static double runParallel(int threads, size_t count, const std::function<void(size_t)>& work) {
+    std::atomic<size_t> next{ 0 };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            size_t i;
+            while ((i = next.fetch_add(1)) < count) {
+                work(i);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void usage() {
+    std::cerr << "usage: world_benchmark [--zones N] [--threads K] [--lod-radius R] [--out results.json] [--host-budget-mb M]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int zones = 16;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int lodRadius = 2;
+    std::string outPath;
+    double hostBudgetMb = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--zones") {
+            zones = std::atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && arg == "--threads") {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && arg == "--lod-radius") {
+            lodRadius = std::atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && arg == "--out") {
+            outPath = argv[++i];
+        }
+        else if (i + 1 < argc && arg == "--host-budget-mb") {
+            hostBudgetMb = std::atof(argv[++i]);
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (zones <= 0 || threads <= 0 || lodRadius < 0) {
+        usage();
+        return 1;
+    }
+
+    // zones fill a square, row by row, from the origin
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(zones))));
+    std::vector<std::unique_ptr<Chunk>> chunks(static_cast<size_t>(zones) * CHUNKS_PER_ZONE);
+
+    double generateSeconds = runParallel(threads, zones, [&](size_t zone) {
+        int zoneX = static_cast<int>(zone % side) * ZONE_SIZE;
+        int zoneZ = static_cast<int>(zone / side) * ZONE_SIZE;
+        for (int i = 0; i < CHUNKS_PER_ZONE; i++) {
+            auto chunk = std::make_unique<Chunk>(zoneX + (i % 4) * 16, zoneZ + (i / 4) * 16);
+            generateChunkBlocks(*chunk);
+            chunks[zone * CHUNKS_PER_ZONE + i] = std::move(chunk);
+        }
+    });
+
+    // summed per Chunk, so the workers don't share counters
+    std::vector<uint64_t> vertexCounts(chunks.size()), indexCounts(chunks.size());
+    double meshSeconds = runParallel(threads, chunks.size(), [&](size_t i) {
+        Chunk& chunk = *chunks[i];
+        chunk.createVertexData();
+        vertexCounts[i] = chunk.vertices().size();
+        indexCounts[i] = chunk.indices().size();
+        // the game frees the mesh once it is uploaded
+        chunk.releaseMeshData();
+    });
+
+    // the tiles around a voxel area of (2R + 1) x (2R + 1) zones centred on
+    // the zone at the origin, like TerrainLod::select
+    std::vector<LodTileRect> tiles;
+    int lodViewDistance = selectLodTiles(glm::ivec2(-lodRadius * ZONE_SIZE), glm::ivec2((lodRadius + 1) * ZONE_SIZE), tiles);
+    std::vector<uint64_t> tileTriangles(tiles.size()), tileBytes(tiles.size());
+    std::vector<double> tileSeconds(tiles.size());
+    double lodSeconds = runParallel(threads, tiles.size(), [&](size_t i) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Vertex> tileVertices;
+        std::vector<uint16_t> tileIndices;
+        buildLodMesh(tiles[i], tileVertices, tileIndices);
+        tileSeconds[i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        tileTriangles[i] = tileIndices.size() / 3;
+        // the buffer TerrainLod uploads: vertices, then 16-bit indices
+        tileBytes[i] = tileVertices.size() * sizeof(Vertex) + tileIndices.size() * sizeof(uint16_t);
+    });
+    std::ostringstream lodJson;
+    lodJson.precision(6);
+    for (int level = 0; level < LOD_LEVELS; level++) {
+        uint64_t levelTiles = 0, levelTriangles = 0, levelBytes = 0;
+        double levelSeconds = 0.0;
+        for (size_t i = 0; i < tiles.size(); i++) {
+            if (lodLevel(tiles[i].scale) == level) {
+                levelTiles++;
+                levelTriangles += tileTriangles[i];
+                levelBytes += tileBytes[i];
+                levelSeconds += tileSeconds[i];
+            }
+        }
+        std::string prefix = "  \"lod_level" + std::to_string(level) + "_";
+        lodJson << prefix << "tiles\": " << levelTiles << ",\n"
+            << prefix << "triangles\": " << levelTriangles << ",\n"
+            << prefix << "bytes\": " << levelBytes << ",\n"
+            << prefix << "ms_per_tile\": " << (levelTiles > 0 ? levelSeconds * 1000.0 / levelTiles : 0.0) << ",\n";
+    }
+
+    uint64_t vertices = 0, indices = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        vertices += vertexCounts[i];
+        indices += indexCounts[i];
+    }
+    uint64_t chunkCount = chunks.size();
+    uint64_t blockBytes = chunkCount * 16 * 256 * 16 * sizeof(BlockType);
+    uint64_t meshBytes = vertices * sizeof(Vertex) + indices * sizeof(uint32_t);
+    const MemoryTracker& memory = MemoryTracker::instance();
+    MemoryTracker::Usage hostMemory = memory.hostTotal();
+    double totalSeconds = generateSeconds + meshSeconds;
+
+    std::ostringstream json;
+    json.precision(6);
+    json << "{\n"
+        << "  \"benchmark\": \"world\",\n"
+        << "  \"zones\": " << zones << ",\n"
+        << "  \"threads\": " << threads << ",\n"
+        << "  \"chunks\": " << chunkCount << ",\n"
+        << "  \"generate_s\": " << generateSeconds << ",\n"
+        << "  \"mesh_s\": " << meshSeconds << ",\n"
+        << "  \"total_s\": " << totalSeconds << ",\n"
+        << "  \"chunks_per_s\": " << chunkCount / totalSeconds << ",\n"
+        << "  \"generate_chunks_per_s\": " << chunkCount / generateSeconds << ",\n"
+        << "  \"mesh_chunks_per_s\": " << chunkCount / meshSeconds << ",\n"
+        << "  \"vertices\": " << vertices << ",\n"
+        << "  \"indices\": " << indices << ",\n"
+        << "  \"vertices_per_s\": " << vertices / meshSeconds << ",\n"
+        << "  \"block_bytes\": " << blockBytes << ",\n"
+        << "  \"mesh_bytes\": " << meshBytes << ",\n"
+        << "  \"mesh_bytes_per_s\": " << meshBytes / meshSeconds << ",\n"
+        << "  \"lod_radius\": " << lodRadius << ",\n"
+        << "  \"lod_view_distance\": " << lodViewDistance << ",\n"
+        << "  \"lod_s\": " << lodSeconds << ",\n"
+        << lodJson.str()
+        << "  \"tracked_host_peak_bytes\": " << hostMemory.peakBytes << ",\n"
+        << "  \"tracked_block_peak_bytes\": " << memory.host(MemoryTracker::HOST_CHUNK_BLOCKS).peakBytes << ",\n"
+        << "  \"tracked_mesh_peak_bytes\": " << memory.host(MemoryTracker::HOST_CHUNK_MESH).peakBytes << ",\n"
+        << "  \"peak_rss_bytes\": " << peakRssBytes() << "\n"
+        << "}\n";
+
+    std::cout << json.str();
+    if (!outPath.empty()) {
+        std::ofstream out(outPath);
+        if (!out.is_open()) {
+            std::cerr << "failed to open " << outPath << std::endl;
+            return 1;
+        }
+        out << json.str();
+    }
+
+    if (hostBudgetMb > 0 && hostMemory.peakBytes > hostBudgetMb * 1024 * 1024) {
+        std::cerr << "tracked host memory peaked at " << hostMemory.peakBytes / (1024.0 * 1024.0)
+            << " MB, over the budget of " << hostBudgetMb << " MB" << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "trace_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+TraceRecorder::Scope::Scope(const char* name, const char* stage, int x, int z)
+    : name(name), stage(stage), x(x), z(z), startNs(TraceRecorder::instance().isEnabled() ? nowNs() : -1)
+{
+}
+
+TraceRecorder::Scope::~Scope() {
+    if (startNs >= 0) {
+        TraceRecorder::instance().record(name, stage, startNs, nowNs(), x, z);
+    }
+}
+
+TraceRecorder& TraceRecorder::instance() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+int64_t TraceRecorder::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TraceRecorder::TraceRecorder()
+    : windowSeconds(10.f), enabled(true), originNs(nowNs()), ringsMutex(), rings()
+{
+}
+
+TraceRecorder::ThreadRing& TraceRecorder::threadRing() {
+    thread_local ThreadRing* ring = nullptr;
+    if (!ring) {
+        // once per thread, the only time recording takes a lock
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        auto created = std::make_unique<ThreadRing>();
+        created->id = static_cast<int>(rings.size()) + 1;
+        created->name = "thread " + std::to_string(created->id);
+        created->head.store(0, std::memory_order_relaxed);
+        created->events = std::make_unique<Event[]>(RING_EVENTS);
+        for (size_t i = 0; i < RING_EVENTS; i++) {
+            created->events[i].sequence.store(0, std::memory_order_relaxed);
+        }
+        ring = created.get();
+        rings.push_back(std::move(created));
+    }
+    return *ring;
+}
+
+void TraceRecorder::setThreadName(const std::string& name) {
+    ThreadRing& ring = threadRing();
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ring.name = name;
+}
+
+void TraceRecorder::record(const char* name, const char* stage, int64_t startNs, int64_t endNs, int x, int z) {
+    ThreadRing& ring = threadRing();
+    uint64_t index = ring.head.load(std::memory_order_relaxed);
+    Event& event = ring.events[index & (RING_EVENTS - 1)];
+
+    event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.stage.store(stage, std::memory_order_relaxed);
+    event.startNs.store(startNs, std::memory_order_relaxed);
+    event.endNs.store(endNs, std::memory_order_relaxed);
+    event.x.store(x, std::memory_order_relaxed);
+    event.z.store(z, std::memory_order_relaxed);
+    event.sequence.store(2 * index + 2, std::memory_order_release);
+    ring.head.store(index + 1, std::memory_order_release);
+}
+
+// Names and stages are literals from the source, but quote them properly anyway
+static void writeJsonString(std::ofstream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+int TraceRecorder::writeChromeTrace(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return -1;
+    }
+
+    int64_t cutoffNs = nowNs() - static_cast<int64_t>(windowSeconds * 1e9);
+    int written = 0;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (const std::unique_ptr<ThreadRing>& ring : rings) {
+        if (written > 0) {
+            out << ",\n";
+        }
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->id << ",\"args\":{\"name\":";
+        writeJsonString(out, ring->name.c_str());
+        out << "}},\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":1,\"tid\":" << ring->id
+            << ",\"args\":{\"sort_index\":" << ring->id << "}}";
+        written++;
+
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t first = head > RING_EVENTS ? head - RING_EVENTS : 0;
+        for (uint64_t index = first; index < head; index++) {
+            const Event& slot = ring->events[index & (RING_EVENTS - 1)];
+            uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const char* name = slot.name.load(std::memory_order_relaxed);
+            const char* stage = slot.stage.load(std::memory_order_relaxed);
+            int64_t startNs = slot.startNs.load(std::memory_order_relaxed);
+            int64_t endNs = slot.endNs.load(std::memory_order_relaxed);
+            int x = slot.x.load(std::memory_order_relaxed);
+            int z = slot.z.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // skip a slot the owning thread has since reused or is writing
+            if (sequence != 2 * index + 2 || slot.sequence.load(std::memory_order_relaxed) != sequence) {
+                continue;
+            }
+            if (endNs < cutoffNs) {
+                continue;
+            }
+
+            out << ",\n{\"ph\":\"X\",\"name\":";
+            writeJsonString(out, name);
+            out << ",\"cat\":";
+            writeJsonString(out, stage);
+            out << ",\"pid\":1,\"tid\":" << ring->id
+                << ",\"ts\":" << (startNs - originNs) / 1000.0
+                << ",\"dur\":" << std::max<int64_t>(endNs - startNs, 0) / 1000.0;
+            if (x != NO_COORD) {
+                out << ",\"args\":{\"x\":" << x << ",\"z\":" << z << "}";
+            }
+            out << "}";
+            written++;
+        }
+    }
+    out << "\n]}\n";
+    return written - static_cast<int>(rings.size());
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records begin/end events from every thread into a fixed ring per thread,
+// and writes the most recent ones as Chrome trace JSON on request (open it at
+// ui.perfetto.dev or chrome://tracing).
+//
+// Each thread only ever writes to its own ring, so recording takes no lock:
+// the thread fills a slot and bumps its head. A writer that laps a reader is
+// caught by a per-slot sequence number, and the reader drops that event. The
+// rings hold RING_EVENTS events each and a dump only keeps the last
+// windowSeconds, so memory stays bounded and recording can stay on all the time.
+class TraceRecorder {
+public:
+    static constexpr size_t RING_EVENTS = 1 << 14;     // per thread, a power of two
+    static constexpr int NO_COORD = INT_MIN;
+
+    // Records the enclosing block as one event on the calling thread
+    class Scope {
+    public:
+        Scope(const char* name, const char* stage, int x = NO_COORD, int z = NO_COORD);
+        ~Scope();
+    private:
+        const char* name;
+        const char* stage;
+        int x, z;
+        int64_t startNs;
+    };
+
+    static TraceRecorder& instance();
+    static int64_t nowNs();
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+    // How far back a dump reaches
+    float windowSeconds;
+
+    // Names the calling thread in the trace. Call before its first event.
+    void setThreadName(const std::string& name);
+    // name and stage must outlive the recorder, e.g. string literals.
+    // x and z tag the event with chunk or zone coordinates.
+    void record(const char* name, const char* stage, int64_t startNs, int64_t endNs,
+        int x = NO_COORD, int z = NO_COORD);
+
+    // Writes the events of the last windowSeconds from every thread.
+    // Returns the number written, or -1 if the file couldn't be opened.
+    int writeChromeTrace(const std::string& path) const;
+
+private:
+    // The fields are atomics only so a reader racing the writer is defined
+    // behaviour; all of them are accessed relaxed and the sequence orders them.
+    struct Event {
+        std::atomic<uint64_t> sequence;     // 2 * index + 2 once written, odd while being written
+        std::atomic<const char*> name;
+        std::atomic<const char*> stage;
+        std::atomic<int64_t> startNs;
+        std::atomic<int64_t> endNs;
+        std::atomic<int> x, z;
+    };
+
+    struct ThreadRing {
+        std::string name;
+        int id;
+        std::atomic<uint64_t> head;
+        std::unique_ptr<Event[]> events;
+    };
+
+    TraceRecorder();
+    ThreadRing& threadRing();
+
+    std::atomic<bool> enabled;
+    int64_t originNs;
+    // rings are kept after their thread exits, so its events can still be dumped
+    mutable std::mutex ringsMutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Traces the rest of the enclosing block, optionally tagged with coordinates:
+// TRACE_SCOPE("mesh chunk", "mesh", x, z)
+#define TRACE_SCOPE(...) TraceRecorder::Scope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
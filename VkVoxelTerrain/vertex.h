@@ -0,0 +1,22 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// One vertex of a Chunk's mesh. The Vulkan input layout that matches it is
+// in types.h, so the world code can build without Vulkan. 48 bytes: the
+// occlusion and light levels share the last 4.
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 nor; 
+    glm::vec3 color;
+    glm::vec2 texCoord;
+    // ambient occlusion at this corner, 0 (darkest) to 3 (none)
+    uint8_t ao;
+    // sky light and block light at this corner, levels 0 to 15 scaled to 0 to 255
+    uint8_t skyLight;
+    uint8_t blockLight;
+    uint8_t padding;
+};
@@ -0,0 +1,135 @@
+#include "voxel_collision.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// how far a face has to be into a block for the box to count as
+// overlapping it, so a box resting flush against a block isn't inside it
+static constexpr float SKIN = 1e-4f;
+
+CollisionWorld::CollisionWorld(ChunkLookup lookup)
+    : lookup(std::move(lookup)), cache()
+{
+    cache.fill({ INT_MIN, INT_MIN, nullptr });
+}
+
+const Chunk* CollisionWorld::chunkAt(int x, int z) {
+    CachedChunk& entry = cache[((x >> 4) * 7 + (z >> 4)) & (CACHE_SIZE - 1)];
+    if (entry.x != x || entry.z != z) {
+        entry = { x, z, lookup(x, z) };
+    }
+    return entry.chunk;
+}
+
+bool CollisionWorld::anySolid(const glm::ivec3& lo, const glm::ivec3& hi) {
+    if (hi.x < lo.x || hi.y < lo.y || hi.z < lo.z) {
+        return false;
+    }
+    if (lo.y < 0) {
+        return true;
+    }
+    if (lo.y > 255) {
+        return false;
+    }
+    const int yHi = std::min(hi.y, 255);
+
+    // & ~15 floors to the Chunk's corner, negatives included
+    for (int z0 = lo.z & ~15; z0 <= hi.z; z0 += 16) {
+        for (int x0 = lo.x & ~15; x0 <= hi.x; x0 += 16) {
+            const Chunk* chunk = chunkAt(x0, z0);
+            if (chunk == nullptr) {
+                return true;
+            }
+            int xLo = std::max(lo.x, x0) - x0, xHi = std::min(hi.x, x0 + 15) - x0;
+            int zLo = std::max(lo.z, z0) - z0, zHi = std::min(hi.z, z0 + 15) - z0;
+            uint16_t xMask = static_cast<uint16_t>(((1u << (xHi + 1)) - 1) & ~((1u << xLo) - 1));
+            uint16_t solid = chunk->solidSections();
+
+            for (int y = lo.y; y <= yHi; y++) {
+                int section = y / SECTION_SIZE;
+                if (!(solid & (1 << section))) {
+                    // skip to the first row of the next section
+                    y = (section + 1) * SECTION_SIZE - 1;
+                    continue;
+                }
+                const SectionOccupancy& bits = chunk->sectionOccupancy(section);
+                for (int z = zLo; z <= zHi; z++) {
+                    if (bits.row(y % SECTION_SIZE, z) & xMask) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+float CollisionWorld::moveAxis(Aabb& box, int axis, float distance) {
+    if (distance == 0.f) {
+        return 0.f;
+    }
+    // the blocks the box covers across the axis it moves along
+    glm::ivec3 lo = glm::ivec3(glm::floor(box.min + SKIN));
+    glm::ivec3 hi = glm::ivec3(glm::floor(box.max - SKIN));
+
+    if (distance > 0.f) {
+        // each layer of blocks ahead of the leading face, nearest first
+        int first = static_cast<int>(std::floor(box.max[axis] - SKIN)) + 1;
+        int last = static_cast<int>(std::floor(box.max[axis] + distance - SKIN));
+        for (int layer = first; layer <= last; layer++) {
+            lo[axis] = hi[axis] = layer;
+            if (anySolid(lo, hi)) {
+                distance = std::max(0.f, layer - box.max[axis]);
+                break;
+            }
+        }
+    }
+    else {
+        int first = static_cast<int>(std::floor(box.min[axis] + SKIN)) - 1;
+        int last = static_cast<int>(std::floor(box.min[axis] + distance + SKIN));
+        for (int layer = first; layer >= last; layer--) {
+            lo[axis] = hi[axis] = layer;
+            if (anySolid(lo, hi)) {
+                distance = std::min(0.f, (layer + 1) - box.min[axis]);
+                break;
+            }
+        }
+    }
+    box.min[axis] += distance;
+    box.max[axis] += distance;
+    return distance;
+}
+
+Aabb PhysicsBody::bounds() const {
+    return { position - glm::vec3(halfWidth, 0.f, halfWidth), position + glm::vec3(halfWidth, height, halfWidth) };
+}
+
+void stepBody(CollisionWorld& world, PhysicsBody& body, const BodyControl& control, float dt) {
+    if (body.flying) {
+        body.velocity = control.moveVelocity;
+    }
+    else {
+        body.velocity.x = control.moveVelocity.x;
+        body.velocity.z = control.moveVelocity.z;
+        if (control.jump && body.onGround) {
+            body.velocity.y = BODY_JUMP_SPEED;
+        }
+        body.velocity.y = std::max(body.velocity.y - BODY_GRAVITY * dt, -BODY_TERMINAL_SPEED);
+    }
+
+    Aabb box = body.bounds();
+    glm::vec3 wanted = body.velocity * dt;
+    body.onGround = false;
+    // y first so a body that lands this step then slides along the ground
+    for (int axis : { 1, 0, 2 }) {
+        float moved = world.moveAxis(box, axis, wanted[axis]);
+        if (moved != wanted[axis]) {
+            if (axis == 1 && wanted.y < 0.f) {
+                body.onGround = true;
+            }
+            body.velocity[axis] = 0.f;
+        }
+    }
+    body.position = glm::vec3((box.min.x + box.max.x) * 0.5f, box.min.y, (box.min.z + box.max.z) * 0.5f);
+}
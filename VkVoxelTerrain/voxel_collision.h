@@ -0,0 +1,82 @@
+#pragma once
+#include "glm_includes.h"
+#include "chunk.h"
+
+#include <array>
+#include <functional>
+
+struct Aabb {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Answers "is anything solid in this box of blocks" from the Chunks'
+// occupancy bits, a row of up to 16 blocks per test, and moves boxes
+// through the grid one axis at a time. Like VoxelRaycaster it keeps the
+// last few Chunks it looked up, missing ones included, so make a new one
+// once Chunks may have been added.
+//
+// Below the world and in Chunks the lookup doesn't have counts as solid, so
+// nothing falls out of the world or into terrain that isn't generated yet.
+// Above the world is empty.
+class CollisionWorld {
+public:
+    // The Chunk whose lower-left corner is at (x, z), nullptr if there is none
+    using ChunkLookup = std::function<const Chunk*(int x, int z)>;
+
+    explicit CollisionWorld(ChunkLookup lookup);
+
+    // Whether any block from lo to hi (both included) is solid
+    bool anySolid(const glm::ivec3& lo, const glm::ivec3& hi);
+    // Moves box along one axis by up to distance, stopping flush against
+    // the first solid block in the way. Every layer of blocks the box
+    // sweeps through is tested, so nothing is skipped at any speed. Returns
+    // how far the box moved.
+    float moveAxis(Aabb& box, int axis, float distance);
+
+private:
+    static constexpr int CACHE_SIZE = 16;
+    struct CachedChunk {
+        int x, z;
+        const Chunk* chunk;
+    };
+
+    ChunkLookup lookup;
+    // direct mapped on the chunk coordinates
+    std::array<CachedChunk, CACHE_SIZE> cache;
+
+    const Chunk* chunkAt(int x, int z);
+};
+
+// A box that moves through the world: the player now, mobs later.
+// position is the middle of the bottom face.
+struct PhysicsBody {
+    glm::vec3 position = glm::vec3(0.f);
+    glm::vec3 velocity = glm::vec3(0.f);
+    float halfWidth = 0.3f;
+    float height = 1.8f;
+    // no gravity, moves in all three directions
+    bool flying = true;
+    // resting on a solid block after the last step
+    bool onGround = false;
+
+    Aabb bounds() const;
+};
+
+// What the body is trying to do this step
+struct BodyControl {
+    // blocks per second; only x and z are used when walking
+    glm::vec3 moveVelocity = glm::vec3(0.f);
+    bool jump = false;
+};
+
+// Blocks per second squared and blocks per second
+constexpr float BODY_GRAVITY = 32.f;
+constexpr float BODY_JUMP_SPEED = 9.f;
+constexpr float BODY_TERMINAL_SPEED = 78.f;
+
+// Advances the body by dt seconds: walking bodies fall and can jump,
+// flying ones go where they are steered. The move is resolved y, then x,
+// then z, and velocity along an axis that hit something is zeroed, so a
+// body slides along walls and floors.
+void stepBody(CollisionWorld& world, PhysicsBody& body, const BodyControl& control, float dt);
@@ -0,0 +1,106 @@
+#include "voxel_raycast.h"
+
+#include <algorithm>
+#include <climits>
+#include <limits>
+
+VoxelRaycaster::VoxelRaycaster(ChunkLookup lookup, bool stopAtWater)
+    : lookup(std::move(lookup)), stopAtWater(stopAtWater), cache()
+{
+    cache.fill({ INT_MIN, INT_MIN, nullptr });
+}
+
+const Chunk* VoxelRaycaster::chunkAt(int x, int z) {
+    CachedChunk& entry = cache[((x >> 4) * 7 + (z >> 4)) & (CACHE_SIZE - 1)];
+    if (entry.x != x || entry.z != z) {
+        entry = { x, z, lookup(x, z) };
+    }
+    return entry.chunk;
+}
+
+RayHit VoxelRaycaster::cast(const Ray& ray) {
+    RayHit result{};
+    result.type = EMPTY;
+    float length = glm::length(ray.direction);
+    if (length == 0.f) {
+        return result;
+    }
+    glm::vec3 dir = ray.direction / length;
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    glm::ivec3 cell = glm::ivec3(glm::floor(ray.origin));
+    glm::ivec3 step(0);
+    // distance along the ray to the next cell boundary on each axis, and
+    // between two boundaries
+    glm::vec3 tMax(infinity), tDelta(infinity);
+    for (int axis = 0; axis < 3; axis++) {
+        if (dir[axis] > 0.f) {
+            step[axis] = 1;
+            tDelta[axis] = 1.f / dir[axis];
+            tMax[axis] = (cell[axis] + 1 - ray.origin[axis]) * tDelta[axis];
+        }
+        else if (dir[axis] < 0.f) {
+            step[axis] = -1;
+            tDelta[axis] = -1.f / dir[axis];
+            tMax[axis] = (ray.origin[axis] - cell[axis]) * tDelta[axis];
+        }
+    }
+
+    glm::ivec3 previous = cell;
+    glm::ivec3 normal(0);
+    float t = 0.f;
+    const Chunk* chunk = nullptr;
+    int chunkX = INT_MIN, chunkZ = INT_MIN;
+    while (t <= ray.maxDistance) {
+        // out of the world and moving away from it
+        if ((cell.y < 0 && step.y <= 0) || (cell.y > 255 && step.y >= 0)) {
+            break;
+        }
+
+        // floors to a multiple of 16, negatives included
+        int x = cell.x & ~15;
+        int z = cell.z & ~15;
+        if (x != chunkX || z != chunkZ) {
+            chunkX = x;
+            chunkZ = z;
+            chunk = chunkAt(x, z);
+            if (chunk == nullptr) {
+                break;
+            }
+        }
+
+        if (cell.y >= 0 && cell.y < 256) {
+            BlockType type = chunk->getBlockAt(cell.x - x, cell.y, cell.z - z);
+            if (isOpaque(type) || (stopAtWater && type == WATER)) {
+                result.hit = true;
+                result.type = type;
+                result.block = cell;
+                result.previous = previous;
+                result.normal = normal;
+                result.distance = t;
+                return result;
+            }
+        }
+
+        // into the neighbour across whichever boundary is nearest
+        previous = cell;
+        int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+        cell[axis] += step[axis];
+        t = tMax[axis];
+        tMax[axis] += tDelta[axis];
+        normal = glm::ivec3(0);
+        normal[axis] = -step[axis];
+    }
+
+    result.block = cell;
+    result.previous = previous;
+    result.distance = std::min(t, ray.maxDistance);
+    return result;
+}
+
+void VoxelRaycaster::castBatch(const std::vector<Ray>& rays, std::vector<RayHit>& hits) {
+    hits.resize(rays.size());
+    for (size_t i = 0; i < rays.size(); i++) {
+        hits[i] = cast(rays[i]);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "glm_includes.h"
+#include "chunk.h"
+
+#include <array>
+#include <functional>
+#include <vector>
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;    // doesn't need to be normalized
+    float maxDistance;
+};
+
+struct RayHit {
+    bool hit;
+    BlockType type;
+    // the block the ray stopped in, in world space
+    glm::ivec3 block;
+    // the cell the ray was in just before, where a placed block would go
+    glm::ivec3 previous;
+    // the face of block the ray came in through, zero if it started inside it
+    glm::ivec3 normal;
+    // along the normalized ray, to where it entered block (or where it gave up)
+    float distance;
+};
+
+// Walks a ray through the block grid one cell at a time (Amanatides & Woo,
+// "A Fast Voxel Traversal Algorithm"), so it never skips a block and never
+// tests one twice. The Chunk under the ray is looked up only when the ray
+// crosses into another one, and the last few are kept between rays, so a
+// batch of rays from the same place pays for each Chunk once. Missing Chunks
+// are cached too: make a new raycaster once Chunks may have been added.
+//
+// The ray stops at the first opaque block, or at water too with stopAtWater.
+// It gives up without a hit past maxDistance or when it reaches a Chunk the
+// lookup doesn't have. Cells above or below the world are empty.
+class VoxelRaycaster {
+public:
+    // The Chunk whose lower-left corner is at (x, z), nullptr if there is none
+    using ChunkLookup = std::function<const Chunk*(int x, int z)>;
+
+    explicit VoxelRaycaster(ChunkLookup lookup, bool stopAtWater = false);
+
+    RayHit cast(const Ray& ray);
+    // hits[i] is the result of rays[i]
+    void castBatch(const std::vector<Ray>& rays, std::vector<RayHit>& hits);
+
+private:
+    static constexpr int CACHE_SIZE = 16;
+    struct CachedChunk {
+        int x, z;
+        const Chunk* chunk;
+    };
+
+    ChunkLookup lookup;
+    bool stopAtWater;
+    // direct mapped on the chunk coordinates
+    std::array<CachedChunk, CACHE_SIZE> cache;
+
+    const Chunk* chunkAt(int x, int z);
+};
@@ -1,4 +1,10 @@
 #include "vulkan_resources.h"
+#include "profiler.h"
+
+// VkDeviceMemory is a pointer on 64-bit builds and a uint64_t on 32-bit ones
+static uint64_t memoryHandle(VkDeviceMemory memory) {
+    return (uint64_t)memory;
+}
 
 VkCommandBuffer beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool) {
     VkCommandBufferAllocateInfo allocInfo{};
@@ -33,6 +39,20 @@ void endSingleTimeCommands(VkDevice device, VkCommandPool commandPool, VkQueue q
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
+void beginSecondaryCommandBuffer(VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritance, bool oneTimeSubmit) {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    if (oneTimeSubmit) {
+        beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    }
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+}
+
 uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
     VkPhysicalDeviceMemoryProperties memProperties;
     vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -78,7 +98,8 @@ bool hasStencilComponent(VkFormat format) {
 }
 
 void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkDeviceSize size,
-    VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+    VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory,
+    MemoryTracker::DeviceCategory category)
 {
     QueueFamilyIndices queueFamilies = findQueueFamilies(physicalDevice, surface);
     std::array<uint32_t, 2> indices = { queueFamilies.graphicsFamily.value(), queueFamilies.transferFamily.value() };
@@ -87,9 +108,15 @@ void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    bufferInfo.queueFamilyIndexCount = indices.size();
-    bufferInfo.pQueueFamilyIndices = indices.data();
+    // concurrent sharing needs distinct families
+    if (indices[0] != indices[1]) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = indices.size();
+        bufferInfo.pQueueFamilyIndices = indices.data();
+    }
+    else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
 
     if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create buffer!");
@@ -106,6 +133,7 @@ void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR
     if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate buffer memory!");
     }
+    MemoryTracker::instance().deviceAllocated(memoryHandle(bufferMemory), category, memRequirements.size);
 
     vkBindBufferMemory(device, buffer, bufferMemory, 0);
 }
@@ -113,6 +141,9 @@ void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR
 void copyBuffer(VkDevice device, VkCommandPool transferCommandPool, VkQueue queueTransfer,
     VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
 {
+    // submitted and waited on by the calling thread, so this is the GPU copy
+    // plus the submission round trip, summed over every upload of the frame
+    PROFILE_SCOPE("transfer (copyBuffer)");
     VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, transferCommandPool);
 
     VkBufferCopy copyRegion{};
@@ -125,7 +156,8 @@ void copyBuffer(VkDevice device, VkCommandPool transferCommandPool, VkQueue queu
 void createImage(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
     uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples,
     VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-    VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+    VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory,
+    MemoryTracker::DeviceCategory category)
 {
     QueueFamilyIndices queueFamilies = findQueueFamilies(physicalDevice, surface);
     std::array<uint32_t, 2> indices = { queueFamilies.graphicsFamily.value(), queueFamilies.transferFamily.value() };
@@ -143,9 +175,14 @@ void createImage(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage = usage;
     imageInfo.samples = numSamples;
-    imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    imageInfo.queueFamilyIndexCount = indices.size();
-    imageInfo.pQueueFamilyIndices = indices.data();
+    if (indices[0] != indices[1]) {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = indices.size();
+        imageInfo.pQueueFamilyIndices = indices.data();
+    }
+    else {
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
 
     if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("failed to create image!");
@@ -162,10 +199,45 @@ void createImage(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR
     if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate image memory!");
     }
+    MemoryTracker::instance().deviceAllocated(memoryHandle(imageMemory), category, memRequirements.size);
 
     vkBindImageMemory(device, image, imageMemory, 0);
 }
 
+void freeDeviceMemory(VkDevice device, VkDeviceMemory memory) {
+    MemoryTracker::instance().deviceFreed(memoryHandle(memory));
+    vkFreeMemory(device, memory, nullptr);
+}
+
+void updateMemoryHeaps(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetSupported) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+
+    auto getProperties2 = budgetSupported
+        ? (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR")
+        : nullptr;
+    if (getProperties2 != nullptr) {
+        properties.pNext = &budget;
+        getProperties2(physicalDevice, &properties);
+    }
+    else {
+        budgetSupported = false;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &properties.memoryProperties);
+    }
+
+    const VkPhysicalDeviceMemoryProperties& memory = properties.memoryProperties;
+    std::vector<MemoryTracker::Heap> heaps(memory.memoryHeapCount);
+    for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+        heaps[i].size = memory.memoryHeaps[i].size;
+        heaps[i].budget = budgetSupported ? budget.heapBudget[i] : memory.memoryHeaps[i].size;
+        heaps[i].usage = budgetSupported ? budget.heapUsage[i] : 0;
+        heaps[i].deviceLocal = memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+    MemoryTracker::instance().setHeaps(heaps, budgetSupported);
+}
+
 void copyBufferToImage(VkDevice device, VkCommandPool commandPool, VkQueue queue, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
 {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
@@ -3,6 +3,7 @@
 #include "globals.h"
 #include "types.h"
 #include "vulkan_setup.h"
+#include "memory_tracker.h"
 
 #include <iostream>     // std::cerr
 #include <stdexcept>    // std::runtime_error
@@ -25,19 +26,34 @@ bool hasStencilComponent(VkFormat format);
 VkCommandBuffer beginSingleTimeCommands(VkDevice device, VkCommandPool commandPool);
 void endSingleTimeCommands(VkDevice device, VkCommandPool commandPool, VkQueue queue, VkCommandBuffer commandBuffer); 
 
-// Creates a Vulkan buffer and allocates device memory for it.
+// Begins a secondary command buffer that continues the render pass described by inheritance.
+// Pass oneTimeSubmit = false for buffers that are kept and submitted again.
+void beginSecondaryCommandBuffer(VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritance, bool oneTimeSubmit = true);
+
+// Creates a Vulkan buffer and allocates device memory for it, counted by the
+// MemoryTracker under category. Free the memory with freeDeviceMemory.
 void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkDeviceSize size,
-    VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory,
+    MemoryTracker::DeviceCategory category);
 
 // Copies data from one buffer to another using a temporary command buffer. Command pool should be transient. 
 void copyBuffer(VkDevice device, VkCommandPool commandPool, VkQueue queue,
     VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 
-// Creates image object and associated memory bound to it.
+// Creates image object and associated memory bound to it, counted by the
+// MemoryTracker under category. Free the memory with freeDeviceMemory.
 void createImage(VkDevice device, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
     uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples,
     VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-    VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+    VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory,
+    MemoryTracker::DeviceCategory category);
+
+// vkFreeMemory for memory from createBuffer/createImage, so the MemoryTracker stops counting it
+void freeDeviceMemory(VkDevice device, VkDeviceMemory memory);
+
+// Reads every memory heap's size and, with VK_EXT_memory_budget, the
+// driver's budget and usage for this process, into the MemoryTracker
+void updateMemoryHeaps(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetSupported);
 
 // Copies buffer data into a Vulkan image.
 void copyBufferToImage(VkDevice device, VkCommandPool commandPool, VkQueue queue,
@@ -86,9 +86,28 @@ std::vector<const char*> getRequiredExtensions() {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    // optional, VK_EXT_memory_budget is read through it
+    if (hasInstanceExtension(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
+
     return extensions;
 }
 
+bool hasInstanceExtension(const char* name) {
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+    for (const auto& extension : extensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void createInstance(VkInstance& instance) {
     if (enableValidationLayers && !checkValidationLayerSupport()) {
         throw std::runtime_error("validation layers requested, but not available!");
@@ -178,6 +197,15 @@ void createLogicalDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading feature for the device
 
+    // optional, used to count fragment shader invocations when it's there
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    // lets the secondary command buffers run inside that query
+    deviceFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
+    // lets the renderer sample a BC1/BC7 cooked atlas
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -186,8 +214,12 @@ void createLogicalDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    std::vector<const char*> extensions = deviceExtensions;
+    if (isMemoryBudgetSupported(physicalDevice)) {
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -243,6 +275,12 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surfa
         i++;
     }
 
+    // software drivers (lavapipe, SwiftShader) and some GPUs have no
+    // transfer-only family, so uploads go through the graphics queue
+    if (!indices.transferFamily.has_value()) {
+        indices.transferFamily = indices.graphicsFamily;
+    }
+
     return indices;
 }
 
@@ -262,6 +300,25 @@ bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+bool hasDeviceExtension(VkPhysicalDevice device, const char* name) {
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+    for (const auto& extension : extensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isMemoryBudgetSupported(VkPhysicalDevice device) {
+    return hasInstanceExtension(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) &&
+        hasDeviceExtension(device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+}
+
 bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
     QueueFamilyIndices indices = findQueueFamilies(device, surface);
 
@@ -331,7 +388,7 @@ std::vector<char> readFile(const std::string& filename) {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
     if (!file.is_open()) {
-        throw std::runtime_error("failed to open file!");
+        throw std::runtime_error("failed to open " + filename + "!");
     }
 
     size_t fileSize = (size_t)file.tellg();
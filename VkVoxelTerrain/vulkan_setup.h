@@ -50,6 +50,9 @@ void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& create
 /// Returns a list of required Vulkan extensions, including debug extensions if enabled.
 std::vector<const char*> getRequiredExtensions();
 
+/// Checks if the Vulkan loader offers an instance extension.
+bool hasInstanceExtension(const char* name);
+
 /// Creates a Vulkan instance, optionally enabling validation layers.
 void createInstance(VkInstance& instance);
 
@@ -68,6 +71,12 @@ bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface);
 /// Checks if a Vulkan physical device supports all required extensions.
 bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 
+/// Checks if a Vulkan physical device supports one extension.
+bool hasDeviceExtension(VkPhysicalDevice device, const char* name);
+
+/// Whether VK_EXT_memory_budget can be used; createLogicalDevice enables it when it can.
+bool isMemoryBudgetSupported(VkPhysicalDevice device);
+
 /// Queries support details of a physical device's swapchain capabilities.
 SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
 
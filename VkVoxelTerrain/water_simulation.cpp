@@ -0,0 +1,330 @@
+#include "water_simulation.h"
+#include "terrain_util.h"
+#include "trace_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+
+// a Chunk's cells split into this many shares at least, so one Chunk
+// flooding doesn't starve the others, but not so few cells that a task
+// costs more to hand out than to run
+static constexpr size_t MIN_SHARE = 64;
+
+struct WaterSimulation::TickJob {
+    std::vector<Work> work;
+    std::atomic<size_t> next{ 0 };
+    std::atomic<size_t> done{ 0 };
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+};
+
+WaterSimulation::WaterSimulation(ThreadPool& pool, size_t budget)
+    : pool(pool), budget(budget), pending(), pendingMutex(), chunks(), activeOrder(), activeCount(0),
+    lastKey(0), last(nullptr), activePublished(0), activeChunksPublished(0), flowingCount(0), tickCount(0),
+    updatedCount(0), changedCount(0), tickMs(0.f)
+{}
+
+void WaterSimulation::blocksChanged(const glm::ivec3& min, const glm::ivec3& max) {
+    // the blocks around an edit may start flowing into it, or stop being fed by it
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pending.emplace_back(min - 1, max + 1);
+}
+
+WaterSimulation::Stats WaterSimulation::stats() const {
+    Stats stats;
+    stats.activeCells = activePublished.load();
+    stats.activeChunks = activeChunksPublished.load();
+    stats.flowingCells = flowingCount.load();
+    stats.ticks = tickCount.load();
+    stats.cellsUpdated = updatedCount.load();
+    stats.cellsChanged = changedCount.load();
+    stats.tickMs = tickMs.load();
+    return stats;
+}
+
+WaterSimulation::ChunkWater& WaterSimulation::chunkAt(int x, int z) {
+    int64_t key = toKey(x, z);
+    if (last == nullptr || key != lastKey) {
+        last = &chunks[key];
+        lastKey = key;
+    }
+    return *last;
+}
+
+void WaterSimulation::wake(const glm::ivec3& position) {
+    if (position.y < 0 || position.y > 255) {
+        return;
+    }
+    ChunkWater& water = chunkAt(position.x & ~15, position.z & ~15);
+    int index = Chunk::blockIndex(position.x & 15, position.y, position.z & 15);
+    if (water.activeBits.empty()) {
+        water.activeBits.assign(65536 / 64, 0);
+    }
+    uint64_t bit = uint64_t(1) << (index & 63);
+    if (water.activeBits[index >> 6] & bit) {
+        return;
+    }
+    water.activeBits[index >> 6] |= bit;
+    water.active.push_back(static_cast<uint16_t>(index));
+    activeCount++;
+    if (!water.queued) {
+        water.queued = true;
+        activeOrder.push_back(lastKey);
+    }
+}
+
+void WaterSimulation::update(Work& work) {
+    TRACE_SCOPE("water cells", "water", work.origin.x, work.origin.y);
+    struct Block {
+        BlockType type;
+        uint8_t level;      // for WATER, 0 for a source
+    };
+    // The block at (x, y, z) in work's Chunk, or up to one block past its
+    // sides. Chunks that aren't there read as solid.
+    auto blockAt = [&work](int x, int y, int z) -> Block {
+        const Chunk* chunk = work.chunk;
+        const ChunkWater* water = work.water;
+        if (x > 15 || x < 0 || z > 15 || z < 0) {
+            int side = x > 15 ? 0 : x < 0 ? 1 : z > 15 ? 2 : 3;
+            chunk = work.sideChunks[side];
+            water = work.sideWater[side];
+            x &= 15;
+            z &= 15;
+        }
+        if (chunk == nullptr) {
+            return { STONE, 0 };
+        }
+        int index = Chunk::blockIndex(x, y, z);
+        BlockType type = chunk->blockData()[index];
+        uint8_t level = 0;
+        if (type == WATER && water != nullptr) {
+            auto it = water->levels.find(static_cast<uint16_t>(index));
+            if (it != water->levels.end()) {
+                level = it->second;
+            }
+        }
+        return { type, level };
+    };
+    static const glm::ivec2 sides[4] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+
+    for (size_t i = work.first; i < work.first + work.count; i++) {
+        uint16_t index = work.water->active[i];
+        int x = index & 15, y = (index >> 4) & 255, z = index >> 12;
+        Block self = blockAt(x, y, z);
+        uint8_t current;
+        if (self.type == WATER) {
+            current = self.level;
+        }
+        else if (self.type == EMPTY) {
+            // flowing water an edit took away keeps its level until now, and
+            // is written again whatever it works out to
+            current = work.water->levels.count(index) != 0 ? FORGET : DRY;
+        }
+        else {
+            // flowing water an edit replaced
+            if (work.water->levels.count(index) != 0) {
+                work.changes.push_back({ index, FORGET });
+            }
+            continue;
+        }
+        if (current == 0) {
+            continue;
+        }
+
+        uint8_t wanted = DRY;
+        if (y < 255 && blockAt(x, y + 1, z).type == WATER) {
+            wanted = 1;
+        }
+        else {
+            for (const glm::ivec2& side : sides) {
+                Block next = blockAt(x + side.x, y, z + side.y);
+                if (next.type != WATER || next.level + 1 >= wanted) {
+                    continue;
+                }
+                // water only spreads sideways once it can't fall any further
+                if (y > 0) {
+                    Block below = blockAt(x + side.x, y - 1, z + side.y);
+                    if (!isOpaque(below.type) && !(below.type == WATER && below.level == 0)) {
+                        continue;
+                    }
+                }
+                wanted = next.level + 1;
+            }
+        }
+        if (wanted != current) {
+            work.changes.push_back({ index, wanted });
+        }
+    }
+}
+
+void WaterSimulation::runWork(std::shared_ptr<TickJob> job) {
+    size_t i;
+    while ((i = job->next.fetch_add(1)) < job->work.size()) {
+        update(job->work[i]);
+        if (job->done.fetch_add(1) + 1 == job->work.size()) {
+            std::lock_guard<std::mutex> lock(job->doneMutex);
+            job->doneCondition.notify_one();
+        }
+    }
+}
+
+size_t WaterSimulation::tick(const ChunkLookup& lookup, EditBatch& edits) {
+    TRACE_SCOPE("water tick", "water");
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::pair<glm::ivec3, glm::ivec3>> boxes;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        boxes.swap(pending);
+    }
+    for (const auto& [min, max] : boxes) {
+        for (int z = min.z; z <= max.z; z++) {
+            for (int y = std::max(min.y, 0); y <= std::min(max.y, 255); y++) {
+                for (int x = min.x; x <= max.x; x++) {
+                    wake(glm::ivec3(x, y, z));
+                }
+            }
+        }
+    }
+
+    if (activeOrder.empty()) {
+        tickCount++;
+        tickMs = 0.f;
+        return 0;
+    }
+
+    // take each Chunk's share of the budget, oldest cells first, going round
+    // the Chunks so those past the budget are first in line next tick
+    auto job = std::make_shared<TickJob>();
+    size_t remaining = budget.load();
+    const size_t share = std::max(remaining / activeOrder.size(), MIN_SHARE);
+    size_t taken = 0;
+    std::vector<int64_t> visited;
+    for (size_t visits = activeOrder.size(); visits > 0 && remaining > 0; visits--) {
+        int64_t key = activeOrder.front();
+        activeOrder.pop_front();
+        ChunkWater& water = chunks[key];
+        glm::ivec2 origin = toCoords(key);
+        const Chunk* chunk = lookup(origin.x, origin.y);
+        visited.push_back(key);
+
+        size_t first = water.activeHead;
+        size_t count = chunk == nullptr ? water.active.size() - first : std::min({ share, remaining, water.active.size() - first });
+        for (size_t i = first; i < first + count; i++) {
+            water.activeBits[water.active[i] >> 6] &= ~(uint64_t(1) << (water.active[i] & 63));
+        }
+        water.activeHead += count;
+        activeCount -= count;
+        water.queued = water.activeHead < water.active.size();
+        if (water.queued) {
+            activeOrder.push_back(key);
+        }
+        // nothing flows into a Chunk that isn't generated yet
+        if (chunk == nullptr) {
+            continue;
+        }
+        remaining -= count;
+        taken += count;
+
+        Work work;
+        work.origin = origin;
+        work.water = &water;
+        work.chunk = chunk;
+        const glm::ivec2 sideOrigins[4] = { origin + glm::ivec2(16, 0), origin - glm::ivec2(16, 0),
+            origin + glm::ivec2(0, 16), origin - glm::ivec2(0, 16) };
+        for (int side = 0; side < 4; side++) {
+            work.sideChunks[side] = lookup(sideOrigins[side].x, sideOrigins[side].y);
+            auto it = chunks.find(toKey(sideOrigins[side].x, sideOrigins[side].y));
+            work.sideWater[side] = it != chunks.end() ? &it->second : nullptr;
+        }
+        for (size_t offset = 0; offset < count; offset += WORK_CELLS) {
+            work.first = first + offset;
+            work.count = std::min(WORK_CELLS, count - offset);
+            job->work.push_back(work);
+        }
+    }
+
+    // a few cells cost less to update here than to hand out
+    if (taken > WORK_CELLS) {
+        size_t helpers = std::min(job->work.size() - 1, pool.size());
+        for (size_t i = 0; i < helpers; i++) {
+            pool.enqueuePriority(&WaterSimulation::runWork, job);
+        }
+    }
+    runWork(job);
+    {
+        std::unique_lock<std::mutex> lock(job->doneMutex);
+        job->doneCondition.wait(lock, [&job] { return job->done.load() == job->work.size(); });
+    }
+
+    // every cell was worked out from the blocks as they were, now write them
+    uint64_t changed = 0;
+    for (Work& work : job->work) {
+        for (const Change& change : work.changes) {
+            auto it = work.water->levels.find(change.index);
+            bool wasFlowing = it != work.water->levels.end();
+            if (change.level == FORGET) {
+                work.water->levels.erase(it);
+                flowingCount--;
+                continue;
+            }
+            // the block, not the level, says whether there is water there now:
+            // an edit may have emptied it since the level was set
+            bool isWater = work.chunk->blockData()[change.index] == WATER;
+            int x = change.index & 15, y = (change.index >> 4) & 255, z = change.index >> 12;
+            glm::ivec3 position(work.origin.x + x, y, work.origin.y + z);
+            if (change.level == DRY) {
+                if (wasFlowing) {
+                    work.water->levels.erase(it);
+                    flowingCount--;
+                }
+                if (isWater) {
+                    edits.set(position, EMPTY);
+                }
+            }
+            else {
+                if (wasFlowing) {
+                    it->second = change.level;
+                }
+                else {
+                    work.water->levels.emplace(change.index, change.level);
+                    flowingCount++;
+                }
+                if (!isWater) {
+                    edits.set(position, WATER);
+                }
+            }
+            changed++;
+            // what this block's state feeds: the blocks beside it and below
+            wake(position + glm::ivec3(1, 0, 0));
+            wake(position - glm::ivec3(1, 0, 0));
+            wake(position + glm::ivec3(0, 0, 1));
+            wake(position - glm::ivec3(0, 0, 1));
+            wake(position - glm::ivec3(0, 1, 0));
+        }
+    }
+
+    // drop the cells the tick took, and the Chunks left with no water state
+    for (int64_t key : visited) {
+        auto it = chunks.find(key);
+        ChunkWater& water = it->second;
+        water.active.erase(water.active.begin(), water.active.begin() + water.activeHead);
+        water.activeHead = 0;
+        if (water.active.empty()) {
+            std::vector<uint64_t>().swap(water.activeBits);
+            if (water.levels.empty()) {
+                chunks.erase(it);
+                last = nullptr;
+            }
+        }
+    }
+
+    activePublished = activeCount;
+    activeChunksPublished = activeOrder.size();
+    tickCount++;
+    updatedCount += taken;
+    changedCount += changed;
+    tickMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return taken;
+}
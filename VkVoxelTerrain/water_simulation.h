@@ -0,0 +1,140 @@
+#pragma once
+#include "glm_includes.h"
+#include "chunk.h"
+#include "block_access.h"
+#include "edit_batch.h"
+#include "threadpool.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Makes WATER flow. Generated water is all sources, which never change.
+// Flowing water keeps a level from 1 to MAX_FLOW: water with water above it
+// is level 1, otherwise each block is one more than the lowest neighbour
+// along x or z that can spread sideways (a source, or water standing on
+// something solid or on a source), and past MAX_FLOW it dries up. Taking a
+// source away lets the levels climb until the flow dries up.
+//
+// Only active cells are looked at: the blocks next to an edit, and the
+// neighbours of every block the simulation changes. Each tick takes up to
+// its budget of them, spread fairly over the Chunks that have any, and
+// works out their new state on the thread pool by Chunk from the blocks as
+// they were when the tick began. The changes come back as an EditBatch for
+// the caller to write, so they are remeshed like any other edit. A quiet
+// world costs nothing however big it is, and a flood costs the same per
+// tick however much of it is still waiting.
+//
+// Chunks that aren't generated count as solid, so water stops at their edge.
+class WaterSimulation {
+public:
+    static constexpr int MAX_FLOW = 7;
+    // active cells updated per tick by default
+    static constexpr size_t DEFAULT_BUDGET = 4096;
+
+    struct Stats {
+        size_t activeCells = 0;     // waiting for a tick
+        size_t activeChunks = 0;    // Chunks with active cells
+        size_t flowingCells = 0;    // water blocks that aren't sources
+        uint64_t ticks = 0;
+        uint64_t cellsUpdated = 0;  // active cells the ticks took
+        uint64_t cellsChanged = 0;  // of those, the ones whose block or level changed
+        float tickMs = 0.f;         // the last tick, edits not included
+    };
+
+    explicit WaterSimulation(ThreadPool& pool, size_t budget = DEFAULT_BUDGET);
+    WaterSimulation(const WaterSimulation&) = delete;
+    WaterSimulation& operator=(const WaterSimulation&) = delete;
+
+    // Any thread: the blocks in the box (both included, world space)
+    // changed, so they and the blocks around them may flow. Picked up by
+    // the next tick.
+    void blocksChanged(const glm::ivec3& min, const glm::ivec3& max);
+    // Updates up to the budget of active cells against the Chunks lookup
+    // finds, and adds the blocks that change to edits. The caller writes
+    // edits before the next tick. Returns how many cells were updated.
+    size_t tick(const ChunkLookup& lookup, EditBatch& edits);
+
+    void setBudget(size_t cells) { budget = cells; }
+    size_t getBudget() const { return budget; }
+    Stats stats() const;
+
+private:
+    // a level that means no water
+    static constexpr uint8_t DRY = MAX_FLOW + 1;
+    // a level left on a block an edit changed: dropped if the block isn't
+    // water or air any more, and written back if it is air
+    static constexpr uint8_t FORGET = 0xFF;
+    // the most active cells one pool task takes
+    static constexpr size_t WORK_CELLS = 1024;
+
+    // The water state of one Chunk, by Chunk::blockIndex
+    struct ChunkWater {
+        // flowing water; a WATER block that isn't in here is a source
+        std::unordered_map<uint16_t, uint8_t> levels;
+        // active cells in the order they woke, from activeHead on, and one
+        // bit per block so a cell is only in once. activeBits is empty
+        // while there are none.
+        std::vector<uint16_t> active;
+        size_t activeHead = 0;
+        std::vector<uint64_t> activeBits;
+        // in activeOrder
+        bool queued = false;
+    };
+    // a block's new level, DRY or FORGET
+    struct Change {
+        uint16_t index;
+        uint8_t level;
+    };
+    // Some of one Chunk's active cells, for one pool task. The Chunk and its
+    // four sides (XPOS, XNEG, ZPOS, ZNEG) are looked up before the tick's
+    // tasks start, nullptr where there is none.
+    struct Work {
+        glm::ivec2 origin;
+        ChunkWater* water;
+        const Chunk* chunk;
+        std::array<const Chunk*, 4> sideChunks;
+        std::array<const ChunkWater*, 4> sideWater;
+        size_t first;
+        size_t count;
+        std::vector<Change> changes;
+    };
+    struct TickJob;
+
+    ThreadPool& pool;
+    std::atomic<size_t> budget;
+
+    // boxes from blocksChanged that no tick has woken yet
+    std::vector<std::pair<glm::ivec3, glm::ivec3>> pending;
+    std::mutex pendingMutex;
+
+    // Everything below is only touched by tick, and the pool tasks it waits on.
+    // By toKey of the Chunk's corner.
+    std::unordered_map<int64_t, ChunkWater> chunks;
+    // Chunks with active cells, taken round robin so each gets a share
+    std::deque<int64_t> activeOrder;
+    size_t activeCount;
+    // the ChunkWater of the last wake, as wakes tend to come in order
+    int64_t lastKey;
+    ChunkWater* last;
+
+    std::atomic<size_t> activePublished;
+    std::atomic<size_t> activeChunksPublished;
+    std::atomic<size_t> flowingCount;
+    std::atomic<uint64_t> tickCount;
+    std::atomic<uint64_t> updatedCount;
+    std::atomic<uint64_t> changedCount;
+    std::atomic<float> tickMs;
+
+    ChunkWater& chunkAt(int x, int z);
+    // Makes the block active, if it is in the world
+    void wake(const glm::ivec3& position);
+    // Works out the new state of the Work's cells into its changes
+    static void update(Work& work);
+    static void runWork(std::shared_ptr<TickJob> job);
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "globals.h"
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <utility>
+
+// ZoneCommandCache keeps one secondary command buffer per (zone, frame in flight)
+// so a zone whose chunks haven't changed can be executed again without being
+// re-recorded. Every zone owns a small command pool, which keeps the rule that
+// only one thread records from a pool at a time: a zone is recorded by exactly
+// one thread per frame. A cached buffer draws all of the zone's sections, so
+// it survives the camera turning; culling skips whole zones instead.
+class ZoneCommandCache {
+public:
+    // Everything baked into a recorded zone. If any of it differs from what
+    // the buffer was recorded with, the buffer has to be recorded again.
+    struct Key {
+        uint32_t version = 0;                   // Terrain's per-zone version counter
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkExtent2D extent = { 0, 0 };           // viewport and scissor are recorded into the buffer
+        uint8_t chunkOrder = 0;                 // order the zone's chunks are drawn in, see Terrain::zoneChunkOrder
+
+        bool operator==(const Key& other) const {
+            return version == other.version && pipeline == other.pipeline &&
+                descriptorSet == other.descriptorSet && extent.width == other.extent.width &&
+                extent.height == other.extent.height && chunkOrder == other.chunkOrder;
+        }
+    };
+
+    // The zone's buffer for one frame in flight
+    struct Frame {
+        VkCommandBuffer buffer = VK_NULL_HANDLE;
+        Key key;
+        bool valid = false;
+        // section counters from when the buffer was recorded, so the overlay
+        // stays correct on a cache hit
+        int sectionsDrawn = 0;
+        int sectionsCulled = 0;
+    };
+
+    struct Entry {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<Frame> frames;
+        uint64_t lastUsed = 0;
+    };
+
+    ZoneCommandCache() :
+        entries{}, device{VK_NULL_HANDLE}, queueFamilyIndex{0}
+    {
+    }
+
+    void init(VkDevice device, uint32_t queueFamilyIndex)
+    {
+        this->device = device;
+        this->queueFamilyIndex = queueFamilyIndex;
+    }
+
+    // Returns the zone's entry, creating its pool and buffers the first time.
+    // Only the main thread may call this; the returned pointer stays valid
+    // until the entry is evicted.
+    Entry* acquire(int64_t zoneKey, uint64_t frameNumber)
+    {
+        auto it = entries.find(zoneKey);
+        if (it == entries.end()) {
+            Entry entry;
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex = queueFamilyIndex;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+            if (vkCreateCommandPool(device, &poolInfo, nullptr, &entry.pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create zone command pool!");
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = entry.pool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = MAX_FRAMES_IN_FLIGHT;
+
+            std::vector<VkCommandBuffer> buffers(MAX_FRAMES_IN_FLIGHT);
+            if (vkAllocateCommandBuffers(device, &allocInfo, buffers.data()) != VK_SUCCESS) {
+                vkDestroyCommandPool(device, entry.pool, nullptr);
+                throw std::runtime_error("failed to allocate zone command buffers!");
+            }
+            entry.frames.resize(MAX_FRAMES_IN_FLIGHT);
+            for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+                entry.frames[i].buffer = buffers[i];
+            }
+            it = entries.emplace(zoneKey, std::move(entry)).first;
+        }
+        it->second.lastUsed = frameNumber;
+        return &it->second;
+    }
+
+    // Destroys the entries of zones that haven't been drawn for maxAge frames.
+    // maxAge must be at least MAX_FRAMES_IN_FLIGHT so none of the buffers can
+    // still be in flight.
+    void evict(uint64_t frameNumber, uint64_t maxAge)
+    {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (frameNumber - it->second.lastUsed > maxAge) {
+                vkDestroyCommandPool(device, it->second.pool, nullptr);
+                it = entries.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    void cleanup() {
+        for (auto& [key, entry] : entries) {
+            // destroying the pool frees its command buffers
+            vkDestroyCommandPool(device, entry.pool, nullptr);
+        }
+        entries.clear();
+    }
+
+private:
+    std::unordered_map<int64_t, Entry> entries;
+    VkDevice device;
+    uint32_t queueFamilyIndex;
+};